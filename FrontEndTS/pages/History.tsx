@@ -1,18 +1,73 @@
-import React from 'react';
+import React, { useEffect, useState } from 'react';
+import { useConfig } from '../context/ConfigContext';
+import { getHistory, type HistoryRound } from '../utils/espApi';
 
 const History: React.FC = () => {
+  const { config } = useConfig();
+  const [rounds, setRounds] = useState<HistoryRound[]>([]);
+  const [error, setError] = useState<string>('');
+
+  // The device keeps the most recent rounds; page through them oldest first.
+  useEffect(() => {
+    let cancelled = false;
+    (async () => {
+      try {
+        const all: HistoryRound[] = [];
+        let page = await getHistory(0);
+        all.push(...page.rounds);
+        while (page.next !== undefined && !cancelled) {
+          page = await getHistory(page.next);
+          all.push(...page.rounds);
+        }
+        if (!cancelled) setRounds(all.reverse());
+      } catch {
+        if (!cancelled) setError('Could not reach the buzzer controller.');
+      }
+    })();
+    return () => { cancelled = true; };
+  }, []);
+
+  const teamName = (i: number) => config.teams[i]?.name ?? `Team ${i + 1}`;
+
   return (
     <div className="h-full w-full flex flex-col">
         <h2 className="text-2xl font-display font-bold text-gold-400 mb-6">Round History</h2>
-        
+
         <div className="flex-1 bg-neutral-900/30 rounded-2xl border border-white/5 overflow-hidden relative">
+          {rounds.length === 0 ? (
              <div className="absolute inset-0 flex flex-col items-center justify-center text-neutral-500">
                 <svg className="w-12 h-12 mb-4 opacity-50" fill="none" stroke="currentColor" viewBox="0 0 24 24"><path strokeLinecap="round" strokeLinejoin="round" strokeWidth="2" d="M12 8v4l3 3m6-3a9 9 0 11-18 0 9 9 0 0118 0z"></path></svg>
-                <p>No recent round data found.</p>
+                <p>{error || 'No recent round data found.'}</p>
              </div>
+          ) : (
+            <div className="absolute inset-0 overflow-y-auto p-6 space-y-4">
+              {rounds.map((r) => (
+                <div key={r.round} className="rounded-xl border border-white/10 bg-neutral-900/40 p-4">
+                  <div className="flex items-baseline justify-between mb-3">
+                    <h3 className="font-display font-bold text-white">Round {r.round}</h3>
+                    <span className="text-xs text-neutral-400">
+                      {r.aborted ? 'aborted after ' : ''}{(r.elapsedMs / 1000).toFixed(1)} s · {r.tieBreak}
+                    </span>
+                  </div>
+                  {r.order.length === 0 ? (
+                    <p className="text-neutral-500 text-sm">No presses.</p>
+                  ) : (
+                    <ol className="space-y-1 text-sm">
+                      {r.order.map((team, k) => (
+                        <li key={team} className="flex justify-between text-neutral-200">
+                          <span><span className="text-gold-400 mr-2">{r.places[k] + 1}.</span>{teamName(team)}</span>
+                          <span className="text-neutral-400">{(r.reactionUs[k] / 1000).toFixed(1)} ms</span>
+                        </li>
+                      ))}
+                    </ol>
+                  )}
+                </div>
+              ))}
+            </div>
+          )}
         </div>
     </div>
   );
 };
 
-export default History;
\ No newline at end of file
+export default History;
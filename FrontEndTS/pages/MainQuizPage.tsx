@@ -2,7 +2,7 @@ import React, { useState, useEffect, useRef } from 'react';
 import { useConfig } from '../context/ConfigContext';
 import { useNavigate } from 'react-router-dom';
 import { Settings, Play, Pause, Square, SkipForward, RotateCcw } from 'lucide-react';
-import { startGame, resetGame, connectEvents, postConfig } from '../utils/espApi';
+import { startGame, resetGame, connectEvents, postConfig, type EventsHandle } from '../utils/espApi';
 
 enum GameState {
   IDLE = 'IDLE',      // "Let's Start" Screen
@@ -23,7 +23,7 @@ export default function MainQuizPage() {
   const gainRef = useRef<any>(null);
   const bufferRef = useRef<AudioBuffer | null>(null);
   const currentSourceRef = useRef<AudioBufferSourceNode | null>(null);
-  const esRef = useRef<EventSource | null>(null);
+  const esRef = useRef<EventsHandle | null>(null);
   const initAudio = async () => {
     if (!audioCtxRef.current) {
       const AC: any = (window as any).AudioContext || (window as any).webkitAudioContext;
@@ -7,11 +7,26 @@ export function getEspBaseUrl() {
   return BASE;
 }
 
-export async function postConfig(durationMs: number) {
+export type TieBreak = 'timestamp' | 'random' | 'judge';
+
+// Presses at most tieWindowUs after the first of a group tie, ordered by
+// tieBreak. Sent during a round, the settings apply from the next one.
+export async function postConfig(durationMs: number, tie?: { tieWindowUs?: number; tieBreak?: TieBreak }) {
   const res = await fetch(`${BASE}/api/game/config`, {
     method: 'POST',
     headers: { 'Content-Type': 'application/json' },
-    body: JSON.stringify({ durationMs })
+    body: JSON.stringify({ durationMs, ...tie })
+  });
+  return res.ok;
+}
+
+// The judge's call under the 'judge' policy: teamIndex takes the next place
+// in its tie group. The device sends an updated result event.
+export async function judgeTie(teamIndex: number) {
+  const res = await fetch(`${BASE}/api/game/tiebreak`, {
+    method: 'POST',
+    headers: { 'Content-Type': 'application/json' },
+    body: JSON.stringify({ teamIndex })
   });
   return res.ok;
 }
@@ -38,24 +53,207 @@ export async function getHealth() {
   return res.json();
 }
 
-export function connectEvents(onBuzzer: (p: { teamIndex: number; orderNo: number; timestamp: number }) => void,
-                              onResult: (r: { top3: number[] }) => void) {
-  const es = new EventSource(`${BASE}/events`);
-  es.addEventListener('buzzer', (e: MessageEvent) => {
-    try { const data = JSON.parse(e.data); onBuzzer(data); } catch {}
-  });
-  es.addEventListener('result', (e: MessageEvent) => {
-    try { const data = JSON.parse(e.data); onResult(data); } catch {}
-  });
-  es.onerror = () => {
-    es.close();
-    // Simple fallback: poll status once to keep UI roughly in sync
+export type HistoryRound = {
+  round: number;
+  elapsedMs: number;  // start to end, or to the reset or restart
+  tieBreak: TieBreak;
+  aborted: boolean;   // reset or restarted before it ended
+  order: number[];    // participant of each press, in final order
+  places: number[];   // equal within a tie awaiting the judge
+  reactionUs: number[]; // press time since the round started
+};
+export type HistoryPage = { capacity: number; oldest: number; newest: number; next?: number; rounds: HistoryRound[] };
+
+// Past rounds kept on the device, oldest first. Without `from` the newest
+// rounds come back; pass `next` as `from` to page forward.
+export async function getHistory(from?: number, limit?: number): Promise<HistoryPage> {
+  const q = new URLSearchParams();
+  if (from !== undefined) q.set('from', String(from));
+  if (limit !== undefined) q.set('limit', String(limit));
+  const res = await fetch(`${BASE}/api/history${q.toString() ? `?${q}` : ''}`);
+  if (!res.ok) throw new Error('history failed');
+  return res.json();
+}
+
+export async function getMetrics() {
+  const res = await fetch(`${BASE}/api/metrics`);
+  if (!res.ok) throw new Error('metrics failed');
+  return res.json();
+}
+
+export type DeviceClock = {
+  offsetMs: number; // device time (µs / 1000) minus performance.now()
+  rttMs: number;    // round trip of the exchange the offset came from
+  errorMs: number;  // the offset is good to within this
+  roundStartUs: number;
+  toLocalMs: (deviceUs: number) => number; // device µs -> performance.now() ms
+};
+
+// One exchange against /api/time, all in ms: t1 browser send, t2 device
+// receive, t3 device send, t4 browser receive. The same sums as
+// timeExchange() in Main_Module/include/ClockSync.h: however the round trip
+// splits between the legs, the device clock is within errorMs of offsetMs
+// ahead. null if the round trip comes out negative.
+export type TimeExchange = { offsetMs: number; rttMs: number; errorMs: number };
+
+export function timeExchange(t1: number, t2: number, t3: number, t4: number): TimeExchange | null {
+  const rttMs = (t4 - t1) - (t3 - t2);
+  if (rttMs < 0) return null;
+  return { offsetMs: ((t2 - t1) + (t3 - t4)) / 2, rttMs, errorMs: rttMs / 2 };
+}
+
+// The lowest-RTT exchange, the one with the tightest bound; the first of
+// equals.
+export function fastestExchange<T extends TimeExchange>(exchanges: T[]): T | null {
+  let best: T | null = null;
+  for (const x of exchanges) if (!best || x.rttMs < best.rttMs) best = x;
+  return best;
+}
+
+// NTP-style exchanges against /api/time; the fastest of `samples` is kept.
+export async function syncClock(samples = 8): Promise<DeviceClock> {
+  const exchanges: (TimeExchange & { roundStartUs: number })[] = [];
+  for (let k = 0; k < samples; k++) {
+    const t1 = performance.now();
+    const res = await fetch(`${BASE}/api/time?t1=${t1.toFixed(3)}`, { cache: 'no-store' });
+    const t4 = performance.now();
+    if (!res.ok) continue;
+    const r = await res.json();
+    const x = timeExchange(t1, r.t2 / 1000, r.t3 / 1000, t4);
+    if (x) exchanges.push({ ...x, roundStartUs: r.roundStartUs });
+  }
+  const best = fastestExchange(exchanges);
+  if (!best) throw new Error('time sync failed');
+  const { offsetMs, rttMs, errorMs, roundStartUs } = best;
+  return { offsetMs, rttMs, errorMs, roundStartUs, toLocalMs: (deviceUs: number) => deviceUs / 1000 - offsetMs };
+}
+
+export type EventsHandle = { close: () => void };
+
+// places are shared within a tie the judge has not decided yet, which makes
+// the result provisional; tieGroup/tieGroups are -1 outside a tie.
+export type RoundResult = { top3: number[]; places?: number[]; tieGroups?: number[]; provisional?: boolean };
+
+export function connectEvents(onBuzzer: (p: { teamIndex: number; orderNo: number; timestamp: number; timestampUs?: number; sinceStartUs?: number; tie?: boolean; tieGroup?: number }) => void,
+                              onResult: (r: RoundResult) => void): EventsHandle {
+  // Every event carries an id. The browser resends the last one as
+  // Last-Event-ID when it reconnects by itself, and the device replays what
+  // was missed. Only if the stream is closed for good do we open a new one,
+  // passing the id explicitly.
+  let lastEventId = '';
+  let es: EventSource | null = null;
+  let retryTimer: ReturnType<typeof setTimeout> | null = null;
+  let closed = false;
+
+  const track = (e: MessageEvent) => { if (e.lastEventId) lastEventId = e.lastEventId; };
+  const resync = () => {
     getStatus().then((s) => {
       if (Array.isArray(s.pressOrder) && s.pressOrder.length) {
-        onResult({ top3: s.pressOrder.slice(0, 3) });
+        onResult({ top3: s.pressOrder.slice(0, 3), places: s.pressPlaces?.slice(0, 3),
+                   tieGroups: s.pressTieGroups?.slice(0, 3), provisional: s.provisional });
       }
     }).catch(() => {});
-    setTimeout(() => connectEvents(onBuzzer, onResult), 3000);
   };
-  return es;
+
+  const open = () => {
+    const url = lastEventId ? `${BASE}/events?lastEventId=${encodeURIComponent(lastEventId)}` : `${BASE}/events`;
+    const source = new EventSource(url);
+    es = source;
+    source.addEventListener('buzzer', (e: MessageEvent) => {
+      track(e);
+      try { const data = JSON.parse(e.data); onBuzzer(data); } catch {}
+    });
+    source.addEventListener('result', (e: MessageEvent) => {
+      track(e);
+      try { const data = JSON.parse(e.data); onResult(data); } catch {}
+    });
+    // A judge's decision; the updated result event follows it
+    source.addEventListener('tiebreak', track);
+    // Sent when the device no longer has the missed events (or rebooted)
+    source.addEventListener('resync', (e: MessageEvent) => {
+      track(e);
+      resync();
+    });
+    source.onerror = () => {
+      if (source.readyState !== EventSource.CLOSED || closed) return;
+      retryTimer = setTimeout(open, 3000);
+    };
+  };
+
+  open();
+  return {
+    close: () => {
+      closed = true;
+      if (retryTimer) clearTimeout(retryTimer);
+      if (es) es.close();
+    }
+  };
+}
+
+export type WsHandle = {
+  start: () => Promise<number>;
+  reset: () => Promise<number>;
+  config: (durationMs: number) => Promise<number>;
+  close: () => void;
+};
+
+// Binary channel on port 81 (frame layout in Main_Module/include/WsProtocol.h).
+// Pushes the same press/result updates as /events and takes commands on the
+// same socket. Each command promise resolves with its round-trip time in ms
+// once the device acknowledges it.
+export function connectWs(onBuzzer: (p: { teamIndex: number; orderNo: number; timestamp: number; timestampUs?: number; tie?: boolean }) => void,
+                          onResult: (r: { top3: number[] }) => void): WsHandle {
+  const host = BASE.replace(/^https?:\/\//, '').replace(/:\d+$/, '').replace(/\/.*$/, '');
+  const ws = new WebSocket(`ws://${host}:81/ws`);
+  ws.binaryType = 'arraybuffer';
+  let seq = 0;
+  const pending = new Map<number, { sentAt: number; resolve: (ms: number) => void; reject: (e: Error) => void }>();
+
+  ws.onmessage = (e: MessageEvent) => {
+    if (!(e.data instanceof ArrayBuffer)) return;
+    const v = new DataView(e.data);
+    const type = v.getUint8(0);
+    if (type === 1 && v.byteLength >= 16) {
+      const timestampUs = Number(v.getBigUint64(8, true));
+      onBuzzer({ teamIndex: v.getUint8(1), orderNo: v.getUint8(2), timestamp: Math.floor(timestampUs / 1000), timestampUs });
+    } else if (type === 2 && v.byteLength >= 12) {
+      const top3: number[] = [];
+      for (let k = 0; k < v.getUint8(1); k++) top3.push(v.getInt8(2 + k));
+      onResult({ top3 });
+    } else if (type === 0x80 && v.byteLength >= 8) {
+      const p = pending.get(v.getUint32(4, true));
+      if (!p) return;
+      pending.delete(v.getUint32(4, true));
+      if (v.getUint8(2) === 0) p.resolve(performance.now() - p.sentAt);
+      else p.reject(new Error(`command rejected (${v.getUint8(2)})`));
+    }
+  };
+
+  const send = (op: number, value = 0) => new Promise<number>((resolve, reject) => {
+    if (ws.readyState !== WebSocket.OPEN) { reject(new Error('ws not open')); return; }
+    const buf = new ArrayBuffer(12);
+    const v = new DataView(buf);
+    const s = (seq = (seq + 1) >>> 0);
+    v.setUint8(0, op);
+    v.setUint32(4, s, true);
+    v.setUint32(8, value, true);
+    pending.set(s, { sentAt: performance.now(), resolve, reject });
+    ws.send(buf);
+  });
+
+  // A dropped socket never delivers the outstanding ACKs; fail those
+  // commands instead of leaving their promises hanging.
+  const rejectPending = (reason: string) => {
+    pending.forEach((p) => p.reject(new Error(reason)));
+    pending.clear();
+  };
+  ws.onclose = () => rejectPending('ws closed');
+  ws.onerror = () => rejectPending('ws error');
+
+  return {
+    start: () => send(1),
+    reset: () => send(2),
+    config: (durationMs: number) => send(3, durationMs),
+    close: () => ws.close()
+  };
 }
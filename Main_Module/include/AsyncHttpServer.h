@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <functional>
+#include "LatencyHistogram.h"
+
+#ifndef HTTP_MAX_CONNECTIONS
+#define HTTP_MAX_CONNECTIONS 12
+#endif
+
+enum HttpMethod : uint8_t { HTTP_ANY = 0, HTTP_GET, HTTP_POST, HTTP_OPTIONS, HTTP_OTHER };
+
+struct HttpConnection;
+
+// Small callback-driven HTTP/1.1 server on top of AsyncTCP.
+//
+// Requests are parsed and dispatched from the AsyncTCP task as data arrives,
+// so a slow client never blocks anyone else. Connections are kept alive
+// between requests unless the client asks otherwise, and up to
+// MAX_CONNECTIONS (SSE streams included) are served at once.
+//
+// The request API mirrors the Arduino WebServer: inside a handler, method(),
+// arg(), header(), sendHeader() and send() refer to the request being
+// dispatched. A handler can also take the connection over as a long-lived
+// stream with beginStream() (used for SSE).
+//
+// Every server callback runs with the server lock held. Other tasks that
+// write to stream clients or share state with handlers take the same lock.
+class AsyncHttpServer {
+public:
+  typedef std::function<void()> Handler;
+  typedef std::function<void(AsyncClient*)> StreamHandler;
+
+  static const int MAX_CONNECTIONS = HTTP_MAX_CONNECTIONS;
+  static const int MAX_ROUTES = 24;
+  static const size_t MAX_HEADER_BYTES = 2048;
+  static const size_t MAX_BODY_BYTES = 1024;
+  static const uint32_t KEEPALIVE_TIMEOUT_S = 15;
+
+  explicit AsyncHttpServer(uint16_t port);
+
+  void on(const char* uri, HttpMethod method, Handler handler);
+  void onNotFound(Handler handler);
+  void onStreamClose(StreamHandler handler);
+  void onStreamWritable(StreamHandler handler); // a stream client got ACKs
+  void begin();
+
+  // Request accessors, valid only inside a handler.
+  HttpMethod method() const;
+  const String& uri() const;
+  String arg(const char* name) const; // "plain" is the request body
+  bool hasArg(const char* name) const;
+  String header(const char* name) const;
+  // esp_timer µs when the last segment of the request arrived.
+  int64_t receivedUs() const;
+
+  // Response, valid only inside a handler.
+  void sendHeader(const char* name, const char* value);
+  void send(int code, const char* contentType = NULL, const String& content = String());
+
+  // Detach the current connection from HTTP handling and return its client.
+  // The caller writes the response head itself and owns the stream until
+  // the stream-close handler reports it gone. It must not close the client
+  // before the handler returns; close from the stream-writable handler.
+  // Returns NULL, leaving the request to be answered normally, while TCP
+  // has not yet taken earlier responses on the connection.
+  AsyncClient* beginStream();
+
+  void lock();
+  void unlock();
+
+  int activeConnections() const { return connectionCount_; }
+  uint32_t requestsServed() const { return requestsServed_; }
+  uint32_t rejectedConnections() const { return rejectedConnections_; }
+  // Route handler run time, including building and queueing the response.
+  // Written under the server lock.
+  const LatencyHistogram& handlerUs() const { return handlerUs_; }
+
+private:
+  struct Route {
+    const char* uri;
+    HttpMethod method;
+    Handler handler;
+  };
+
+  void handleConnect(AsyncClient* client);
+  void handleData(HttpConnection* conn, const char* data, size_t len);
+  void handleAck(HttpConnection* conn);
+  void handleDisconnect(HttpConnection* conn);
+  bool parseRequest(HttpConnection* conn);
+  void dispatch(HttpConnection* conn);
+  void writeOut(HttpConnection* conn, const char* data, size_t len);
+  void flush(HttpConnection* conn);
+
+  AsyncServer tcp_;
+  SemaphoreHandle_t lock_;
+  Route routes_[MAX_ROUTES];
+  int routeCount_;
+  Handler notFound_;
+  StreamHandler streamClose_;
+  StreamHandler streamWritable_;
+  HttpConnection* current_;
+  int connectionCount_;
+  uint32_t requestsServed_;
+  uint32_t rejectedConnections_;
+  LatencyHistogram handlerUs_;
+};
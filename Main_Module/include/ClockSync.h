@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stdint.h>
+
+// One NTP-style exchange: t1 client send, t2 server receive, t3 server
+// send, t4 client receive, each read from its own side's clock. offsetUs
+// is the server clock minus the client's. However the round trip splits
+// between the two legs, the true offset is within errorBoundUs of it (half
+// the RTT, rounded up for the halving of an odd sum). The browser's
+// syncClock() in FrontEndTS/utils/espApi.ts does the same sums in ms.
+struct TimeExchange {
+  int64_t offsetUs;
+  int64_t rttUs;         // negative if a clock stepped mid-exchange
+  int64_t errorBoundUs;
+
+  bool valid() const { return rttUs >= 0; }
+};
+
+inline int64_t exchangeErrorBoundUs(int64_t rttUs) { return (rttUs + 1) / 2; }
+
+inline TimeExchange timeExchange(int64_t t1, int64_t t2, int64_t t3, int64_t t4)
+{
+  TimeExchange x;
+  x.rttUs = (t4 - t1) - (t3 - t2);
+  x.offsetUs = ((t2 - t1) + (t3 - t4)) / 2;
+  x.errorBoundUs = exchangeErrorBoundUs(x.rttUs);
+  return x;
+}
+
+// Estimates how a node's esp_timer clock maps onto the coordinator's from
+// NTP-style exchanges: t1 node send, t2 coordinator receive, t3
+// coordinator send, t4 node receive (all in µs).
+//
+// Each window of WINDOW exchanges contributes its lowest-RTT exchange as an
+// anchor, since WiFi queueing delay is one-sided and the fastest exchange is
+// the least skewed. A least-squares line through the last ANCHORS anchors
+// gives offset and drift; until there are enough anchors the best single
+// exchange is used as is.
+class ClockSync {
+public:
+  static const int WINDOW = 8;
+  static const int ANCHORS = 16;
+  static const int MIN_FIT_ANCHORS = 3;
+  // Assumed residual drift when converting, before and after a drift fit.
+  static const uint32_t UNFIT_DRIFT_PPM = 50;
+  static const uint32_t FIT_DRIFT_PPM = 2;
+
+  void addSample(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+    TimeExchange x = timeExchange(t1, t2, t3, t4);
+    if (!x.valid()) return;
+    Sample& s = window_[windowCount_++];
+    s.offset = x.offsetUs;
+    s.localUs = t1 + (t4 - t1) / 2;
+    s.rtt = (uint32_t)x.rttUs;
+    samples_++;
+    if (windowCount_ < WINDOW && anchorCount_ > 0) {
+      // Adopt a faster exchange right away; otherwise wait for the window.
+      if (s.rtt < best_.rtt) best_ = s;
+      return;
+    }
+    Sample best = window_[0];
+    for (int k = 1; k < windowCount_; k++) {
+      if (window_[k].rtt < best.rtt) best = window_[k];
+    }
+    best_ = best;
+    // The very first exchange is anchored on its own; if it is still the
+    // best of its window it must not count twice in the fit.
+    bool anchored = anchorCount_ > 0 && newestAnchor().localUs == best.localUs;
+    if ((windowCount_ == WINDOW || anchorCount_ == 0) && !anchored) addAnchor(best);
+    if (windowCount_ == WINDOW) windowCount_ = 0;
+  }
+
+  bool synced() const { return anchorCount_ > 0; }
+
+  // Node-local µs -> coordinator µs.
+  int64_t toRemote(int64_t localUs) const { return localUs + offsetAt(localUs); }
+
+  // The best exchange's bound (the most its asymmetry can hide) plus the
+  // fit residual, plus residual drift since the newest anchor.
+  uint32_t errorBoundUs(int64_t localUs) const {
+    bool fit = anchorCount_ >= MIN_FIT_ANCHORS;
+    int64_t age = localUs - (fit ? newestAnchor().localUs : best_.localUs);
+    if (age < 0) age = -age;
+    uint32_t ppm = fit ? FIT_DRIFT_PPM : UNFIT_DRIFT_PPM;
+    return (uint32_t)exchangeErrorBoundUs(best_.rtt) + (fit ? residualUs_ : 0) + (uint32_t)(age * ppm / 1000000);
+  }
+
+  int64_t offsetUs() const { return best_.offset; }
+  float driftPpm() const { return driftPpm_; }
+  uint32_t rttUs() const { return best_.rtt; }
+  uint32_t samples() const { return samples_; }
+  int anchors() const { return anchorCount_; }
+
+private:
+  struct Sample {
+    int64_t offset;
+    int64_t localUs;
+    uint32_t rtt;
+  };
+
+  const Sample& newestAnchor() const { return anchors_[(anchorStart_ + anchorCount_ - 1) % ANCHORS]; }
+
+  int64_t offsetAt(int64_t localUs) const {
+    if (anchorCount_ < MIN_FIT_ANCHORS) return best_.offset;
+    float x = (float)(localUs - fitOriginUs_) / 1e6f;
+    return fitOffsetUs_ + (int64_t)(fitInterceptUs_ + driftPpm_ * x);
+  }
+
+  void addAnchor(const Sample& s) {
+    anchors_[(anchorStart_ + anchorCount_) % ANCHORS] = s;
+    if (anchorCount_ == ANCHORS) anchorStart_ = (anchorStart_ + 1) % ANCHORS;
+    else anchorCount_++;
+    if (anchorCount_ < 2) return;
+    // Least squares of offset against local time, relative to the first
+    // anchor to keep the numbers small.
+    const Sample& a0 = anchors_[anchorStart_];
+    float sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (int k = 0; k < anchorCount_; k++) {
+      const Sample& a = anchors_[(anchorStart_ + k) % ANCHORS];
+      float x = (float)(a.localUs - a0.localUs) / 1e6f;  // s
+      float y = (float)(a.offset - a0.offset);           // µs
+      sx += x; sy += y; sxx += x * x; sxy += x * y;
+    }
+    float n = (float)anchorCount_;
+    float den = n * sxx - sx * sx;
+    if (den < 1e-6f) return;
+    driftPpm_ = (n * sxy - sx * sy) / den;  // µs per s = ppm
+    fitInterceptUs_ = (sy - driftPpm_ * sx) / n;
+    fitOriginUs_ = a0.localUs;
+    fitOffsetUs_ = a0.offset;
+    float worst = 0;
+    for (int k = 0; k < anchorCount_; k++) {
+      const Sample& a = anchors_[(anchorStart_ + k) % ANCHORS];
+      float e = (float)(a.offset - a0.offset) - (fitInterceptUs_ + driftPpm_ * (float)(a.localUs - a0.localUs) / 1e6f);
+      if (e < 0) e = -e;
+      if (e > worst) worst = e;
+    }
+    residualUs_ = (uint32_t)worst;
+  }
+
+  Sample window_[WINDOW];
+  int windowCount_ = 0;
+  Sample best_ = {0, 0, 0};
+  Sample anchors_[ANCHORS];
+  int anchorStart_ = 0;
+  int anchorCount_ = 0;
+  float driftPpm_ = 0;
+  float fitInterceptUs_ = 0;  // fitted offset at fitOriginUs_, minus fitOffsetUs_
+  int64_t fitOriginUs_ = 0;
+  int64_t fitOffsetUs_ = 0;
+  uint32_t residualUs_ = 0;
+  uint32_t samples_ = 0;
+};
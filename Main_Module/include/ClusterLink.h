@@ -0,0 +1,125 @@
+#pragma once
+
+#include <functional>
+#include "Hal.h"
+#include "ClusterUdp.h"
+#include "ClusterProtocol.h"
+#include "ClockSync.h"
+
+#ifndef CLUSTER_PORT
+#define CLUSTER_PORT 4210
+#endif
+
+// UDP link between the boards of a buzzer cluster.
+//
+// Nodes timestamp presses locally, keep their clock mapped onto the
+// coordinator's with periodic sync exchanges (see ClockSync), and send each
+// press already converted to coordinator time, retransmitting until it is
+// acknowledged. The coordinator filters duplicates, hands presses to its
+// arbiter, and tells nodes about rounds and finishing places so their LEDs
+// and buzzers follow along; those are retransmitted until acknowledged too
+// (see ClusterProtocol.h). Either way a message is acknowledged once its
+// handler has taken it (or it is a repeat of one that was); a handler that
+// returns false gets it again with the next retransmit.
+//
+// Each board draws a boot epoch and sends it with every message. When a
+// node's epoch changes the coordinator forgets its seqs, since a rebooted
+// node numbers its presses from 1 again; when the coordinator's changes a
+// node drops its clock estimate, since the coordinator's clock restarted.
+//
+// poll() does all socket I/O and runs the handlers; call it from one task
+// only. On the host the socket is a SimUdp (ClusterUdp.h), which is how the
+// native tests run several boards in one process.
+class ClusterLink {
+public:
+  enum Role : uint8_t { STANDALONE = 0, COORDINATOR = 1, NODE = 2 };
+
+  typedef std::function<bool(uint8_t board, uint8_t station, int64_t timeUs, uint32_t errorUs, bool tie)> PressHandler;
+  typedef std::function<bool(uint8_t action, uint32_t durationMs)> RoundHandler;
+  typedef std::function<bool(uint8_t station, uint8_t place)> PlaceHandler;
+
+  static const int MAX_BOARDS = 8;           // board ids 0 (coordinator) .. 7
+  static const int MAX_PENDING = 16;         // unacknowledged presses per node
+  static_assert(MAX_PENDING < (int)SeqWindow::SPAN, "an unacknowledged press must stay within the duplicate window");
+  static const int MAX_CONTROL = 16;         // unacknowledged ROUND/PLACE per node
+  static const unsigned long SYNC_INTERVAL_MS = 250;
+  static const unsigned long RESEND_MS = 20;
+
+  struct Peer {
+    bool known;
+    uint32_t ip;
+    uint16_t port;
+    unsigned long lastSeenMs;
+    uint32_t epoch;
+    uint32_t restarts;  // epoch changes seen after the first contact
+    uint32_t presses;
+    uint32_t lastErrorUs;
+    SeqWindow seqs;
+    // ROUND/PLACE not yet acknowledged, oldest first
+    ClusterMsg control[MAX_CONTROL];
+    int controlStart;
+    int controlCount;
+    uint32_t controlSeq;
+    uint32_t controlDropped;
+  };
+
+  ClusterLink();
+
+  void begin(Role role, uint8_t board, uint32_t coordinatorIp);
+  void poll(unsigned long nowMs);
+
+  Role role() const { return role_; }
+  uint8_t board() const { return board_; }
+  uint32_t epoch() const { return epoch_; }
+
+  // Node side.
+  void onRound(RoundHandler handler) { roundHandler_ = handler; }
+  void onPlace(PlaceHandler handler) { placeHandler_ = handler; }
+  void sendPress(uint8_t station, int64_t localUs, bool tie);
+  const ClockSync& clock() const { return clock_; }
+  int pending() const { return pendingCount_; }
+  uint32_t droppedPresses() const { return droppedPresses_; }
+  uint32_t controlApplied() const { return controlApplied_; }
+
+  // Coordinator side.
+  void onPress(PressHandler handler) { pressHandler_ = handler; }
+  void sendRound(uint8_t action, uint32_t durationMs);
+  void sendPlace(uint8_t board, uint8_t station, uint8_t place);
+  const Peer& peer(int board) const { return peers_[board]; }
+
+private:
+  struct Pending {
+    uint32_t seq;
+    uint8_t station;
+    bool tie;
+    int64_t localUs;
+  };
+
+  void receive(unsigned long nowMs);
+  void handle(const ClusterMsg& m, uint32_t ip, uint16_t port, int64_t rxUs, unsigned long nowMs);
+  void send(uint32_t ip, uint16_t port, ClusterMsg& m);
+  void sendPending(unsigned long nowMs);
+  void queueControl(uint8_t board, ClusterMsg& m);
+  void sendControl(unsigned long nowMs);
+
+  HalUdp udp_;
+  Role role_;
+  uint8_t board_;
+  uint32_t epoch_;
+  uint32_t coordinator_;
+  uint32_t coordinatorEpoch_;
+  ClockSync clock_;
+  uint32_t syncSeq_;
+  unsigned long lastSyncMs_;
+  Pending pending_[MAX_PENDING];
+  int pendingStart_;
+  int pendingCount_;
+  uint32_t pressSeq_;
+  uint32_t droppedPresses_;
+  unsigned long lastResendMs_;
+  uint32_t controlApplied_;
+  Peer peers_[MAX_BOARDS];
+  PressHandler pressHandler_;
+  RoundHandler roundHandler_;
+  PlaceHandler placeHandler_;
+};
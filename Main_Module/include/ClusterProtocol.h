@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Datagrams between a cluster coordinator (board 0) and its nodes. Every
+// message has the same 40-byte little-endian layout; fields a type does not
+// use are zero.
+//
+//   u8 type, u8 board, u8 a, u8 b, u32 seq, i64 t1, i64 t2, i64 t3, u32 value,
+//   u32 epoch
+//
+// SYNC_REQ   node -> coord   seq, t1 = node send time
+// SYNC_RESP  coord -> node   seq, t1 echoed, t2 = coord receive, t3 = coord send
+// PRESS      node -> coord   a = local station, b = flags, seq,
+//                            t1 = press time in coordinator µs, value = error bound µs
+// PRESS_ACK  coord -> node   seq
+// ROUND      coord -> node   a = action, value = duration ms, seq, t1 = base
+// PLACE      coord -> node   a = local station, b = place (0 = first), seq, t1 = base
+// CTRL_ACK   node -> coord   seq = last ROUND/PLACE seq applied
+//
+// ROUND and PLACE share one seq space per node and are applied strictly in
+// seq order, so a retransmitted round start cannot land after the places
+// that followed it. The coordinator resends every unacknowledged one;
+// base is the oldest it still holds, and a node that is behind base skips
+// ahead to it rather than wait for messages that will never come.
+//
+// Times are esp_timer µs. board is always the node's id. epoch is drawn at
+// random when the sender boots: seqs and clock offsets from before a reboot
+// mean nothing after it, and a changed epoch is how the other side knows.
+
+enum ClusterMsgType : uint8_t {
+  CLUSTER_SYNC_REQ = 1,
+  CLUSTER_SYNC_RESP = 2,
+  CLUSTER_PRESS = 3,
+  CLUSTER_PRESS_ACK = 4,
+  CLUSTER_ROUND = 5,
+  CLUSTER_PLACE = 6,
+  CLUSTER_CTRL_ACK = 7,
+};
+
+enum ClusterRoundAction : uint8_t { CLUSTER_ROUND_START = 0, CLUSTER_ROUND_RESET = 1, CLUSTER_ROUND_END = 2 };
+
+const uint8_t CLUSTER_PRESS_TIE = 0x01;
+const size_t CLUSTER_MSG_LEN = 40;
+
+struct ClusterMsg {
+  uint8_t type;
+  uint8_t board;
+  uint8_t a;
+  uint8_t b;
+  uint32_t seq;
+  int64_t t1;
+  int64_t t2;
+  int64_t t3;
+  uint32_t value;
+  uint32_t epoch;
+};
+
+inline void clusterPutU32(uint8_t* p, uint32_t v) {
+  for (int k = 0; k < 4; k++) p[k] = (uint8_t)(v >> (8 * k));
+}
+inline void clusterPutI64(uint8_t* p, int64_t v) {
+  for (int k = 0; k < 8; k++) p[k] = (uint8_t)((uint64_t)v >> (8 * k));
+}
+inline uint32_t clusterGetU32(const uint8_t* p) {
+  uint32_t v = 0;
+  for (int k = 0; k < 4; k++) v |= (uint32_t)p[k] << (8 * k);
+  return v;
+}
+inline int64_t clusterGetI64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int k = 0; k < 8; k++) v |= (uint64_t)p[k] << (8 * k);
+  return (int64_t)v;
+}
+
+inline size_t clusterEncode(uint8_t* out, const ClusterMsg& m) {
+  out[0] = m.type;
+  out[1] = m.board;
+  out[2] = m.a;
+  out[3] = m.b;
+  clusterPutU32(out + 4, m.seq);
+  clusterPutI64(out + 8, m.t1);
+  clusterPutI64(out + 16, m.t2);
+  clusterPutI64(out + 24, m.t3);
+  clusterPutU32(out + 32, m.value);
+  clusterPutU32(out + 36, m.epoch);
+  return CLUSTER_MSG_LEN;
+}
+
+inline bool clusterDecode(const uint8_t* in, size_t len, ClusterMsg& m) {
+  if (len != CLUSTER_MSG_LEN) return false;
+  m.type = in[0];
+  m.board = in[1];
+  m.a = in[2];
+  m.b = in[3];
+  m.seq = clusterGetU32(in + 4);
+  m.t1 = clusterGetI64(in + 8);
+  m.t2 = clusterGetI64(in + 16);
+  m.t3 = clusterGetI64(in + 24);
+  m.value = clusterGetU32(in + 32);
+  m.epoch = clusterGetU32(in + 36);
+  return m.type >= CLUSTER_SYNC_REQ && m.type <= CLUSTER_CTRL_ACK;
+}
+
+// Duplicate filter for PRESS seqs from one boot of a node: remembers the
+// highest seq seen and which of the SPAN before it arrived, so retransmits
+// and reordering are both handled. check() and mark() are separate so a
+// press is only marked once it has been taken; anything further back than
+// SPAN cannot be told apart any more and is TOO_OLD.
+struct SeqWindow {
+  enum Verdict : uint8_t { FRESH, DUPLICATE, TOO_OLD };
+  static const uint32_t SPAN = 32;
+
+  uint32_t highest = 0;
+  uint32_t seen = 0;  // bit k = highest - k received
+  bool any = false;
+
+  Verdict check(uint32_t seq) const {
+    if (!any || (int32_t)(seq - highest) > 0) return FRESH;
+    uint32_t back = highest - seq;
+    if (back >= SPAN) return TOO_OLD;
+    return (seen & (1u << back)) ? DUPLICATE : FRESH;
+  }
+
+  void mark(uint32_t seq) {
+    if (!any || (int32_t)(seq - highest) > 0) {
+      uint32_t shift = any ? seq - highest : SPAN;
+      seen = shift >= SPAN ? 1 : (seen << shift) | 1;
+      highest = seq;
+      any = true;
+      return;
+    }
+    uint32_t back = highest - seq;
+    if (back < SPAN) seen |= 1u << back;
+  }
+};
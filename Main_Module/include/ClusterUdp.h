@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The datagram socket the cluster link needs, on WiFiUDP on the device and
+// on an in-memory network on the host. Addresses are IPv4 addresses as
+// IPAddress converts them to uint32_t.
+//
+//   begin(port)                          bind
+//   send(ip, port, data, len)
+//   receive(buf, cap, ip, port)          the next waiting datagram, cut to
+//                                        cap bytes: its length, or -1 if
+//                                        there is none
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+class WiFiUdpSocket {
+public:
+  bool begin(uint16_t port) { return udp_.begin(port); }
+
+  void send(uint32_t ip, uint16_t port, const uint8_t* data, size_t len) {
+    udp_.beginPacket(IPAddress(ip), port);
+    udp_.write(data, len);
+    udp_.endPacket();
+  }
+
+  int receive(uint8_t* buf, size_t cap, uint32_t& ip, uint16_t& port) {
+    if (udp_.parsePacket() <= 0) return -1;
+    ip = (uint32_t)udp_.remoteIP();
+    port = udp_.remotePort();
+    int n = udp_.read(buf, cap);
+    return n < 0 ? 0 : n;
+  }
+
+private:
+  WiFiUDP udp_;
+};
+
+typedef WiFiUdpSocket HalUdp;
+
+#else
+#include <deque>
+#include <functional>
+#include <vector>
+#include "Hal.h"
+
+// One shared network for every SimUdp in the process. Datagrams arrive
+// latencyUs later on the virtual clock, in the order they were sent; `drop`
+// decides which ones are lost. Sockets get the addresses 1, 2, 3, ... in
+// the order they are bound, unless rebind(ip) hands the next one an old
+// address, as DHCP would a board that rebooted. reset() empties the
+// network and starts over.
+class SimUdpNet {
+public:
+  struct Datagram {
+    uint64_t atUs;
+    uint32_t fromIp;
+    uint16_t fromPort;
+    uint32_t toIp;
+    uint16_t toPort;
+    std::vector<uint8_t> data;
+  };
+
+  static SimUdpNet& instance() {
+    static SimUdpNet net;
+    return net;
+  }
+
+  void reset() {
+    queue_.clear();
+    nextIp_ = 1;
+    rebindIp_ = 0;
+    latencyUs = 1000;
+    drop = nullptr;
+    sent = 0;
+    lost = 0;
+  }
+
+  uint32_t bind() {
+    uint32_t ip = rebindIp_ ? rebindIp_ : nextIp_++;
+    rebindIp_ = 0;
+    return ip;
+  }
+  void rebind(uint32_t ip) { rebindIp_ = ip; }
+
+  void send(const Datagram& d) {
+    sent++;
+    if (drop && drop(d)) {
+      lost++;
+      return;
+    }
+    queue_.push_back(d);
+    queue_.back().atUs = halMicros() + latencyUs;
+  }
+
+  bool receive(uint32_t ip, uint16_t port, Datagram& out) {
+    for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+      if (it->toIp != ip || it->toPort != port || it->atUs > halMicros()) continue;
+      out = *it;
+      queue_.erase(it);
+      return true;
+    }
+    return false;
+  }
+
+  uint32_t latencyUs = 1000;
+  std::function<bool(const Datagram&)> drop;
+  uint32_t sent = 0;
+  uint32_t lost = 0;
+
+private:
+  std::deque<Datagram> queue_;
+  uint32_t nextIp_ = 1;
+  uint32_t rebindIp_ = 0;
+};
+
+class SimUdp {
+public:
+  bool begin(uint16_t port) {
+    ip = SimUdpNet::instance().bind();
+    port_ = port;
+    return true;
+  }
+
+  void send(uint32_t toIp, uint16_t toPort, const uint8_t* data, size_t len) {
+    SimUdpNet::Datagram d;
+    d.fromIp = ip;
+    d.fromPort = port_;
+    d.toIp = toIp;
+    d.toPort = toPort;
+    d.data.assign(data, data + len);
+    SimUdpNet::instance().send(d);
+  }
+
+  int receive(uint8_t* buf, size_t cap, uint32_t& fromIp, uint16_t& fromPort) {
+    SimUdpNet::Datagram d;
+    if (ip == 0 || !SimUdpNet::instance().receive(ip, port_, d)) return -1;
+    fromIp = d.fromIp;
+    fromPort = d.fromPort;
+    size_t n = d.data.size() < cap ? d.data.size() : cap;
+    for (size_t k = 0; k < n; k++) buf[k] = d.data[k];
+    return (int)n;
+  }
+
+  uint32_t ip = 0;
+
+private:
+  uint16_t port_ = 0;
+};
+
+typedef SimUdp HalUdp;
+#endif
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The few file operations the press journal needs, on LittleFS on the
+// device and on a file-backed flash emulator on the host. Paths are
+// absolute ("/journal/00000001.bin"); files are only ever appended to,
+// read at an offset, or removed whole.
+//
+//   begin()                     mount (formatting a blank partition)
+//   mkdir(dir)                  create dir if it is missing
+//   append(path, data, len)     returns the bytes written
+//   read(path, off, buf, len)   returns the bytes read, 0 past the end
+//   size(path)                  0 if missing
+//   remove(path)
+//   list(dir, fn)               fn(name) for every file in dir, no path
+//   totalBytes(), usedBytes()
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <LittleFS.h>
+
+class LittleFsFlash {
+public:
+  bool begin() { return LittleFS.begin(true); }
+  bool mkdir(const char* dir) { return LittleFS.exists(dir) || LittleFS.mkdir(dir); }
+
+  size_t append(const char* path, const uint8_t* data, size_t len) {
+    File f = LittleFS.open(path, FILE_APPEND);
+    if (!f) return 0;
+    size_t n = f.write(data, len);
+    f.close();
+    return n;
+  }
+
+  size_t read(const char* path, uint32_t offset, uint8_t* buf, size_t len) {
+    File f = LittleFS.open(path, FILE_READ);
+    if (!f) return 0;
+    size_t n = (f.size() > offset && f.seek(offset)) ? f.read(buf, len) : 0;
+    f.close();
+    return n;
+  }
+
+  uint32_t size(const char* path) {
+    if (!LittleFS.exists(path)) return 0;
+    File f = LittleFS.open(path, FILE_READ);
+    uint32_t n = f ? f.size() : 0;
+    f.close();
+    return n;
+  }
+
+  bool remove(const char* path) { return LittleFS.remove(path); }
+
+  template <typename Fn>
+  void list(const char* dir, Fn fn) {
+    File d = LittleFS.open(dir);
+    if (!d || !d.isDirectory()) return;
+    for (File f = d.openNextFile(); f; f = d.openNextFile()) {
+      if (!f.isDirectory()) fn(f.name());
+    }
+  }
+
+  size_t totalBytes() { return LittleFS.totalBytes(); }
+  size_t usedBytes() { return LittleFS.usedBytes(); }
+};
+
+typedef LittleFsFlash HalFlashFs;
+
+#else
+#include <stdio.h>
+#include <string>
+#include <filesystem>
+
+// Flash emulator for host builds: the files live under a host directory,
+// and the emulator keeps the costs that matter on the device.
+//
+// LittleFS copies a file's last, partly written block to a fresh one on
+// every write that ends in it, so each append is counted as one erase per
+// block it touches; `erases` is what the journal's batching is meant to
+// keep low. `capacity` bounds the partition. powerCut(n) lets the next n
+// bytes reach the files and then drops every write, as a brown-out in the
+// middle of an append would, until powerOn().
+class SimFlashFs {
+public:
+  static const uint32_t BLOCK_BYTES = 4096;
+
+  explicit SimFlashFs(const std::string& root, size_t capacity = 1472 * 1024)
+    : capacity(capacity), root_(root) {}
+
+  bool begin() {
+    std::error_code ec;
+    std::filesystem::create_directories(root_, ec);
+    return !ec;
+  }
+
+  bool mkdir(const char* dir) {
+    std::error_code ec;
+    std::filesystem::create_directories(root_ + dir, ec);
+    return !ec;
+  }
+
+  size_t append(const char* path, const uint8_t* data, size_t len) {
+    size_t room = capacity > usedBytes() ? capacity - usedBytes() : 0;
+    if (len > room) len = room;
+    if (cut_) {
+      if (len > cutBudget_) len = cutBudget_;
+      cutBudget_ -= len;
+    }
+    if (len == 0) return 0;
+    uint32_t before = size(path);
+    FILE* f = fopen((root_ + path).c_str(), "ab");
+    if (f == NULL) return 0;
+    size_t n = fwrite(data, 1, len, f);
+    fclose(f);
+    if (n > 0) erases += (before + n - 1) / BLOCK_BYTES - before / BLOCK_BYTES + 1;
+    programmedBytes += n;
+    return n;
+  }
+
+  size_t read(const char* path, uint32_t offset, uint8_t* buf, size_t len) {
+    FILE* f = fopen((root_ + path).c_str(), "rb");
+    if (f == NULL) return 0;
+    size_t n = fseek(f, offset, SEEK_SET) == 0 ? fread(buf, 1, len, f) : 0;
+    fclose(f);
+    return n;
+  }
+
+  uint32_t size(const char* path) {
+    std::error_code ec;
+    uintmax_t n = std::filesystem::file_size(root_ + path, ec);
+    return ec ? 0 : (uint32_t)n;
+  }
+
+  bool remove(const char* path) {
+    std::error_code ec;
+    return std::filesystem::remove(root_ + path, ec);
+  }
+
+  template <typename Fn>
+  void list(const char* dir, Fn fn) {
+    std::error_code ec;
+    for (const auto& e : std::filesystem::directory_iterator(root_ + dir, ec)) {
+      if (e.is_regular_file()) fn(e.path().filename().string().c_str());
+    }
+  }
+
+  size_t totalBytes() { return capacity; }
+  size_t usedBytes() {
+    size_t n = 0;
+    std::error_code ec;
+    for (const auto& e : std::filesystem::recursive_directory_iterator(root_, ec)) {
+      if (e.is_regular_file()) n += (e.file_size() + BLOCK_BYTES - 1) / BLOCK_BYTES * BLOCK_BYTES;
+    }
+    return n;
+  }
+
+  void powerCut(size_t afterBytes) { cut_ = true; cutBudget_ = afterBytes; }
+  void powerOn() { cut_ = false; }
+
+  size_t capacity;
+  uint32_t erases = 0;
+  uint64_t programmedBytes = 0;
+
+private:
+  std::string root_;
+  bool cut_ = false;
+  size_t cutBudget_ = 0;
+};
+
+typedef SimFlashFs HalFlashFs;
+#endif
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Hal.h"
+#include "GameEvents.h"
+#include "GameCues.h"
+#include "LatencyHistogram.h"
+#include "PressMerger.h"
+
+// Presses at most this far after the first of a group tie (see TieBreak).
+// 0 ties only identical timestamps, i.e. buttons seen in the same input
+// snapshot.
+#ifndef TIE_WINDOW_US
+#define TIE_WINDOW_US 1000
+#endif
+#ifndef TIE_BREAK
+#define TIE_BREAK TIE_BREAK_TIMESTAMP
+#endif
+
+// Round arbitration for N participants, free of any peripheral or RTOS
+// calls: presses and commands go in, NetEvents come out through `publish`,
+// and time comes from halMicros()/halMillis(). The device runs it in the
+// arbiter task; env:native runs it against simulated pins and a virtual
+// clock.
+//
+// Presses are merged into timestamp order and each one is released
+// mergeHoldUs after it happened, so on a cluster coordinator a remote press
+// that happened earlier but arrived later still goes first. Stations
+// 0..localStations-1 have LEDs on this board. With forwardPresses (cluster
+// nodes) presses are not arbitrated here but published as
+// NET_FORWARD_PRESS.
+//
+// Presses within tieWindowUs of the first press of a group form a tie
+// group. A group is placed once no further member can arrive, i.e.
+// tieWindowUs + mergeHoldUs after its first press, and ordered by the
+// TieBreak policy; with RANDOM the shuffle depends only on the round's seed
+// and the group's place, so a logged seed reproduces it.
+//
+// Duration and tie settings changed during a round apply from the next
+// start; the running round keeps what NET_ROUND_START announced.
+//
+// Leds is a LedPatternEngine, Tones a ToneSequencer. Not thread-safe; owned
+// by one task.
+template <int N, typename Leds, typename Tones>
+class GameCore {
+public:
+  typedef void (*PublishFn)(const NetEvent& e);
+
+  GameCore(Leds& leds, Tones& tones, PublishFn publish, int localStations, uint32_t mergeHoldUs,
+           bool forwardPresses)
+    : leds_(leds), tones_(tones), publish_(publish), localStations_(localStations),
+      holdUs_(mergeHoldUs), forward_(forwardPresses), tieWindowUs_(TIE_WINDOW_US), tieBreak_(TIE_BREAK),
+      seed_(0), nextDurationMs_(10000), nextTieWindowUs_(TIE_WINDOW_US), nextTieBreak_(TIE_BREAK),
+      active_(false), endRequested_(false), startMs_(0), startUs_(0), durationMs_(10000),
+      pressCount_(0), nextOrderNo_(0), groupSize_(0) {
+    for (int i = 0; i < N; i++) teamPattern_[i] = NULL;
+    clear();
+  }
+
+  // Per-participant LED effect instead of the by-place one; NULL restores it.
+  void setTeamPattern(int i, const LedPattern* p) { teamPattern_[i] = p; }
+
+  void command(const Command& c) {
+    if (c.type == CMD_START) start(c.value);
+    else if (c.type == CMD_RESET) reset();
+    else if (c.type == CMD_SET_DURATION) nextDurationMs_ = c.value;
+    else if (c.type == CMD_SET_TIE_WINDOW) nextTieWindowUs_ = c.value;
+    else if (c.type == CMD_SET_TIE_BREAK && c.value <= TIE_BREAK_JUDGE) nextTieBreak_ = (uint8_t)c.value;
+    else if (c.type == CMD_JUDGE_TIE) judge((int)c.value);
+    else if (c.type == CMD_END_ROUND) endRequested_ = active_;
+    else if (c.type == CMD_SHOW_PLACE) {
+      int station = c.value & 0xFF, place = c.value >> 8;
+      if (station < localStations_) {
+        unsigned long now = halMillis();
+        leds_.play(station, patternFor(station, place), now);
+        tones_.play(toneCueFor(place), now);
+      }
+    }
+  }
+
+  // An edge from this board's inputs. Edges are taken even between rounds
+  // so stale presses never leak into the next one.
+  void addLocalPress(const PressEvent& ev) {
+    if (!forward_) {
+      merger_.add(ev);
+      return;
+    }
+    if (!active_ || ev.level != LOW) return;
+    NetEvent e = {};
+    e.type = NET_FORWARD_PRESS;
+    e.teamIndex = (int8_t)ev.index;
+    e.timeUs = ev.timeUs;
+    e.tie = ev.tie;
+    publish_(e);
+  }
+
+  // A press from another board, already in local time and global numbering.
+  void addRemotePress(const PressEvent& ev) { merger_.add(ev); }
+
+  // Group the presses whose hold has expired and record the groups that are
+  // complete, then drive the LEDs, the buzzer and the round timer. Returns
+  // the next halMillis() deadline at which something has to happen, or 0 if
+  // none.
+  unsigned long service() {
+    PressEvent ev;
+    while (merger_.popReady(ev, halMicros(), holdUs_)) {
+      if (!active_ || ev.level != LOW || ev.index >= N || recorded_[ev.index]) continue;
+      if (ev.timeUs < startUs_) continue; // pressed before the round started
+      if (ev.timeUs - startUs_ >= (uint64_t)durationMs_ * 1000) continue; // after it ended
+      if (groupSize_ > 0 && ev.timeUs - group_[0].timeUs > tieWindowUs_) placeGroup();
+      recorded_[ev.index] = true;
+      group_[groupSize_++] = ev;
+    }
+    uint64_t groupDoneUs = groupSize_ ? group_[0].timeUs + tieWindowUs_ + holdUs_ : 0;
+    if (groupSize_ && (halMicros() >= groupDoneUs || !active_)) {
+      placeGroup();
+      groupDoneUs = 0;
+    }
+    unsigned long now = halMillis();
+    unsigned long next = tones_.update(now); // a cue can outlive the round
+    uint64_t mergeUs = merger_.nextReadyUs(holdUs_);
+    if (mergeUs) next = earliest(next, (unsigned long)((mergeUs + 999) / 1000));
+    if (groupDoneUs) next = earliest(next, (unsigned long)((groupDoneUs + 999) / 1000));
+    if (active_) {
+      // The round ends mergeHoldUs late so in-flight remote presses from its
+      // last moments still count.
+      uint64_t timerUs = startUs_ + (uint64_t)durationMs_ * 1000;
+      uint64_t endUs = timerUs + holdUs_;
+      next = earliest(next, earliest(leds_.update(now), (unsigned long)((endUs + 999) / 1000)));
+      if (endRequested_ || halMicros() >= endUs) {
+        endRequested_ = false;
+        if (groupSize_) placeGroup();
+        NetEvent e = {};
+        e.type = NET_ROUND_END;
+        e.pressCount = (int8_t)pressCount_;
+        // When the round ended, not when the hold let it close: the timer,
+        // or the end command if that came first.
+        e.timeUs = halMicros() < timerUs ? halMicros() : timerUs;
+        publish_(e);
+        active_ = false;
+        leds_.stopAll();
+        leds_.update(now);
+        tones_.play(&TONE_ROUND_END, now);
+        next = tones_.update(now);
+      }
+    }
+    return next;
+  }
+
+  bool active() const { return active_; }
+  unsigned long startMs() const { return startMs_; }
+  uint64_t startUs() const { return startUs_; }
+  // The settings of the current (or last) round; changes wait for the next.
+  unsigned long durationMs() const { return durationMs_; }
+  int pressCount() const { return pressCount_; }
+  int pressOrder(int k) const { return pressOrder_[k]; }
+  int orderNo(int i) const { return orderNo_[i]; }
+  // First place of participant i's tie group, or -1.
+  int tieGroup(int i) const { return tieGroup_[i]; }
+  // Tie group members still waiting for the judge.
+  int tiesPending() const {
+    int n = 0;
+    for (int i = 0; i < N; i++) n += awaitingJudge_[i] ? 1 : 0;
+    return n;
+  }
+  uint32_t tieWindowUs() const { return tieWindowUs_; }
+  uint8_t tieBreak() const { return tieBreak_; }
+  uint32_t seed() const { return seed_; }
+  uint32_t mergeDropped() const { return merger_.dropped(); }
+  // Edge -> press recorded. Owned by the arbiter; readers elsewhere can be
+  // one sample off, which is fine for telemetry.
+  const LatencyHistogram& pressToRecordUs() const { return pressToRecordUs_; }
+
+  // Soonest of two millis() deadlines, where 0 means "none".
+  static unsigned long earliest(unsigned long a, unsigned long b) {
+    if (a == 0) return b;
+    if (b == 0) return a;
+    return (b < a) ? b : a;
+  }
+
+private:
+  void clear() {
+    for (int i = 0; i < N; i++) {
+      pressOrder_[i] = -1;
+      recorded_[i] = false;
+      orderNo_[i] = -1;
+      tieGroup_[i] = -1;
+      awaitingJudge_[i] = false;
+    }
+    pressCount_ = 0;
+    nextOrderNo_ = 0;
+    groupSize_ = 0;
+  }
+
+  // Start a round with the duration and tie settings configured so far.
+  void start(uint32_t seed) {
+    clear();
+    durationMs_ = nextDurationMs_;
+    tieWindowUs_ = nextTieWindowUs_;
+    tieBreak_ = nextTieBreak_;
+    endRequested_ = false;
+    active_ = true;
+    startUs_ = halMicros();
+    startMs_ = (unsigned long)(startUs_ / 1000);
+    seed_ = seed ? seed : ((uint32_t)startUs_ * 2654435761u) | 1;
+    tones_.stop();
+    leds_.stopAll();
+    leds_.flashAllUntil(startMs_ + START_FLASH_MS);
+    NetEvent e = {};
+    e.type = NET_ROUND_START;
+    e.startMs = startMs_;
+    e.durationMs = durationMs_;
+    e.timeUs = startUs_;
+    e.tieBreak = tieBreak_;
+    e.tieWindowUs = tieWindowUs_;
+    e.seed = seed_;
+    publish_(e);
+  }
+
+  void reset() {
+    active_ = false;
+    clear();
+    leds_.stopAll();
+    leds_.update(halMillis());
+    tones_.stop();
+    NetEvent e = {};
+    e.type = NET_RESET;
+    e.timeUs = halMicros();
+    publish_(e);
+  }
+
+  // Order the pending group by the tie-break policy, give it the next
+  // places and record its members.
+  void placeGroup() {
+    int n = groupSize_;
+    groupSize_ = 0;
+    int first = nextOrderNo_;
+    nextOrderNo_ += n;
+    // The merger releases in timestamp order; identical timestamps go by index.
+    for (int a = 1; a < n; a++) {
+      for (int b = a; b > 0 && group_[b].timeUs == group_[b - 1].timeUs && group_[b].index < group_[b - 1].index; b--) {
+        PressEvent t = group_[b]; group_[b] = group_[b - 1]; group_[b - 1] = t;
+      }
+    }
+    if (n > 1 && tieBreak_ == TIE_BREAK_RANDOM) {
+      uint32_t x = seed_ ^ ((uint32_t)(first + 1) * 0x9E3779B9u);
+      for (int k = n - 1; k > 0; k--) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5; // xorshift32
+        int j = (int)(x % (uint32_t)(k + 1));
+        PressEvent t = group_[k]; group_[k] = group_[j]; group_[j] = t;
+      }
+    }
+    bool judged = n > 1 && tieBreak_ == TIE_BREAK_JUDGE;
+    for (int k = 0; k < n; k++) {
+      int i = group_[k].index;
+      tieGroup_[i] = n > 1 ? first : -1;
+      awaitingJudge_[i] = judged;
+      record(group_[k], judged ? first : first + k);
+    }
+  }
+
+  // Record one placed press and hand it to the network side.
+  void record(const PressEvent& ev, int place) {
+    unsigned long now = halMillis();
+    int i = ev.index;
+    orderNo_[i] = place;
+    if (pressCount_ < N) pressOrder_[pressCount_++] = i;
+    if (i < localStations_) leds_.play(i, patternFor(i, place), now);
+    tones_.play(toneCueFor(place), now);
+    uint64_t recordUs = halMicros();
+    pressToRecordUs_.record((uint32_t)(recordUs - ev.timeUs));
+
+    NetEvent e = {};
+    e.type = NET_PRESS;
+    e.teamIndex = (int8_t)i;
+    e.orderNo = (int8_t)place;
+    e.pressCount = (int8_t)pressCount_;
+    e.timeUs = ev.timeUs;
+    e.tie = tieGroup_[i] >= 0;
+    e.tieGroup = (int8_t)tieGroup_[i];
+    e.recordUs = (uint32_t)recordUs;
+    publish_(e);
+  }
+
+  // The judge places participant i next in its tie group. Once one member
+  // is left it takes the last place. Works until the next start or reset.
+  void judge(int i) {
+    if (i < 0 || i >= N || !awaitingJudge_[i]) return;
+    int group = tieGroup_[i], placed = 0, left = -1, waiting = 0;
+    for (int j = 0; j < N; j++) {
+      if (tieGroup_[j] != group) continue;
+      if (!awaitingJudge_[j]) placed++;
+      else if (j != i) { left = j; waiting++; }
+    }
+    place(i, group + placed);
+    if (waiting == 1) place(left, group + placed + 1);
+  }
+
+  // Give i its final place; the members still waiting share the next one.
+  void place(int i, int orderNo) {
+    awaitingJudge_[i] = false;
+    orderNo_[i] = orderNo;
+    for (int j = 0; j < N; j++) {
+      if (awaitingJudge_[j] && tieGroup_[j] == tieGroup_[i]) orderNo_[j] = orderNo + 1;
+    }
+    int k = 0;
+    while (pressOrder_[k] != i) k++;
+    for (; k > orderNo; k--) pressOrder_[k] = pressOrder_[k - 1];
+    pressOrder_[orderNo] = i;
+    if (i < localStations_) leds_.play(i, patternFor(i, orderNo), halMillis());
+    NetEvent e = {};
+    e.type = NET_TIE_RESOLVED;
+    e.teamIndex = (int8_t)i;
+    e.orderNo = (int8_t)orderNo;
+    e.tie = true;
+    e.tieGroup = (int8_t)tieGroup_[i];
+    publish_(e);
+  }
+
+  const LedPattern* patternFor(int team, int place) const {
+    return teamPattern_[team] != NULL ? teamPattern_[team] : ledPatternForPlace(place);
+  }
+
+  Leds& leds_;
+  Tones& tones_;
+  PublishFn publish_;
+  int localStations_;
+  uint32_t holdUs_;
+  bool forward_;
+  uint32_t tieWindowUs_;
+  uint8_t tieBreak_;
+  uint32_t seed_;
+  unsigned long nextDurationMs_;
+  uint32_t nextTieWindowUs_;
+  uint8_t nextTieBreak_;
+  PressMerger<PressEvent, 64> merger_;
+  LatencyHistogram pressToRecordUs_;
+  const LedPattern* teamPattern_[N];
+
+  bool active_;
+  bool endRequested_;
+  unsigned long startMs_;
+  uint64_t startUs_;
+  unsigned long durationMs_;
+  int pressOrder_[N];
+  bool recorded_[N];
+  int orderNo_[N];
+  int tieGroup_[N];
+  bool awaitingJudge_[N];
+  int pressCount_;
+  int nextOrderNo_;
+  PressEvent group_[N];  // tie group not yet placed, in timestamp order
+  int groupSize_;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include "LedOffload.h"
+#include "ToneSequencer.h"
+
+// Buzzer cues: one per finishing place, one for later presses and one for
+// the end of the round. Duty is out of 1023.
+const ToneStep FIRST_TONE[] = {{1800,255,80},{0,0,30},{2400,255,80},{0,0,30},{3000,255,160}};
+const ToneStep SECOND_TONE[] = {{2000,255,100},{0,0,40},{2400,255,120}};
+const ToneStep THIRD_TONE[] = {{2000,255,200}};
+const ToneStep OTHER_TONE[] = {{1500,255,120}};
+const ToneStep ROUND_END_TONE[] = {{2500,255,150},{0,0,50},{2000,255,150},{0,0,50},{1500,255,400}};
+const ToneCue TONE_FIRST = {FIRST_TONE, sizeof(FIRST_TONE)/sizeof(FIRST_TONE[0])};
+const ToneCue TONE_SECOND = {SECOND_TONE, sizeof(SECOND_TONE)/sizeof(SECOND_TONE[0])};
+const ToneCue TONE_THIRD = {THIRD_TONE, sizeof(THIRD_TONE)/sizeof(THIRD_TONE[0])};
+const ToneCue TONE_OTHER = {OTHER_TONE, sizeof(OTHER_TONE)/sizeof(OTHER_TONE[0])};
+const ToneCue TONE_ROUND_END = {ROUND_END_TONE, sizeof(ROUND_END_TONE)/sizeof(ROUND_END_TONE[0])};
+const ToneCue* const PLACE_TONE_CUES[] = {&TONE_FIRST, &TONE_SECOND, &TONE_THIRD};
+
+inline const ToneCue* toneCueFor(int place)
+{
+  const int places = sizeof(PLACE_TONE_CUES)/sizeof(PLACE_TONE_CUES[0]);
+  return place < places ? PLACE_TONE_CUES[place] : &TONE_OTHER;
+}
+
+// LED effects by finishing place; GameCore::setTeamPattern() overrides
+// them for one participant.
+const uint16_t FIRST_STEPS_MS[] = {120,60,120,60,120,500};  // triple blink
+const uint16_t SECOND_STEPS_MS[] = {120,80,120,600};        // double blink
+const uint16_t THIRD_STEPS_MS[] = {150,700};                // single blink
+const LedPattern LED_FIRST = {FIRST_STEPS_MS, sizeof(FIRST_STEPS_MS)/sizeof(FIRST_STEPS_MS[0])};
+const LedPattern LED_SECOND = {SECOND_STEPS_MS, sizeof(SECOND_STEPS_MS)/sizeof(SECOND_STEPS_MS[0])};
+const LedPattern LED_THIRD = {THIRD_STEPS_MS, sizeof(THIRD_STEPS_MS)/sizeof(THIRD_STEPS_MS[0])};
+const LedPattern LED_STEADY = {NULL, 0};
+const LedPattern* const PLACE_LED_PATTERNS[] = {&LED_FIRST, &LED_SECOND, &LED_THIRD};
+const unsigned long START_FLASH_MS = 200;
+
+inline const LedPattern* ledPatternForPlace(int place)
+{
+  const int places = sizeof(PLACE_LED_PATTERNS)/sizeof(PLACE_LED_PATTERNS[0]);
+  return place < places ? PLACE_LED_PATTERNS[place] : &LED_STEADY;
+}
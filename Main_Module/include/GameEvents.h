@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+// Records passed between the input ISR, the arbiter (GameCore) and the
+// network side. All of them are copied through SpscRings, so they stay
+// small and trivially copyable.
+
+// One debounced edge.
+struct PressEvent {
+  uint64_t timeUs; // halMicros() when the edge was seen
+  uint8_t index;   // participant index
+  uint8_t level;   // raw pin level in the input snapshot (LOW = down)
+  uint8_t tie;     // another button went down in the same snapshot
+};
+
+// How the arbiter orders presses that fall within the tie window of each
+// other. TIMESTAMP keeps timestamp order (index order for identical
+// timestamps) and only flags the tie; RANDOM shuffles the group with the
+// round's seed; JUDGE gives the group one shared place until
+// CMD_JUDGE_TIE picks the winners one by one.
+enum TieBreak : uint8_t { TIE_BREAK_TIMESTAMP, TIE_BREAK_RANDOM, TIE_BREAK_JUDGE };
+
+// Network -> arbiter. CMD_END_ROUND and CMD_SHOW_PLACE come from the
+// coordinator on node boards; CMD_SHOW_PLACE carries station | place << 8.
+// CMD_START carries the round's tie-break seed (0 = derive one),
+// CMD_JUDGE_TIE the participant the judge places next in its tie group.
+enum CommandType : uint8_t {
+  CMD_START, CMD_RESET, CMD_SET_DURATION, CMD_END_ROUND, CMD_SHOW_PLACE,
+  CMD_SET_TIE_WINDOW, CMD_SET_TIE_BREAK, CMD_JUDGE_TIE
+};
+struct Command {
+  uint8_t type;
+  uint32_t value;
+};
+
+// Arbiter -> network. NET_TIE_RESOLVED moves teamIndex to its final place
+// orderNo after a judge's decision.
+enum NetEventType : uint8_t {
+  NET_ROUND_START, NET_PRESS, NET_ROUND_END, NET_RESET, NET_FORWARD_PRESS, NET_TIE_RESOLVED
+};
+struct NetEvent {
+  uint8_t type;
+  int8_t teamIndex;    // NET_FORWARD_PRESS: local station
+  int8_t orderNo;      // shared by a tie group awaiting the judge
+  int8_t pressCount;   // NET_PRESS, NET_ROUND_END
+  uint32_t startMs;    // NET_ROUND_START
+  uint32_t durationMs; // NET_ROUND_START
+  uint64_t timeUs;     // NET_PRESS, NET_FORWARD_PRESS: edge time; NET_ROUND_START,
+                       // NET_ROUND_END, NET_RESET: when it happened (for
+                       // NET_ROUND_END at most start + duration)
+  bool tie;            // NET_PRESS: within the tie window of another press;
+                       // NET_FORWARD_PRESS: same snapshot as another press
+  int8_t tieGroup;     // NET_PRESS, NET_TIE_RESOLVED: first place of the group, when tie
+  uint8_t tieBreak;    // NET_ROUND_START: TieBreak in force
+  uint32_t seed;       // NET_ROUND_START: tie-break seed
+  uint32_t tieWindowUs; // NET_ROUND_START
+  uint32_t recordUs;   // NET_PRESS: low 32 bits of halMicros() when recorded
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include "GpioRegs.h"
+
+// Reads both GPIO input registers back to back and folds them into one
+// mask (bit i = input i is low, i.e. pressed). All inputs are sampled in
+// the same couple of bus cycles, so buttons that went down together are
+// seen together regardless of which interrupt is serviced first.
+//
+// Regs is the register backend: Esp32GpioRegs on the device, SimGpioRegs
+// for host traces.
+template <typename Regs, int N>
+class GpioInputSnapshot {
+  static_assert(N <= 32, "GpioInputSnapshot masks are 32 bits wide");
+
+public:
+  GpioInputSnapshot(Regs& regs, const int* pins) : regs_(regs) {
+    for (int i = 0; i < N; i++) {
+      bank_[i] = (uint8_t)(pins[i] >= 32 ? 1 : 0);
+      bit_[i] = 1u << (pins[i] & 31);
+    }
+  }
+
+  IRAM_ATTR uint32_t readDown() {
+    uint32_t in[2];
+    in[0] = regs_.read(0);
+    in[1] = regs_.read(1);
+    uint32_t down = 0;
+    for (int i = 0; i < N; i++) {
+      if ((in[bank_[i]] & bit_[i]) == 0) down |= 1u << i;
+    }
+    return down;
+  }
+
+private:
+  Regs& regs_;
+  uint8_t bank_[N];
+  uint32_t bit_[N];
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include "GpioRegs.h"
+
+// Applies a whole LED frame (bit i = output i on) with one write-1-to-set
+// and one write-1-to-clear register store per GPIO bank, so every LED
+// changes together instead of one digitalWrite at a time. Pins 0-31 are
+// bank 0 and pins 32-39 bank 1; banks with no outputs are never written.
+//
+// Regs is the register backend: Esp32GpioRegs on the device, SimGpioRegs
+// for host tests and benchmarks.
+template <typename Regs, int N>
+class GpioOutputBatch {
+  static_assert(N <= 32, "GpioOutputBatch frames are 32 bits wide");
+
+public:
+  GpioOutputBatch(Regs& regs, const int* pins) : regs_(regs) {
+    for (int b = 0; b < 2; b++) bankPins_[b] = 0;
+    for (int i = 0; i < N; i++) {
+      int bank = pins[i] >= 32 ? 1 : 0;
+      bank_[i] = (uint8_t)bank;
+      bit_[i] = 1u << (pins[i] & 31);
+      bankPins_[bank] |= bit_[i];
+    }
+  }
+
+  void apply(uint32_t frame) {
+    uint32_t on[2] = {0, 0};
+    for (int i = 0; i < N; i++) {
+      if (frame & (1u << i)) on[bank_[i]] |= bit_[i];
+    }
+    for (int b = 0; b < 2; b++) {
+      if (bankPins_[b] == 0) continue;
+      regs_.set(b, on[b]);
+      regs_.clear(b, bankPins_[b] & ~on[b]);
+    }
+  }
+
+private:
+  Regs& regs_;
+  uint8_t bank_[N];
+  uint32_t bit_[N];
+  uint32_t bankPins_[2];
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <soc/gpio_reg.h>
+#endif
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// GPIO register backends. Bank 0 covers pins 0-31 and bank 1 covers pins
+// 32-39. set/clear take write-1-to-set/clear masks; read returns the input
+// level register of a bank.
+
+#if defined(ARDUINO_ARCH_ESP32)
+struct Esp32GpioRegs {
+  IRAM_ATTR void set(int bank, uint32_t mask) {
+    if (mask) REG_WRITE(bank ? GPIO_OUT1_W1TS_REG : GPIO_OUT_W1TS_REG, mask);
+  }
+  IRAM_ATTR void clear(int bank, uint32_t mask) {
+    if (mask) REG_WRITE(bank ? GPIO_OUT1_W1TC_REG : GPIO_OUT_W1TC_REG, mask);
+  }
+  IRAM_ATTR uint32_t read(int bank) {
+    return REG_READ(bank ? GPIO_IN1_REG : GPIO_IN_REG);
+  }
+};
+#endif
+
+// Register model for host builds: keeps both output latches, counts
+// stores and remembers the last W1TS/W1TC mask written to each bank. Tests
+// drive `in` directly; inputs idle high (pulled up).
+struct SimGpioRegs {
+  uint32_t out[2] = {0, 0};
+  uint32_t in[2] = {0xFFFFFFFF, 0xFFFFFFFF};
+  uint32_t stores = 0;
+  uint32_t bankStores[2] = {0, 0};
+  uint32_t lastSet[2] = {0, 0};
+  uint32_t lastClear[2] = {0, 0};
+
+  void set(int bank, uint32_t mask) {
+    if (!mask) return;
+    out[bank] |= mask;
+    lastSet[bank] = mask;
+    bankStores[bank]++;
+    stores++;
+  }
+  void clear(int bank, uint32_t mask) {
+    if (!mask) return;
+    out[bank] &= ~mask;
+    lastClear[bank] = mask;
+    bankStores[bank]++;
+    stores++;
+  }
+  uint32_t read(int bank) { return in[bank]; }
+};
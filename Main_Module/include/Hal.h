@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Hardware abstraction for the game core. Everything above this header
+// (input scanning, arbitration, LED and buzzer sequencing, SSE fan-out) is
+// plain C++ and builds both for the ESP32 and for the host (env:native).
+//
+//   clock    halMicros() / halMillis(): esp_timer and millis() on the
+//            device, a virtual clock the simulation advances on the host
+//   GPIO     HalRegs: Esp32GpioRegs or SimGpioRegs (GpioRegs.h)
+//   PWM      HalToneOut: LedcToneOut or SimToneOut (ToneSequencer.h)
+//   sockets  HalStreamClient: AsyncClient or SimStreamClient, the subset
+//            SseHub writes to
+//   files    HalFlashFs: LittleFS or a file-backed flash emulator
+//            (FlashFs.h), for the press journal
+//   datagrams HalUdp: WiFiUDP or an in-memory network (ClusterUdp.h), for
+//            the cluster link
+//   random   halRandom(): esp_random() on the device, a fixed sequence on
+//            the host
+
+#include "GpioRegs.h"
+#include "ToneSequencer.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Arduino.h>
+#include <AsyncTCP.h>
+
+inline uint64_t halMicros() { return (uint64_t)esp_timer_get_time(); }
+inline unsigned long halMillis() { return millis(); }
+inline uint32_t halRandom() { return esp_random(); }
+
+typedef Esp32GpioRegs HalRegs;
+typedef LedcToneOut HalToneOut;
+typedef AsyncClient HalStreamClient;
+
+#else
+#include <atomic>
+#include <string>
+
+#ifndef LOW
+#define LOW 0x0
+#endif
+#ifndef HIGH
+#define HIGH 0x1
+#endif
+
+// Virtual clock for host builds. Nothing advances it but the simulation,
+// so runs are deterministic. Atomic so that threads standing in for the
+// two cores (src/stress/) can read it while one of them sets it.
+inline std::atomic<uint64_t>& simClockUs() {
+  static std::atomic<uint64_t> us(0);
+  return us;
+}
+inline void simClockSetUs(uint64_t us) { simClockUs().store(us, std::memory_order_relaxed); }
+inline void simClockAdvanceUs(uint64_t us) { simClockUs().fetch_add(us, std::memory_order_relaxed); }
+
+inline uint64_t halMicros() { return simClockUs().load(std::memory_order_relaxed); }
+inline unsigned long halMillis() { return (unsigned long)(halMicros() / 1000); }
+
+// xorshift32: different on every call, the same in every run.
+inline uint32_t halRandom() {
+  static uint32_t x = 0x9E3779B9u;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+// Stands in for an AsyncClient: a send window of `window` bytes that the
+// simulation reopens with ack(), and everything sent so far in `sent`.
+struct SimStreamClient {
+  size_t window = 5744;
+  size_t inFlight = 0;
+  std::string pending;
+  std::string sent;
+  uint32_t sends = 0;
+  bool closed = false;
+
+  size_t space() const { return closed ? 0 : window - inFlight - pending.size(); }
+  size_t add(const char* data, size_t len) {
+    size_t n = len < space() ? len : space();
+    pending.append(data, n);
+    return n;
+  }
+  bool send() {
+    inFlight += pending.size();
+    sent += pending;
+    pending.clear();
+    sends++;
+    return true;
+  }
+  void ack(size_t len) { inFlight = len < inFlight ? inFlight - len : 0; }
+  void close(bool = false) { closed = true; }
+};
+
+typedef SimGpioRegs HalRegs;
+typedef SimToneOut HalToneOut;
+typedef SimStreamClient HalStreamClient;
+#endif
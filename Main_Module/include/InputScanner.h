@@ -0,0 +1,169 @@
+#pragma once
+
+#include <stdint.h>
+#include "GameEvents.h"
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+// Default settle times. Pins with a 10 kΩ external pull-up (GPIO 34/35/36/39
+// on the direct wiring) recover faster than the ~45 kΩ internal ones, so
+// they get a shorter window.
+#ifndef DEBOUNCE_US
+#define DEBOUNCE_US 5000
+#endif
+#ifndef DEBOUNCE_US_EXT_PULLUP
+#define DEBOUNCE_US_EXT_PULLUP 3000
+#endif
+// Presses are reported when they settle but stamped with their first edge,
+// so the arbiter holds them this long to let a bouncier press that started
+// earlier catch up before the order is fixed.
+#ifndef INPUT_ORDER_HOLD_MS
+#define INPUT_ORDER_HOLD_MS 15
+#endif
+
+// Integrating debouncer: turns input snapshots (bit i = station i down)
+// into one PressEvent per settled press and release.
+//
+// Each channel is idle at its debounced level until an edge or a snapshot
+// shows it elsewhere. From that first edge on, the channel integrates the
+// time spent at the new level against the time spent back at the old one;
+// once the new level is ahead by the channel's settle time the transition
+// is reported, stamped with the first edge. A transition that falls back
+// to the old level and stays there for the settle time is a glitch and is
+// dropped. Bounces cost settle time but never move the timestamp, and a
+// press whose pin has already bounced back by the time the ISR reads it
+// still counts from its edge.
+//
+// Two presses are a tie when they start from the same snapshot.
+//
+// scan() runs in ISR context on the device (pin interrupts and a scan
+// timer on the same core, which do not nest); the simulation calls it
+// directly. The counters are written only there and can be read anywhere.
+template <int N>
+class InputScanner {
+  static_assert(N <= 32, "InputScanner masks are 32 bits wide");
+
+public:
+  struct ChannelStats {
+    uint32_t presses;
+    uint32_t releases;
+    uint32_t bounces;   // level flips while a transition was settling
+    uint32_t glitches;  // transitions that fell back without settling
+  };
+
+  explicit InputScanner(uint32_t settleUs = DEBOUNCE_US) : stable_(0), level_(0), pending_(0) {
+    for (int i = 0; i < N; i++) {
+      settleUs_[i] = settleUs;
+      firstUs_[i] = 0;
+      lastUs_[i] = 0;
+      flipUs_[i] = 0;
+      aheadUs_[i] = 0;
+      downSinceMs_[i] = 0;
+      stats_[i] = ChannelStats();
+    }
+  }
+
+  // Per-channel settle time. Set it before inputs are attached.
+  void setSettleUs(int i, uint32_t us) { settleUs_[i] = us; }
+  uint32_t settleUs(int i) const { return settleUs_[i]; }
+
+  // Feed one snapshot taken at nowUs. `changed` marks pins whose interrupt
+  // fired, i.e. that left their level at nowUs even if the snapshot no
+  // longer shows it; scan timers pass 0. Pushes the settled transitions to
+  // out (anything with push(const PressEvent&), e.g. an SpscRing) and
+  // returns how many there were.
+  template <typename Sink>
+  IRAM_ATTR int scan(uint32_t down, uint32_t changed, uint64_t nowUs, Sink& out) {
+    uint32_t active = pending_ | ((down ^ stable_) & MASK) | (changed & MASK);
+    int n = 0;
+    for (int i = 0; active != 0; i++, active >>= 1) {
+      if (!(active & 1)) continue;
+      uint32_t bit = 1u << i;
+      bool stable = (stable_ & bit) != 0;
+      bool now = (down & bit) != 0;
+      if (!(pending_ & bit)) {
+        // The pin left its debounced level at nowUs.
+        pending_ |= bit;
+        firstUs_[i] = nowUs;
+        lastUs_[i] = nowUs;
+        flipUs_[i] = nowUs;
+        aheadUs_[i] = 0;
+        if (now == stable) stats_[i].bounces++; // already back when read
+        setLevel(bit, now);
+        continue;
+      }
+      bool was = (level_ & bit) != 0;
+      uint32_t dt = (uint32_t)(nowUs - lastUs_[i]);
+      lastUs_[i] = nowUs;
+      if (was != stable) aheadUs_[i] += dt;
+      else aheadUs_[i] = aheadUs_[i] > dt ? aheadUs_[i] - dt : 0;
+      if (now != was) stats_[i].bounces++;
+      if (now != was || (changed & bit)) flipUs_[i] = nowUs;
+      setLevel(bit, now);
+      if (aheadUs_[i] >= settleUs_[i]) {
+        settle(i, out);
+        n++;
+      } else if (now == stable && nowUs - flipUs_[i] >= settleUs_[i]) {
+        pending_ &= ~bit;
+        stats_[i].glitches++;
+      }
+    }
+    return n;
+  }
+
+  // Debounced state, bit i = station i held down.
+  uint32_t downMask() const { return stable_; }
+  // millis() at which station i was last pressed, while it is held.
+  unsigned long downSinceMs(int i) const { return downSinceMs_[i]; }
+  const ChannelStats& stats(int i) const { return stats_[i]; }
+
+private:
+  static const uint32_t MASK = (N == 32) ? 0xFFFFFFFFu : ((1u << (N % 32)) - 1);
+
+  IRAM_ATTR void setLevel(uint32_t bit, bool down) {
+    if (down) level_ |= bit;
+    else level_ &= ~bit;
+  }
+
+  template <typename Sink>
+  IRAM_ATTR void settle(int i, Sink& out) {
+    uint32_t bit = 1u << i;
+    pending_ &= ~bit;
+    stable_ ^= bit;
+    bool pressed = (stable_ & bit) != 0;
+    PressEvent ev;
+    ev.timeUs = firstUs_[i];
+    ev.index = (uint8_t)i;
+    ev.level = pressed ? 0 : 1; // pin level, LOW (0) = down
+    ev.tie = 0;
+    if (pressed) {
+      stats_[i].presses++;
+      downSinceMs_[i] = (unsigned long)(firstUs_[i] / 1000);
+      // A tie partner started in the same snapshot and is either settled
+      // down or still settling towards down.
+      for (int j = 0; j < N && !ev.tie; j++) {
+        uint32_t b = 1u << j;
+        if (j == i || firstUs_[j] != firstUs_[i]) continue;
+        bool settling = (pending_ & b) && !(stable_ & b);
+        bool held = !(pending_ & b) && (stable_ & b);
+        ev.tie = settling || held;
+      }
+    } else {
+      stats_[i].releases++;
+    }
+    out.push(ev);
+  }
+
+  uint32_t stable_;   // debounced level, bit set = down
+  uint32_t level_;    // level at the last snapshot
+  uint32_t pending_;  // transitions still settling
+  uint32_t settleUs_[N];
+  uint64_t firstUs_[N];  // first edge of the current or last transition
+  uint64_t lastUs_[N];   // last snapshot while settling
+  uint64_t flipUs_[N];   // last level flip while settling
+  uint32_t aheadUs_[N];  // time at the new level minus time back at the old
+  unsigned long downSinceMs_[N];
+  ChannelStats stats_[N];
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fixed-bucket latency histogram in microseconds. Bucket k counts samples in
+// [2^k, 2^(k+1)) us (bucket 0 also takes 0 and 1 us), so recording is a
+// handful of instructions and never allocates. Percentiles are reported as
+// the upper bound of the bucket that contains them.
+class LatencyHistogram {
+public:
+  static const int BUCKETS = 24; // up to ~16.7 s
+
+  void record(uint32_t us) {
+    int b = 0;
+    while (b < BUCKETS - 1 && (us >> (b + 1)) != 0) b++;
+    counts_[b]++;
+    count_++;
+    sum_ += us;
+    if (us > max_) max_ = us;
+  }
+
+  void reset() {
+    for (int b = 0; b < BUCKETS; b++) counts_[b] = 0;
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+  }
+
+  uint32_t count() const { return count_; }
+  uint32_t max() const { return max_; }
+  uint64_t sum() const { return sum_; }
+  uint32_t bucket(int b) const { return counts_[b]; }
+  static uint32_t bucketUpperUs(int b) { return (b >= 31) ? 0xFFFFFFFFu : ((2u << b) - 1); }
+
+  // p in [0, 100]. Returns 0 when empty.
+  uint32_t percentile(uint32_t p) const {
+    if (count_ == 0) return 0;
+    uint64_t rank = ((uint64_t)count_ * p + 99) / 100;
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+      seen += counts_[b];
+      if (seen >= rank) {
+        uint32_t upper = bucketUpperUs(b);
+        return upper < max_ ? upper : max_;
+      }
+    }
+    return max_;
+  }
+
+private:
+  uint32_t counts_[BUCKETS] = {0};
+  uint32_t count_ = 0;
+  uint64_t sum_ = 0;
+  uint32_t max_ = 0;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// A blink pattern: step durations in ms, alternating on/off and starting
+// on, so use an even number of steps, none of them zero. The steps repeat
+// until the LED is stopped. A pattern with no steps is steady on.
+struct LedPattern {
+  const uint16_t* stepsMs;
+  uint8_t steps;
+};
+
+// Hardware backends for LedPatternEngine. A backend takes over one LED's
+// pin and plays a blink pattern on its own:
+//   bool start(int led, const LedPattern* p, unsigned long now)
+//     false if no channel is free or the pattern does not fit
+//   void stop(int led)
+//     release the channel; the pin goes back to plain GPIO output, low
+
+// Software only.
+struct NoLedOffload {
+  bool start(int, const LedPattern*, unsigned long) { return false; }
+  void stop(int) {}
+};
+
+// RMT limits: 4 ticks per ms (1 MHz REF_TICK / 250), 15-bit durations and
+// one 64-item memory block per channel, two steps per item plus the end
+// marker.
+const uint32_t RMT_LED_TICKS_PER_MS = 4;
+const uint32_t RMT_LED_MAX_STEP_MS = 0x7FFF / RMT_LED_TICKS_PER_MS;
+const int RMT_LED_MAX_STEPS = 2 * 63;
+
+inline bool rmtLedPatternFits(const LedPattern* p) {
+  if (p->steps == 0 || p->steps % 2 != 0 || p->steps > RMT_LED_MAX_STEPS) return false;
+  for (int k = 0; k < p->steps; k++) {
+    if (p->stepsMs[k] == 0 || p->stepsMs[k] > RMT_LED_MAX_STEP_MS) return false;
+  }
+  return true;
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+// Plays patterns from RMT channels in TX loop mode. The waveform is written
+// into channel RAM once and the channel routed to the LED's pin; the
+// peripheral repeats it until stop() hands the pin back to GPIO.
+class RmtLedOffload {
+public:
+  static const int MAX_CHANNELS = 8;
+
+  // Uses RMT channels firstChannel .. firstChannel+channels-1. pins maps
+  // LED index to GPIO.
+  RmtLedOffload(const int* pins, int leds, int firstChannel, int channels);
+
+  // Install the channels, once at boot after the LED pins are outputs.
+  // Until then, or if none installs, start() always falls back to software.
+  bool begin();
+  bool start(int led, const LedPattern* p, unsigned long now);
+  void stop(int led);
+
+  int busy() const { return busy_; }
+
+private:
+  const int* pins_;
+  int leds_;
+  int firstChannel_;
+  int wanted_;
+  int channels_;  // installed by begin()
+  int busy_;
+  int8_t owner_[MAX_CHANNELS];  // LED index per channel, -1 = free
+};
+#endif
+
+// Peripheral model for host tests: same channel and pattern limits as the
+// RMT backend, and it can report the level a pin would have at any time.
+struct SimLedOffload {
+  static const int MAX_LEDS = 32;
+
+  explicit SimLedOffload(int channels) : channels(channels) {}
+
+  bool start(int led, const LedPattern* p, unsigned long now) {
+    if (busy >= channels || !rmtLedPatternFits(p)) return false;
+    pattern[led] = p;
+    startMs[led] = now;
+    busy++;
+    starts++;
+    return true;
+  }
+
+  void stop(int led) {
+    if (pattern[led] == NULL) return;
+    pattern[led] = NULL;
+    busy--;
+    stops++;
+  }
+
+  bool level(int led, unsigned long now) const {
+    const LedPattern* p = pattern[led];
+    if (p == NULL) return false;
+    unsigned long period = 0;
+    for (int k = 0; k < p->steps; k++) period += p->stepsMs[k];
+    unsigned long t = (now - startMs[led]) % period;
+    for (int k = 0; k < p->steps; k++) {
+      if (t < p->stepsMs[k]) return k % 2 == 0;
+      t -= p->stepsMs[k];
+    }
+    return false;
+  }
+
+  int channels;
+  int busy = 0;
+  uint32_t starts = 0;
+  uint32_t stops = 0;
+  const LedPattern* pattern[MAX_LEDS] = {};
+  unsigned long startMs[MAX_LEDS] = {};
+};
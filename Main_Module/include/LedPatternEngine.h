@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LedOffload.h"
+
+// Drives N LEDs from LedPattern tables. Step boundaries are scheduled from
+// the previous boundary rather than from when update() happened to run, so
+// a late wakeup does not stretch the pattern. Each update() builds one
+// frame (bit i = LED i on) and hands it to the output callback only when it
+// differs from the last one, which keeps the engine free of GPIO calls.
+//
+// With an Offload backend (see LedOffload.h), blink patterns are handed to a
+// hardware peripheral when it has a free channel. Those LEDs then play with
+// no CPU involvement: they are left out of the frame and add no deadlines.
+// When the peripheral is busy, or during the start flash, the pattern falls
+// back to the software path above.
+template <int N, typename Offload = NoLedOffload>
+class LedPatternEngine {
+  static_assert(N <= 32, "LedPatternEngine frames are 32 bits wide");
+
+public:
+  typedef void (*FrameFn)(uint32_t frame);
+
+  explicit LedPatternEngine(FrameFn output, Offload* offload = NULL)
+    : output_(output), offload_(offload), offloaded_(0), frame_(0), flashUntil_(0), writes_(0) {
+    for (int i = 0; i < N; i++) {
+      pattern_[i] = NULL;
+      step_[i] = 0;
+      stepEnd_[i] = 0;
+    }
+  }
+
+  // Start pattern p on LED i from its first step.
+  void play(int i, const LedPattern* p, unsigned long now) {
+    release(i);
+    if (p != NULL && p->steps > 0 && flashUntil_ <= now && offload_ != NULL && offload_->start(i, p, now)) {
+      offloaded_ |= 1u << i;
+      pattern_[i] = NULL;
+      return;
+    }
+    pattern_[i] = p;
+    step_[i] = 0;
+    stepEnd_[i] = (p != NULL && p->steps > 0) ? now + p->stepsMs[0] : 0;
+  }
+
+  void stop(int i) {
+    release(i);
+    pattern_[i] = NULL;
+  }
+
+  void stopAll() {
+    for (int i = 0; i < N; i++) stop(i);
+    flashUntil_ = 0;
+  }
+
+  // Hold every LED on until the given time, over whatever is playing.
+  void flashAllUntil(unsigned long until) { flashUntil_ = until; }
+
+  // Bring every LED to its level at `now`. Returns the next millis()
+  // deadline at which a level changes, or 0 if none.
+  unsigned long update(unsigned long now) {
+    unsigned long next = 0;
+    uint32_t frame = 0;
+    bool flash = flashUntil_ > now;
+    if (flash) next = flashUntil_;
+    for (int i = 0; i < N; i++) {
+      const LedPattern* p = pattern_[i];
+      bool on = false;
+      if (p != NULL) {
+        on = true;
+        if (p->steps > 0) {
+          while (now >= stepEnd_[i]) {
+            step_[i] = (uint8_t)((step_[i] + 1) % p->steps);
+            stepEnd_[i] += p->stepsMs[step_[i]];
+          }
+          on = (step_[i] % 2) == 0;
+          next = soonest(next, stepEnd_[i]);
+        }
+      }
+      if (flash || on) frame |= 1u << i;
+    }
+    if (frame != frame_) {
+      frame_ = frame;
+      writes_++;
+      output_(frame);
+    }
+    return next;
+  }
+
+  // Software level of LED i; offloaded LEDs read as off here.
+  bool level(int i) const { return (frame_ >> i) & 1; }
+  bool offloaded(int i) const { return (offloaded_ >> i) & 1; }
+  uint32_t frame() const { return frame_; }
+  uint32_t writes() const { return writes_; }
+
+private:
+  void release(int i) {
+    if (!(offloaded_ & (1u << i))) return;
+    offloaded_ &= ~(1u << i);
+    offload_->stop(i);
+  }
+
+  static unsigned long soonest(unsigned long a, unsigned long b) {
+    if (a == 0) return b;
+    return (b < a) ? b : a;
+  }
+
+  FrameFn output_;
+  Offload* offload_;
+  uint32_t offloaded_;
+  const LedPattern* pattern_[N];
+  uint8_t step_[N];
+  unsigned long stepEnd_[N];
+  uint32_t frame_;  // last frame output; all off at boot
+  unsigned long flashUntil_;
+  uint32_t writes_;
+};
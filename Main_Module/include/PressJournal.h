@@ -0,0 +1,525 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GameEvents.h"
+
+// Flash budget of the journal: JOURNAL_SEGMENTS files of up to
+// JOURNAL_SEGMENT_BYTES each, the oldest removed whole when a new one is
+// started. Records collect in a JOURNAL_BUFFER_BYTES RAM buffer between
+// flushes, which has to take a whole round: a round of 32 participants,
+// every press tied and judged, is about 1.2 KB.
+#ifndef JOURNAL_SEGMENT_BYTES
+#define JOURNAL_SEGMENT_BYTES 16384
+#endif
+#ifndef JOURNAL_SEGMENTS
+#define JOURNAL_SEGMENTS 8
+#endif
+#ifndef JOURNAL_BUFFER_BYTES
+#define JOURNAL_BUFFER_BYTES 2048
+#endif
+#define JOURNAL_DIR "/journal"
+
+enum JournalRecordType : uint8_t {
+  JR_BOOT = 1, JR_ROUND_START, JR_PRESS, JR_TIE_RESOLVED, JR_ROUND_END, JR_RESET, JR_CONFIG
+};
+
+// One journal record, decoded. The fields each type stores:
+//   BOOT          round (the last one before the reboot), key = reset reason
+//   ROUND_START   round, timeUs, value = duration ms, tieWindowUs, seed,
+//                 key = TieBreak
+//   PRESS         round, timeUs (ISR edge), team, place, tieGroup (-1 = none)
+//   TIE_RESOLVED  round, team, place, tieGroup
+//   ROUND_END     round, timeUs, place = press count
+//   RESET         round, timeUs
+//   CONFIG        round (the last started), timeUs, key = the CommandType
+//                 that applies the setting, value
+// Times are halMicros().
+struct JournalEntry {
+  uint8_t type;
+  uint8_t key;
+  int8_t team;
+  int8_t place;
+  int8_t tieGroup;
+  uint32_t round;
+  uint64_t timeUs;
+  uint32_t value;
+  uint32_t tieWindowUs;
+  uint32_t seed;
+};
+
+inline JournalEntry journalEntry(uint8_t type, uint32_t round, uint64_t timeUs = 0) {
+  JournalEntry e;
+  memset(&e, 0, sizeof(e));
+  e.type = type;
+  e.round = round;
+  e.timeUs = timeUs;
+  e.tieGroup = -1;
+  return e;
+}
+
+// The journal record for a round update from the arbiter, in round
+// `round`. Returns false for updates that are not journaled.
+inline bool journalEntryFor(const NetEvent& n, uint32_t round, JournalEntry& e) {
+  switch (n.type) {
+    case NET_ROUND_START:
+      e = journalEntry(JR_ROUND_START, round, n.timeUs);
+      e.key = n.tieBreak;
+      e.value = n.durationMs;
+      e.tieWindowUs = n.tieWindowUs;
+      e.seed = n.seed;
+      return true;
+    case NET_PRESS:
+    case NET_TIE_RESOLVED:
+      e = journalEntry(n.type == NET_PRESS ? JR_PRESS : JR_TIE_RESOLVED, round, n.timeUs);
+      e.team = n.teamIndex;
+      e.place = n.orderNo;
+      e.tieGroup = (n.tie || n.type == NET_TIE_RESOLVED) ? n.tieGroup : -1;
+      return true;
+    case NET_ROUND_END:
+      e = journalEntry(JR_ROUND_END, round, n.timeUs);
+      e.place = n.pressCount;
+      return true;
+    case NET_RESET:
+      e = journalEntry(JR_RESET, round, n.timeUs);
+      return true;
+    default:
+      return false;
+  }
+}
+
+inline uint32_t journalCrc32(uint32_t crc, const uint8_t* p, size_t n) {
+  crc = ~crc;
+  while (n--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+  }
+  return ~crc;
+}
+
+// On-flash framing, little-endian:
+//
+//   0xB5 | type | length | payload (length bytes) | CRC-32 of type..payload
+//
+// The payload holds the JournalEntry fields the type uses, in the order
+// round, timeUs, team, place, tieGroup, key, value, tieWindowUs, seed. Readers ignore payload bytes
+// past the fields they know, so records can grow. A frame that fails its
+// CRC is skipped a byte at a time until the next one lines up, which is
+// also how a record cut short by a brown-out is passed over.
+class JournalCodec {
+public:
+  static const uint8_t MAGIC = 0xB5;
+  static const size_t MAX_PAYLOAD = 64;
+  static const size_t MAX_FRAME = 3 + MAX_PAYLOAD + 4;
+  enum Result { OK, SHORT, CORRUPT };
+
+  // Writes one frame to out (MAX_FRAME bytes) and returns its length.
+  static size_t encode(const JournalEntry& e, uint8_t* out) {
+    uint16_t f = fields(e.type);
+    uint8_t* p = out + 3;
+    if (f & F_ROUND) p = put(p, e.round, 4);
+    if (f & F_TIME) p = put(p, e.timeUs, 8);
+    if (f & F_TEAM) p = put(p, (uint8_t)e.team, 1);
+    if (f & F_PLACE) p = put(p, (uint8_t)e.place, 1);
+    if (f & F_TIE_GROUP) p = put(p, (uint8_t)e.tieGroup, 1);
+    if (f & F_KEY) p = put(p, e.key, 1);
+    if (f & F_VALUE) p = put(p, e.value, 4);
+    if (f & F_TIE_WINDOW) p = put(p, e.tieWindowUs, 4);
+    if (f & F_SEED) p = put(p, e.seed, 4);
+    size_t len = p - out - 3;
+    out[0] = MAGIC;
+    out[1] = e.type;
+    out[2] = (uint8_t)len;
+    put(p, journalCrc32(0, out + 1, len + 2), 4);
+    return len + 7;
+  }
+
+  // Decodes the frame at p. SHORT means the frame may continue past
+  // `avail`; used is set for OK only.
+  static Result decode(const uint8_t* p, size_t avail, JournalEntry& e, size_t& used) {
+    if (avail < 3) return SHORT;
+    size_t len = p[2];
+    if (p[0] != MAGIC || len > MAX_PAYLOAD) return CORRUPT;
+    if (avail < len + 7) return SHORT;
+    if ((uint32_t)get(p + 3 + len, 4) != journalCrc32(0, p + 1, len + 2)) return CORRUPT;
+    e = journalEntry(p[1], 0);
+    uint16_t f = fields(e.type);
+    const uint8_t* q = p + 3;
+    const uint8_t* end = q + len;
+    if ((f & F_ROUND) && !take(q, end, 4, e.round)) return CORRUPT;
+    if ((f & F_TIME) && !take(q, end, 8, e.timeUs)) return CORRUPT;
+    if ((f & F_TEAM) && !take(q, end, 1, e.team)) return CORRUPT;
+    if ((f & F_PLACE) && !take(q, end, 1, e.place)) return CORRUPT;
+    if ((f & F_TIE_GROUP) && !take(q, end, 1, e.tieGroup)) return CORRUPT;
+    if ((f & F_KEY) && !take(q, end, 1, e.key)) return CORRUPT;
+    if ((f & F_VALUE) && !take(q, end, 4, e.value)) return CORRUPT;
+    if ((f & F_TIE_WINDOW) && !take(q, end, 4, e.tieWindowUs)) return CORRUPT;
+    if ((f & F_SEED) && !take(q, end, 4, e.seed)) return CORRUPT;
+    used = len + 7;
+    return OK;
+  }
+
+private:
+  enum {
+    F_ROUND = 1, F_TIME = 2, F_TEAM = 4, F_PLACE = 8, F_TIE_GROUP = 16,
+    F_KEY = 32, F_VALUE = 64, F_TIE_WINDOW = 128, F_SEED = 256
+  };
+
+  static uint16_t fields(uint8_t type) {
+    switch (type) {
+      case JR_BOOT: return F_ROUND | F_KEY;
+      case JR_ROUND_START: return F_ROUND | F_TIME | F_KEY | F_VALUE | F_TIE_WINDOW | F_SEED;
+      case JR_PRESS: return F_ROUND | F_TIME | F_TEAM | F_PLACE | F_TIE_GROUP;
+      case JR_TIE_RESOLVED: return F_ROUND | F_TEAM | F_PLACE | F_TIE_GROUP;
+      case JR_ROUND_END: return F_ROUND | F_TIME | F_PLACE;
+      case JR_RESET: return F_ROUND | F_TIME;
+      case JR_CONFIG: return F_ROUND | F_TIME | F_KEY | F_VALUE;
+      default: return 0;
+    }
+  }
+
+  static uint8_t* put(uint8_t* p, uint64_t v, int bytes) {
+    for (int k = 0; k < bytes; k++) *p++ = (uint8_t)(v >> (8 * k));
+    return p;
+  }
+
+  static uint64_t get(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int k = 0; k < bytes; k++) v |= (uint64_t)p[k] << (8 * k);
+    return v;
+  }
+
+  template <typename T>
+  static bool take(const uint8_t*& q, const uint8_t* end, int bytes, T& out) {
+    if (end - q < bytes) return false;
+    out = (T)get(q, bytes);
+    q += bytes;
+    return true;
+  }
+};
+
+// Append-only press journal: round starts and ends, every press with its
+// ISR timestamp, judge decisions, resets and config changes, CRC-framed
+// (JournalCodec) in numbered segment files under JOURNAL_DIR.
+//
+// Flash wear and timing. LittleFS rewrites a file's last, partly filled
+// block on every write that ends in it, so appends are batched in RAM and
+// written with flush(), which the device calls only between rounds: a
+// flash write also stalls the instruction cache, and with it any ISR not
+// in IRAM. A round is open from its ROUND_START record to its ROUND_END or
+// RESET; while it is, append() never touches flash, and a record the
+// buffer has no room for is dropped and counted. For the same reason
+// flush() starts the next segment as soon as the current one could not
+// take a full buffer, so a round never has to. Segments are filled once
+// and removed whole, so the journal never holds more than its budget and
+// LittleFS can spread the erases over the whole partition. A segment that
+// ends in a torn record is never appended to again; writing resumes in the
+// next one.
+//
+// The segments, oldest first, followed by the buffered tail form one byte
+// stream; read() serves it to exports without flushing. Records still in
+// RAM are lost on a reset.
+//
+// Not thread-safe: the device calls it under the HTTP server lock.
+template <typename Fs>
+class PressJournal {
+public:
+  // bufferBytes (at most JOURNAL_BUFFER_BYTES and segmentBytes) is what a
+  // round can buffer; the host uses small ones to exercise rotation.
+  explicit PressJournal(Fs& fs, uint32_t segmentBytes = JOURNAL_SEGMENT_BYTES, int segments = JOURNAL_SEGMENTS,
+                        size_t bufferBytes = JOURNAL_BUFFER_BYTES)
+    : fs_(fs), segmentBytes_(segmentBytes), segments_(segments), enabled_(false), first_(0), last_(0),
+      segBytes_(0), bufCap_(bufferBytes), bufLen_(0), roundOpen_(false), lastRound_(0), records_(0),
+      bytesWritten_(0), flushes_(0), writeErrors_(0), lostBytes_(0), droppedRecords_(0), tornBytes_(0) {
+    if (bufCap_ > sizeof(buf_)) bufCap_ = sizeof(buf_);
+    if (bufCap_ > segmentBytes_) bufCap_ = segmentBytes_;
+  }
+
+  // Mount, recover the round counter and note the boot. Returns false (and
+  // the journal stays disabled) if the filesystem is unavailable.
+  bool begin(uint8_t resetReason) {
+    if (!fs_.begin() || !fs_.mkdir(JOURNAL_DIR)) return false;
+    bool any = false;
+    uint32_t lo = 0xFFFFFFFFu, hi = 0;
+    fs_.list(JOURNAL_DIR, [&](const char* name) {
+      char* end;
+      uint32_t seq = strtoul(name, &end, 16);
+      if (end == name || strcmp(end, ".bin") != 0) return;
+      any = true;
+      if (seq < lo) lo = seq;
+      if (seq > hi) hi = seq;
+    });
+    enabled_ = true;
+    if (any) {
+      first_ = lo;
+      last_ = hi;
+      char p[32];
+      path(last_, p);
+      segBytes_ = fs_.size(p);
+    }
+    uint32_t torn = 0;
+    for (uint32_t seq = first_; any && seq <= last_; seq++) {
+      torn = scanSegment(seq, [&](const JournalEntry& e) {
+        if (e.round > lastRound_) lastRound_ = e.round;
+      });
+      tornBytes_ += torn;
+    }
+    if (torn > 0 || !roomForBuffer()) rotate();
+    trim();
+    JournalEntry boot = journalEntry(JR_BOOT, lastRound_);
+    boot.key = resetReason;
+    append(boot);
+    return true;
+  }
+
+  bool enabled() const { return enabled_; }
+
+  void append(const JournalEntry& e) {
+    if (!enabled_) return;
+    uint8_t frame[JournalCodec::MAX_FRAME];
+    size_t n = JournalCodec::encode(e, frame);
+    if (e.type == JR_ROUND_START) roundOpen_ = true;
+    if (e.type == JR_ROUND_END || e.type == JR_RESET) roundOpen_ = false;
+    // The segment always has room for the whole buffer, so a buffered
+    // record already has its final place in the stream.
+    if (bufLen_ + n > bufCap_) {
+      if (roundOpen_) {
+        droppedRecords_++;
+        return;
+      }
+      flush();
+    }
+    memcpy(buf_ + bufLen_, frame, n);
+    bufLen_ += n;
+    records_++;
+    if (e.round > lastRound_) lastRound_ = e.round;
+  }
+
+  // Write the buffered records to flash. Returns false if some were lost.
+  // The device calls it only between rounds.
+  bool flush() {
+    if (!enabled_ || bufLen_ == 0) return true;
+    char p[32];
+    path(last_, p);
+    size_t n = fs_.append(p, buf_, bufLen_);
+    segBytes_ += n;
+    bytesWritten_ += n;
+    flushes_++;
+    bool ok = (n == bufLen_);
+    if (!ok) {
+      writeErrors_++;
+      lostBytes_ += bufLen_ - n;
+    }
+    bufLen_ = 0;
+    if (!ok || !roomForBuffer()) rotate();
+    return ok;
+  }
+
+  // Up to len bytes of segment seq from offset, the buffered tail included
+  // for the newest segment. 0 past its end or for a removed segment.
+  size_t read(uint32_t seq, uint32_t offset, uint8_t* buf, size_t len) {
+    if (!enabled_ || seq < first_ || seq > last_) return 0;
+    char p[32];
+    path(seq, p);
+    uint32_t flashBytes = (seq == last_) ? segBytes_ : fs_.size(p);
+    size_t n = 0;
+    if (offset < flashBytes) {
+      size_t want = flashBytes - offset < len ? flashBytes - offset : len;
+      n = fs_.read(p, offset, buf, want);
+    }
+    uint32_t at = offset + n;
+    if (seq == last_ && n < len && at >= segBytes_ && at - segBytes_ < bufLen_) {
+      size_t more = bufLen_ - (at - segBytes_);
+      if (more > len - n) more = len - n;
+      memcpy(buf + n, buf_ + (at - segBytes_), more);
+      n += more;
+    }
+    return n;
+  }
+
+  // Decode every record, oldest first, into fn(const JournalEntry&).
+  // Returns the bytes skipped as corrupt or torn.
+  template <typename Fn>
+  uint32_t forEach(Fn fn) {
+    uint32_t skipped = 0;
+    for (uint32_t seq = first_; enabled_ && seq <= last_; seq++) skipped += scanSegment(seq, fn);
+    return skipped;
+  }
+
+  uint32_t firstSegment() const { return first_; }
+  uint32_t lastSegment() const { return last_; }
+  int segmentCount() const { return enabled_ ? (int)(last_ - first_ + 1) : 0; }
+  uint32_t lastRound() const { return lastRound_; }
+  size_t bufferedBytes() const { return bufLen_; }
+  uint32_t records() const { return records_; }
+  uint64_t bytesWritten() const { return bytesWritten_; }
+  uint32_t flushes() const { return flushes_; }
+  uint32_t writeErrors() const { return writeErrors_; }
+  uint32_t lostBytes() const { return lostBytes_; }
+  uint32_t droppedRecords() const { return droppedRecords_; }  // buffer full mid-round
+  bool roundOpen() const { return roundOpen_; }
+  uint32_t tornBytes() const { return tornBytes_; }  // found at boot
+
+private:
+  static void path(uint32_t seq, char* out) {
+    snprintf(out, 32, JOURNAL_DIR "/%08lx.bin", (unsigned long)seq);
+  }
+
+  bool roomForBuffer() const { return segBytes_ + bufCap_ <= segmentBytes_; }
+
+  void rotate() {
+    last_++;
+    segBytes_ = 0;
+    trim();
+  }
+
+  void trim() {
+    while (last_ - first_ + 1 > (uint32_t)segments_) {
+      char p[32];
+      path(first_++, p);
+      fs_.remove(p);
+    }
+  }
+
+  template <typename Fn>
+  uint32_t scanSegment(uint32_t seq, Fn fn) {
+    uint8_t win[2 * JournalCodec::MAX_FRAME];
+    size_t have = 0;
+    uint32_t offset = 0;
+    uint32_t skipped = 0;
+    bool eof = false;
+    for (;;) {
+      if (!eof && have < sizeof(win)) {
+        size_t n = read(seq, offset, win + have, sizeof(win) - have);
+        offset += n;
+        have += n;
+        eof = (n == 0);
+      }
+      if (have == 0) break;
+      JournalEntry e;
+      size_t used = 0;
+      JournalCodec::Result r = JournalCodec::decode(win, have, e, used);
+      if (r == JournalCodec::SHORT && !eof) continue;
+      if (r == JournalCodec::OK) {
+        fn(e);
+      } else {
+        used = (r == JournalCodec::SHORT) ? have : 1;
+        skipped += used;
+      }
+      memmove(win, win + used, have - used);
+      have -= used;
+    }
+    return skipped;
+  }
+
+  Fs& fs_;
+  uint32_t segmentBytes_;
+  int segments_;
+  bool enabled_;
+  uint32_t first_;     // oldest segment
+  uint32_t last_;      // segment being appended to
+  uint32_t segBytes_;  // of last_ on flash
+  uint8_t buf_[JOURNAL_BUFFER_BYTES];
+  size_t bufCap_;
+  size_t bufLen_;
+  bool roundOpen_;
+  uint32_t lastRound_;
+  uint32_t records_;
+  uint64_t bytesWritten_;
+  uint32_t flushes_;
+  uint32_t writeErrors_;
+  uint32_t lostBytes_;
+  uint32_t droppedRecords_;
+  uint32_t tornBytes_;
+};
+
+// Streams the journal to one HTTP client as a chunked response whose head
+// the caller has already written. pump() runs whenever the client has
+// window space (right after the head, then on every ACK) and moves at most
+// CHUNK_BYTES per chunk through a stack buffer, so the export never holds
+// more than that of the journal in RAM however large it is. Records
+// appended during the export are sent too; a segment removed under it is
+// skipped. The connection is closed only by a pump() after the one that
+// queued the last chunk, i.e. from an ACK: begin() runs inside the request
+// handler, where closing would free the connection under AsyncTCP. Not
+// thread-safe, like the journal it reads.
+template <typename Journal, typename Client>
+class JournalExport {
+public:
+  static const size_t CHUNK_BYTES = 512;
+
+  JournalExport() : journal_(NULL), client_(NULL), seq_(0), offset_(0), sentBytes_(0), done_(false) {}
+
+  void begin(Journal& journal, Client* client) {
+    journal_ = &journal;
+    client_ = client;
+    seq_ = journal.firstSegment();
+    offset_ = 0;
+    sentBytes_ = 0;
+    done_ = false;
+    pump();
+  }
+
+  // The client went away.
+  void abort() { client_ = NULL; }
+
+  bool active() const { return client_ != NULL; }
+  Client* client() const { return client_; }
+  uint32_t sentBytes() const { return sentBytes_; }
+
+  // Queue as many chunks as the client's window takes and end the response
+  // once the journal is sent; the call after that closes the connection.
+  // Returns true while the export is still running.
+  bool pump() {
+    if (client_ == NULL) return false;
+    if (done_) {
+      client_->close();
+      client_ = NULL;
+      return false;
+    }
+    const size_t overhead = 16;  // chunk size line, CRLF and the last chunk
+    bool queued = false;
+    while (client_->space() > overhead) {
+      size_t want = client_->space() - overhead;
+      if (want > CHUNK_BYTES) want = CHUNK_BYTES;
+      if (seq_ < journal_->firstSegment()) {
+        seq_ = journal_->firstSegment();
+        offset_ = 0;
+      }
+      uint8_t buf[CHUNK_BYTES];
+      size_t n = journal_->read(seq_, offset_, buf, want);
+      if (n == 0) {
+        if (seq_ < journal_->lastSegment()) {
+          seq_++;
+          offset_ = 0;
+          continue;
+        }
+        client_->add("0\r\n\r\n", 5);
+        client_->send();
+        done_ = true;
+        return true;
+      }
+      char head[12];
+      int h = snprintf(head, sizeof(head), "%x\r\n", (unsigned)n);
+      client_->add(head, h);
+      client_->add((const char*)buf, n);
+      client_->add("\r\n", 2);
+      offset_ += n;
+      sentBytes_ += n;
+      queued = true;
+    }
+    if (queued) client_->send();
+    return true;
+  }
+
+private:
+  Journal* journal_;
+  Client* client_;
+  uint32_t seq_;
+  uint32_t offset_;
+  uint32_t sentBytes_;
+  bool done_;  // last chunk queued
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+// Reorders presses from several sources (local ISR, remote boards) into
+// timestamp order. An event is released only once it is holdUs old, so a
+// remote press that happened earlier but arrived later still goes first.
+// With holdUs = 0 events pass straight through in timestamp order.
+//
+// T needs a uint64_t timeUs member. Not thread-safe; owned by the arbiter.
+template <typename T, int CAP>
+class PressMerger {
+public:
+  // False when full; the event is dropped and counted.
+  bool add(const T& e) {
+    if (count_ == CAP) {
+      dropped_++;
+      return false;
+    }
+    int k = count_++;
+    while (k > 0 && items_[k - 1].timeUs > e.timeUs) {
+      items_[k] = items_[k - 1];
+      k--;
+    }
+    items_[k] = e;
+    return true;
+  }
+
+  // Pop the oldest event if it is at least holdUs old at nowUs.
+  bool popReady(T& out, uint64_t nowUs, uint32_t holdUs) {
+    if (count_ == 0 || items_[0].timeUs + holdUs > nowUs) return false;
+    out = items_[0];
+    for (int k = 1; k < count_; k++) items_[k - 1] = items_[k];
+    count_--;
+    return true;
+  }
+
+  // When the oldest event becomes ready, or 0 if empty.
+  uint64_t nextReadyUs(uint32_t holdUs) const { return count_ ? items_[0].timeUs + holdUs : 0; }
+
+  void clear() { count_ = 0; }
+  int count() const { return count_; }
+  uint32_t dropped() const { return dropped_; }
+
+private:
+  T items_[CAP];
+  int count_ = 0;
+  uint32_t dropped_ = 0;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "LatencyHistogram.h"
+
+// Prometheus text exposition (format 0.0.4) into any string type with
+// operator+=(const char*): Arduino String on the device, std::string on
+// the host. gauge(), counter() and histogram() write one whole metric with
+// its # HELP / # TYPE lines; a labelled family takes header() once and then
+// one sample() per series.
+//
+// LatencyHistograms come out as Prometheus histograms in microseconds. The
+// buckets are cumulative and stop at the highest non-empty one; the count
+// is taken from the buckets, so a sample recorded by another task while
+// the histogram is written cannot make them disagree.
+template <typename Str>
+class PrometheusText {
+public:
+  explicit PrometheusText(Str& out) : out_(out) {}
+
+  void gauge(const char* name, const char* help, double value) {
+    header(name, help, "gauge");
+    out_ += name;
+    number(" %.17g\n", value);
+  }
+
+  void counter(const char* name, const char* help, uint64_t value) {
+    header(name, help, "counter");
+    out_ += name;
+    number(" %llu\n", (unsigned long long)value);
+  }
+
+  // One sample of a labelled family; call header() once before the first.
+  void sample(const char* name, const char* label, int labelValue, uint64_t value) {
+    out_ += name;
+    out_ += "{";
+    out_ += label;
+    number("=\"%d\"} ", labelValue);
+    number("%llu\n", (unsigned long long)value);
+  }
+
+  void header(const char* name, const char* help, const char* type) {
+    out_ += "# HELP ";
+    out_ += name;
+    out_ += " ";
+    out_ += help;
+    out_ += "\n# TYPE ";
+    out_ += name;
+    out_ += " ";
+    out_ += type;
+    out_ += "\n";
+  }
+
+  void histogram(const char* name, const char* help, const LatencyHistogram& h) {
+    header(name, help, "histogram");
+    int last = -1;
+    for (int b = 0; b < LatencyHistogram::BUCKETS; b++) if (h.bucket(b)) last = b;
+    uint64_t cumulative = 0;
+    for (int b = 0; b <= last; b++) {
+      cumulative += h.bucket(b);
+      out_ += name;
+      number("_bucket{le=\"%" PRIu32 "\"} ", LatencyHistogram::bucketUpperUs(b));
+      number("%llu\n", (unsigned long long)cumulative);
+    }
+    out_ += name;
+    number("_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+    out_ += name;
+    number("_sum %llu\n", (unsigned long long)h.sum());
+    out_ += name;
+    number("_count %llu\n", (unsigned long long)cumulative);
+  }
+
+private:
+  // Names and help text are appended as they are, so only formatted
+  // numbers go through this buffer: the longest format above with a 20
+  // digit value fits.
+  template <typename... Args>
+  void number(const char* fmt, Args... args) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), fmt, args...);
+    out_ += buf;
+  }
+
+  Str& out_;
+};
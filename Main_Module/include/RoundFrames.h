@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include "SseFrame.h"
+#include "GameEvents.h"
+
+// SSE frames for round updates. Shared by the device and the host build so
+// both put exactly the same bytes on the wire.
+
+// `buzzer` event for one NET_PRESS.
+inline void renderPressFrame(SseFrame& frame, uint32_t id, const NetEvent& e, uint64_t roundStartUs)
+{
+  frame.begin("buzzer", id);
+  frame.add("type", "press");
+  frame.add("teamIndex", (int)e.teamIndex);
+  frame.add("timestamp", (unsigned long)(e.timeUs / 1000));
+  frame.add("timestampUs", (unsigned long long)e.timeUs);
+  frame.add("sinceStartUs", (unsigned long long)(e.timeUs - roundStartUs));
+  frame.add("orderNo", (int)e.orderNo);
+  frame.add("pressCount", (int)e.pressCount);
+  frame.add("tie", e.tie);
+  frame.add("tieGroup", e.tie ? (int)e.tieGroup : -1);
+  frame.end();
+}
+
+// `tiebreak` event for one NET_TIE_RESOLVED: the judge's decision.
+inline void renderTieFrame(SseFrame& frame, uint32_t id, const NetEvent& e)
+{
+  frame.begin("tiebreak", id);
+  frame.add("type", "tiebreak");
+  frame.add("teamIndex", (int)e.teamIndex);
+  frame.add("orderNo", (int)e.orderNo);
+  frame.add("tieGroup", (int)e.tieGroup);
+  frame.end();
+}
+
+// `result` event with the first three of pressOrder, their places (shared
+// by a tie the judge has not decided yet, which makes it provisional) and
+// tie groups (-1 = none).
+inline void renderResultFrame(SseFrame& frame, uint32_t id, const int* pressOrder, const int* places,
+                              const int* tieGroups, int pressCount)
+{
+  int top = pressCount < 3 ? pressCount : 3;
+  bool provisional = false;
+  frame.begin("result", id);
+  frame.add("type", "result");
+  frame.beginArray("top3");
+  for (int k=0;k<top;k++){ frame.addElement(pressOrder[k]); }
+  frame.endArray();
+  frame.beginArray("places");
+  for (int k=0;k<top;k++){ frame.addElement(places[k]); }
+  frame.endArray();
+  frame.beginArray("tieGroups");
+  for (int k=0;k<top;k++){ frame.addElement(tieGroups[k]); }
+  frame.endArray();
+  for (int k=0;k<pressCount;k++){ provisional = provisional || places[k] != k; }
+  frame.add("provisional", provisional);
+  frame.end();
+}
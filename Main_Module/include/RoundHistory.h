@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef HISTORY_ROUNDS
+#define HISTORY_ROUNDS 32
+#endif
+
+// The last ROUNDS rounds in RAM, one fixed-size record each, in a ring:
+// storing a round overwrites the oldest, so the history costs
+// sizeof(RoundHistory) from boot on and put() is O(1). Round numbers only
+// grow, so finding a round is a binary search over the ring.
+//
+// Not thread-safe: the device uses it under the HTTP server lock.
+template <int N, int ROUNDS = HISTORY_ROUNDS>
+class RoundHistory {
+public:
+  struct Record {
+    uint32_t round;
+    uint32_t elapsedMs;      // start to end, or to the reset or restart
+    uint8_t tieBreak;
+    bool aborted;            // reset or restarted before it ended
+    uint8_t pressCount;
+    int8_t order[N];         // participant of each press, in final order
+    int8_t place[N];         // equal within a tie awaiting the judge
+    uint32_t reactionUs[N];  // press time since the round started
+  };
+
+  RoundHistory() : start_(0), count_(0) {}
+
+  // Record::elapsedMs for a round from startUs to endUs, both halMicros().
+  static uint32_t elapsedMs(uint64_t startUs, uint64_t endUs) { return (uint32_t)((endUs - startUs) / 1000); }
+
+  // Store a round. A round that is already the newest is replaced, as
+  // when the judge settles a tie after the round ended.
+  void put(const Record& r) {
+    if (count_ > 0 && at(count_ - 1).round == r.round) {
+      records_[(start_ + count_ - 1) % ROUNDS] = r;
+      return;
+    }
+    if (count_ == ROUNDS) {
+      start_ = (start_ + 1) % ROUNDS;
+      count_--;
+    }
+    records_[(start_ + count_) % ROUNDS] = r;
+    count_++;
+  }
+
+  int count() const { return count_; }
+  static int capacity() { return ROUNDS; }
+  // Record i, oldest first.
+  const Record& at(int i) const { return records_[(start_ + i) % ROUNDS]; }
+
+  // Index of the first record of round `round` or later; count() if none.
+  int lowerBound(uint32_t round) const {
+    int lo = 0, hi = count_;
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (at(mid).round < round) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  // Records [first, last) of one page of at most `limit`: from the first
+  // of round `from` or later, or the newest ones without a `from`. The
+  // round of record `last`, if any, is where the next page starts.
+  struct Page {
+    int first;
+    int last;
+  };
+  Page page(bool hasFrom, uint32_t from, int limit) const {
+    Page p;
+    p.first = hasFrom ? lowerBound(from) : (count_ > limit ? count_ - limit : 0);
+    p.last = p.first + limit < count_ ? p.first + limit : count_;
+    return p;
+  }
+
+private:
+  Record records_[ROUNDS];
+  int start_;
+  int count_;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+#include "GpioRegs.h"
+
+// Bit-banged shift-register chains for more buzzers than the ESP32 has
+// pins. Both go through a register backend (see GpioRegs.h), so a whole
+// transfer is a few dozen register stores with no driver calls and can run
+// from an ISR.
+
+// 74HC165 parallel-in chain. Buttons pull their input low when pressed.
+// Participant i is the i-th bit shifted out after a load: bit 0 is input H
+// of the register whose Q7 feeds dataPin.
+template <typename Regs, int BITS>
+class Hc165Chain {
+  static_assert(BITS >= 1 && BITS <= 32, "Hc165Chain reads at most 32 bits");
+
+public:
+  Hc165Chain(Regs& regs, int loadPin, int clockPin, int dataPin)
+    : regs_(regs),
+      loadBank_(loadPin >= 32), loadBit_(1u << (loadPin & 31)),
+      clockBank_(clockPin >= 32), clockBit_(1u << (clockPin & 31)),
+      dataBank_(dataPin >= 32), dataBit_(1u << (dataPin & 31)) {}
+
+  // Latch every input at once, then clock the chain out. Bit i set =
+  // participant i is pressed.
+  IRAM_ATTR uint32_t readDown() {
+    regs_.clear(loadBank_, loadBit_);   // /PL low: parallel load
+    regs_.set(loadBank_, loadBit_);     // /PL high: shift mode
+    uint32_t down = 0;
+    for (int i = 0; i < BITS; i++) {
+      if ((regs_.read(dataBank_) & dataBit_) == 0) down |= 1u << i;
+      regs_.set(clockBank_, clockBit_);
+      regs_.clear(clockBank_, clockBit_);
+    }
+    return down;
+  }
+
+private:
+  Regs& regs_;
+  int loadBank_;
+  uint32_t loadBit_;
+  int clockBank_;
+  uint32_t clockBit_;
+  int dataBank_;
+  uint32_t dataBit_;
+};
+
+// 74HC595 serial-out chain driving the LEDs. Bit i of a frame ends up on
+// output i, counting from QA of the register fed by dataPin. Outputs only
+// change on the latch edge, so all LEDs switch together.
+template <typename Regs, int BITS>
+class Hc595Chain {
+  static_assert(BITS >= 1 && BITS <= 32, "Hc595Chain writes at most 32 bits");
+
+public:
+  Hc595Chain(Regs& regs, int dataPin, int clockPin, int latchPin)
+    : regs_(regs),
+      dataBank_(dataPin >= 32), dataBit_(1u << (dataPin & 31)),
+      clockBank_(clockPin >= 32), clockBit_(1u << (clockPin & 31)),
+      latchBank_(latchPin >= 32), latchBit_(1u << (latchPin & 31)) {}
+
+  void write(uint32_t frame) {
+    for (int i = BITS - 1; i >= 0; i--) {
+      if (frame & (1u << i)) regs_.set(dataBank_, dataBit_);
+      else regs_.clear(dataBank_, dataBit_);
+      regs_.set(clockBank_, clockBit_);
+      regs_.clear(clockBank_, clockBit_);
+    }
+    regs_.set(latchBank_, latchBit_);
+    regs_.clear(latchBank_, latchBit_);
+  }
+
+private:
+  Regs& regs_;
+  int dataBank_;
+  uint32_t dataBit_;
+  int clockBank_;
+  uint32_t clockBit_;
+  int latchBank_;
+  uint32_t latchBit_;
+};
+
+// Register backend for host simulations: models a 74HC165 chain and a
+// 74HC595 chain wired to the given pins. Tests set `inputs` (bit i low =
+// participant i pressed) and read `outputs` (latched LED frame).
+struct SimShiftRegs {
+  SimShiftRegs(int inLoad, int inClock, int inData, int outData, int outClock, int outLatch)
+    : inLoad(inLoad), inClock(inClock), inData(inData),
+      outData(outData), outClock(outClock), outLatch(outLatch) {
+    pins = pinMask(inLoad) | pinMask(inData);  // /PL idles high, Q7 pulled up
+  }
+
+  void set(int bank, uint32_t mask) { drive(pins | ((uint64_t)mask << (32 * bank))); }
+  void clear(int bank, uint32_t mask) { drive(pins & ~((uint64_t)mask << (32 * bank))); }
+  uint32_t read(int bank) { return (uint32_t)(pins >> (32 * bank)); }
+
+  int inLoad, inClock, inData, outData, outClock, outLatch;
+  uint32_t inputs = 0xFFFFFFFF;
+  uint32_t outputs = 0;
+  uint32_t stores = 0;
+
+private:
+  static uint64_t pinMask(int pin) { return (uint64_t)1 << pin; }
+
+  void drive(uint64_t next) {
+    uint64_t rising = next & ~pins;
+    stores++;
+    pins = next;
+    if (!(pins & pinMask(inLoad))) in165 = inputs;           // /PL low loads
+    else if (rising & pinMask(inClock)) in165 = (in165 >> 1) | 0x80000000u;
+    if (rising & pinMask(outClock)) out595 = (out595 << 1) | ((pins & pinMask(outData)) ? 1 : 0);
+    if (rising & pinMask(outLatch)) outputs = out595;
+    if (in165 & 1) pins |= pinMask(inData);
+    else pins &= ~pinMask(inData);
+  }
+
+  uint64_t pins = 0;
+  uint32_t in165 = 0xFFFFFFFF;
+  uint32_t out595 = 0;
+};
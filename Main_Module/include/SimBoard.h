@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+#include "Hal.h"
+#include "SpscRing.h"
+#include "GpioInputSnapshot.h"
+#include "GpioOutputBatch.h"
+#include "LedPatternEngine.h"
+#include "InputScanner.h"
+#include "GameCore.h"
+
+// One board's game core wired to the simulated peripherals from Hal.h,
+// with the device's direct GPIO pinout, settle times and press hold. The
+// host programs (env:native, env:native-bench) drive the switches, run the
+// pin and scan-timer ISRs and the arbiter passes themselves and drain
+// netEvents as the network task would; the host tests use the press(),
+// runMs() and drainNet() shortcuts.
+//
+// The LED and publish callbacks are plain function pointers, so only one
+// SimBoard may exist at a time.
+const int SIM_SWITCH_PINS[10] = {34, 35, 36, 39, 32, 33, 25, 26, 27, 14};
+const int SIM_LED_PINS[10] = {12, 13, 15, 2, 4, 16, 17, 5, 18, 19};
+
+template <int N>
+class SimBoard {
+  static_assert(N <= 10, "SimBoard uses the direct GPIO pinout");
+
+public:
+  typedef LedPatternEngine<N, SimLedOffload> Leds;
+  typedef ToneSequencer<SimToneOut> Tones;
+
+  SimBoard()
+    : ledOutputs(regs, SIM_LED_PINS), switchInputs(regs, SIM_SWITCH_PINS), ledOffload(8),
+      leds(writeLedFrame, &ledOffload), tones(buzzerOut),
+      game(leds, tones, publish, N, (uint32_t)INPUT_ORDER_HOLD_MS * 1000, false) {
+    current() = this;
+    for (int i = 0; i < N; i++) {
+      if (SIM_SWITCH_PINS[i] >= 34) inputScanner.setSettleUs(i, DEBOUNCE_US_EXT_PULLUP);
+    }
+  }
+  ~SimBoard() { current() = NULL; }
+
+  // Set the switches in `mask` down or up at the current time. Returns the
+  // pins that changed, i.e. whose interrupt would now fire.
+  uint32_t setSwitches(uint32_t mask, bool down) {
+    uint32_t edges = 0;
+    for (int i = 0; i < N; i++) {
+      if (!(mask & (1u << i))) continue;
+      int pin = SIM_SWITCH_PINS[i];
+      uint32_t bit = 1u << (pin & 31);
+      uint32_t& in = regs.in[pin >= 32 ? 1 : 0];
+      if (down == ((in & bit) != 0)) edges |= 1u << i;
+      if (down) in &= ~bit;
+      else in |= bit;
+    }
+    return edges;
+  }
+
+  // The pin ISR for `changed`, or the scan timer with 0: one input
+  // snapshot, stamped now. Returns the settled transitions it queued.
+  int isr(uint32_t changed) {
+    return inputScanner.scan(switchInputs.readDown(), changed, halMicros(), pressEvents);
+  }
+
+  // One pass of the arbiter task. Returns its next deadline (halMillis(),
+  // 0 = none).
+  unsigned long arbiterPass() {
+    PressEvent ev;
+    while (pressEvents.pop(ev)) game.addLocalPress(ev);
+    return game.service();
+  }
+
+  void command(uint8_t type, uint32_t value = 0) {
+    Command c;
+    c.type = type;
+    c.value = value;
+    game.command(c);
+  }
+
+  // A press stamped timeUs that skips the switches and the debouncer, as
+  // one forwarded by a cluster node does.
+  void press(int i, uint64_t timeUs) {
+    PressEvent ev = {timeUs, (uint8_t)i, LOW, 0};
+    game.addRemotePress(ev);
+  }
+
+  // Advance the virtual clock in 1 ms steps, each followed by the scan
+  // timer ISR and an arbiter pass.
+  void runMs(int ms) {
+    for (int k = 0; k < ms; k++) {
+      simClockAdvanceUs(1000);
+      isr(0);
+      arbiterPass();
+    }
+  }
+
+  // Drain netEvents as the network task would. Returns how many were of
+  // `type`, the last of them in `last`.
+  int drainNet(uint8_t type, NetEvent* last = NULL) {
+    int n = 0;
+    NetEvent e;
+    while (netEvents.pop(e)) {
+      if (e.type != type) continue;
+      n++;
+      if (last) *last = e;
+    }
+    return n;
+  }
+
+  HalRegs regs;
+  GpioOutputBatch<HalRegs, N> ledOutputs;
+  GpioInputSnapshot<HalRegs, N> switchInputs;
+  SimLedOffload ledOffload;
+  Leds leds;
+  SimToneOut buzzerOut;
+  Tones tones;
+  InputScanner<N> inputScanner;
+  SpscRing<PressEvent, 64> pressEvents;
+  SpscRing<NetEvent, 32> netEvents;
+  GameCore<N, Leds, Tones> game;
+
+private:
+  static SimBoard*& current() {
+    static SimBoard* board = NULL;
+    return board;
+  }
+  static void writeLedFrame(uint32_t frame) { current()->ledOutputs.apply(frame); }
+  static void publish(const NetEvent& e) { current()->netEvents.push(e); }
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Builds one complete Server-Sent Events frame
+//
+//   id: <id>\n            (omitted when id is 0)
+//   event: <name>\n
+//   data: {"key":value,...}\n
+//   \n
+//
+// in a fixed buffer, so the whole frame can go out in a single TCP write and
+// the press path never touches the heap. Keys and string values are written
+// as-is (callers pass plain identifiers). If the frame would not fit it is
+// marked overflowed and must not be sent.
+class SseFrame {
+public:
+  static const size_t CAPACITY = 256;
+
+  void begin(const char* event, uint32_t id = 0) {
+    len_ = 0;
+    overflow_ = false;
+    first_ = true;
+    id_ = id;
+    if (id != 0) {
+      append("id: ");
+      appendUint(id);
+      append("\n");
+    }
+    append("event: ");
+    append(event);
+    append("\ndata: {");
+  }
+
+  void add(const char* key, const char* value) {
+    addKey(key);
+    append("\"");
+    append(value);
+    append("\"");
+  }
+  void add(const char* key, bool value) {
+    addKey(key);
+    append(value ? "true" : "false");
+  }
+  void add(const char* key, int value) { addKey(key); appendInt(value); }
+  void add(const char* key, long value) { addKey(key); appendInt(value); }
+  void add(const char* key, long long value) { addKey(key); appendInt(value); }
+  void add(const char* key, unsigned value) { addKey(key); appendUint(value); }
+  void add(const char* key, unsigned long value) { addKey(key); appendUint(value); }
+  void add(const char* key, unsigned long long value) { addKey(key); appendUint(value); }
+
+  void beginArray(const char* key) {
+    addKey(key);
+    append("[");
+    first_ = true;
+  }
+  void addElement(long long value) {
+    if (!first_) append(",");
+    first_ = false;
+    appendInt(value);
+  }
+  void endArray() {
+    append("]");
+    first_ = false;
+  }
+
+  void end() { append("}\n\n"); }
+
+  const char* data() const { return buf_; }
+  size_t length() const { return len_; }
+  bool overflowed() const { return overflow_; }
+  uint32_t id() const { return id_; }
+
+private:
+  void addKey(const char* key) {
+    if (!first_) append(",");
+    first_ = false;
+    append("\"");
+    append(key);
+    append("\":");
+  }
+
+  void append(const char* s) {
+    size_t n = strlen(s);
+    if (len_ + n >= CAPACITY) {
+      overflow_ = true;
+      return;
+    }
+    memcpy(buf_ + len_, s, n);
+    len_ += n;
+    buf_[len_] = '\0';
+  }
+
+  void appendUint(unsigned long long v) {
+    char tmp[21];
+    int i = sizeof(tmp) - 1;
+    tmp[i] = '\0';
+    do {
+      tmp[--i] = (char)('0' + (v % 10));
+      v /= 10;
+    } while (v != 0);
+    append(tmp + i);
+  }
+
+  void appendInt(long long v) {
+    if (v < 0) {
+      append("-");
+      appendUint((unsigned long long)(-(v + 1)) + 1);
+    } else {
+      appendUint((unsigned long long)v);
+    }
+  }
+
+  char buf_[CAPACITY];
+  size_t len_ = 0;
+  bool overflow_ = false;
+  bool first_ = true;
+  uint32_t id_ = 0;
+};
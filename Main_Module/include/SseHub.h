@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Hal.h"
+#include "SseFrame.h"
+#include "SseSendQueue.h"
+#include "SseReplayBuffer.h"
+
+#ifndef SSE_MAX_SUBSCRIBERS
+#define SSE_MAX_SUBSCRIBERS 8
+#endif
+
+// Registry of live SSE subscribers.
+//
+// Each subscriber has its own bounded send queue, so a client with a full
+// TCP window only delays itself: frames are queued without blocking and
+// drained as its ACKs arrive. Idle streams get a heartbeat comment so dead
+// peers surface through AsyncTCP's ACK timeout instead of lingering in a
+// slot. Every event carries a monotonic id, and recent frames are kept so
+// a client reconnecting with Last-Event-ID gets exactly what it missed.
+//
+// Clients are AsyncClients on the device and SimStreamClients on the host
+// (see Hal.h). Not thread-safe: callers hold the HTTP server lock.
+class SseHub {
+public:
+  enum SlowPolicy { DROP_OLDEST, DISCONNECT };
+
+  static const unsigned long STALL_TIMEOUT_MS = 5000;  // evict after no progress this long
+  static const unsigned long HEARTBEAT_MS = 5000;      // comment on streams idle this long
+
+  struct Subscriber {
+    HalStreamClient* client;
+    SseSendQueue queue;
+    unsigned long connectedMs;
+    unsigned long lastProgressMs;
+    unsigned long lastWriteMs;
+    uint32_t writeFailures;  // TCP refused data it had room for, or a send failed
+    bool closing;            // evicted; the slot frees when detach() is called
+  };
+
+  SseHub();
+
+  void setSlowPolicy(SlowPolicy policy) { policy_ = policy; }
+
+  // Event ids are the boot epoch in the top ID_EPOCH_BITS and a sequence
+  // number from 1 below it, so an id a client kept from before a reboot
+  // falls outside this boot's range and gets a resync instead of a replay
+  // of unrelated events. Call before the first event; the device passes a
+  // random epoch, which repeats once in 4096 boots.
+  static const int ID_EPOCH_BITS = 12;
+  void setBootEpoch(uint32_t epoch) { nextId_ = (epoch << (32 - ID_EPOCH_BITS)) | 1; }
+
+  // Next event id to stamp on a frame.
+  uint32_t nextId() { return nextId_++; }
+
+  bool full() const { return count_ >= SSE_MAX_SUBSCRIBERS; }
+
+  // Register a stream whose response head was already written. If
+  // hasLastId, replay everything newer than lastId. Returns false when the
+  // registry is full.
+  bool attach(HalStreamClient* client, bool hasLastId, uint32_t lastId);
+  void detach(HalStreamClient* client);
+  void onWritable(HalStreamClient* client);
+
+  // Queue a frame for every subscriber and push what fits now.
+  void broadcast(const SseFrame& frame);
+
+  // Send heartbeat comments to idle streams and evict stalled ones.
+  void service(unsigned long now);
+
+  int count() const { return count_; }
+  static int capacity() { return SSE_MAX_SUBSCRIBERS; }
+  static size_t bytesPerSubscriber() { return sizeof(Subscriber); }
+  const Subscriber& subscriber(int i) const { return subs_[i]; }
+  uint32_t rejected() const { return rejected_; }
+  uint32_t evictions() const { return evictions_; }
+  void noteRejected() { rejected_++; }
+
+private:
+  void replayAfter(Subscriber& sub, uint32_t lastId);
+  void drain(Subscriber& sub, unsigned long now);
+  void evict(Subscriber& sub);
+
+  Subscriber subs_[SSE_MAX_SUBSCRIBERS];
+  SseReplayBuffer replay_;
+  SseFrame scratch_;
+  SlowPolicy policy_;
+  uint32_t nextId_;
+  int count_;
+  uint32_t rejected_;
+  uint32_t evictions_;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "SseFrame.h"
+
+// Ring of the most recent SSE frames, kept by event id so a reconnecting
+// client can be sent exactly the events it missed (Last-Event-ID).
+class SseReplayBuffer {
+public:
+  static const int ENTRIES = 16;
+
+  void add(uint32_t id, const char* data, size_t len) {
+    if (len > SseFrame::CAPACITY) return;
+    Entry& e = entries_[(start_ + count_) % ENTRIES];
+    if (count_ == ENTRIES) start_ = (start_ + 1) % ENTRIES;
+    else count_++;
+    e.id = id;
+    e.len = (uint16_t)len;
+    memcpy(e.data, data, len);
+  }
+
+  int count() const { return count_; }
+  uint32_t oldestId() const { return count_ ? entries_[start_].id : 0; }
+  uint32_t newestId() const { return count_ ? entries_[(start_ + count_ - 1) % ENTRIES].id : 0; }
+
+  // True if every event after lastId is still buffered, so replay is
+  // lossless. An id from before a reboot is another boot epoch's (see
+  // SseHub::setBootEpoch) and so above the newest or below the oldest.
+  bool canResumeAfter(uint32_t lastId) const {
+    if (lastId > newestId()) return false;
+    if (count_ == 0) return true;
+    return lastId + 1 >= oldestId();
+  }
+
+  // Entry i, oldest first.
+  const char* frame(int i, size_t& len, uint32_t& id) const {
+    const Entry& e = entries_[(start_ + i) % ENTRIES];
+    len = e.len;
+    id = e.id;
+    return e.data;
+  }
+
+private:
+  struct Entry {
+    uint32_t id;
+    uint16_t len;
+    char data[SseFrame::CAPACITY];
+  };
+
+  Entry entries_[ENTRIES];
+  int start_ = 0;
+  int count_ = 0;
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "SseFrame.h"
+
+// Bounded outgoing queue of whole SSE frames for one subscriber.
+//
+// Frames are copied into fixed slots so enqueueing never blocks or
+// allocates. The oldest frame may be partly handed to TCP already; it is
+// never dropped, because cutting it would corrupt the event stream. When the
+// queue is full the oldest frame that has not started sending is dropped to
+// make room for the new one.
+class SseSendQueue {
+public:
+  static const int SLOTS = 8;
+
+  void clear() {
+    head_ = 0;
+    count_ = 0;
+    headSent_ = 0;
+    queuedBytes_ = 0;
+  }
+
+  // Returns false if an older frame had to be dropped to make room.
+  bool push(const char* data, size_t len) {
+    if (len == 0 || len > SseFrame::CAPACITY) return false;
+    bool droppedOne = false;
+    if (count_ == SLOTS) {
+      dropOldestUnsent();
+      droppedOne = true;
+    }
+    Slot& s = slots_[(head_ + count_) % SLOTS];
+    memcpy(s.data, data, len);
+    s.len = (uint16_t)len;
+    count_++;
+    queuedBytes_ += len;
+    return !droppedOne;
+  }
+
+  // Unsent bytes of the oldest frame, or NULL when empty.
+  const char* front(size_t& len) const {
+    if (count_ == 0) {
+      len = 0;
+      return NULL;
+    }
+    const Slot& s = slots_[head_];
+    len = s.len - headSent_;
+    return s.data + headSent_;
+  }
+
+  // Mark n bytes of the oldest frame as accepted by TCP.
+  void consume(size_t n) {
+    if (count_ == 0) return;
+    headSent_ += n;
+    queuedBytes_ -= n;
+    sentBytes_ += n;
+    if (headSent_ >= slots_[head_].len) {
+      head_ = (head_ + 1) % SLOTS;
+      count_--;
+      headSent_ = 0;
+      sentFrames_++;
+    }
+  }
+
+  bool empty() const { return count_ == 0; }
+  size_t queuedBytes() const { return queuedBytes_; }
+  int queuedFrames() const { return count_; }
+  uint32_t droppedFrames() const { return dropped_; }
+  uint32_t sentFrames() const { return sentFrames_; }
+  uint32_t sentBytes() const { return sentBytes_; }
+  void resetCounters() {
+    dropped_ = 0;
+    sentFrames_ = 0;
+    sentBytes_ = 0;
+  }
+
+private:
+  struct Slot {
+    uint16_t len;
+    char data[SseFrame::CAPACITY];
+  };
+
+  void dropOldestUnsent() {
+    if (headSent_ == 0) {
+      queuedBytes_ -= slots_[head_].len;
+      head_ = (head_ + 1) % SLOTS;
+    } else {
+      // Keep the partly sent head; drop the frame behind it by moving the
+      // head forward into its slot.
+      int next = (head_ + 1) % SLOTS;
+      queuedBytes_ -= slots_[next].len;
+      slots_[next] = slots_[head_];
+      head_ = next;
+    }
+    count_--;
+    dropped_++;
+  }
+
+  Slot slots_[SLOTS];
+  int head_ = 0;
+  int count_ = 0;
+  size_t headSent_ = 0;
+  size_t queuedBytes_ = 0;
+  uint32_t dropped_ = 0;
+  uint32_t sentFrames_ = 0;
+  uint32_t sentBytes_ = 0;
+};
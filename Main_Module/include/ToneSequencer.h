@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// One step of a buzzer cue. freqHz 0 (or duty 0) is a rest.
+struct ToneStep {
+  uint16_t freqHz;
+  uint16_t duty;
+  uint16_t durationMs;
+};
+
+// A cue plays its steps once, then goes silent.
+struct ToneCue {
+  const ToneStep* steps;
+  uint8_t count;
+};
+
+// Plays ToneCues without blocking. The output is reprogrammed only when a
+// step starts, never in between, and step boundaries are scheduled from the
+// previous boundary so a late update() does not stretch the cue.
+//
+// Out is the output backend:
+//   void tone(uint16_t freqHz, uint16_t duty)   freqHz or duty 0 = silent
+// LedcToneOut on the device, SimToneOut for host tests.
+template <typename Out>
+class ToneSequencer {
+public:
+  explicit ToneSequencer(Out& out) : out_(out), cue_(NULL), step_(0), stepEnd_(0), writes_(0) {}
+
+  // Start a cue from its first step, replacing whatever is playing.
+  void play(const ToneCue* cue, unsigned long now) {
+    if (cue == NULL || cue->count == 0) {
+      stop();
+      return;
+    }
+    cue_ = cue;
+    step_ = 0;
+    stepEnd_ = now + cue->steps[0].durationMs;
+    apply(cue->steps[0]);
+  }
+
+  void stop() {
+    if (cue_ != NULL || writes_ == 0) write(0, 0);
+    cue_ = NULL;
+  }
+
+  // Advance past any step boundaries up to `now`. Returns the next millis()
+  // deadline, or 0 when nothing is playing.
+  unsigned long update(unsigned long now) {
+    if (cue_ == NULL) return 0;
+    bool advanced = false;
+    while (now >= stepEnd_) {
+      if (++step_ >= cue_->count) {
+        stop();
+        return 0;
+      }
+      stepEnd_ += cue_->steps[step_].durationMs;
+      advanced = true;
+    }
+    if (advanced) apply(cue_->steps[step_]);
+    return stepEnd_;
+  }
+
+  bool playing() const { return cue_ != NULL; }
+  uint32_t writes() const { return writes_; }
+
+private:
+  void apply(const ToneStep& s) { write(s.freqHz, s.duty); }
+
+  void write(uint16_t freqHz, uint16_t duty) {
+    writes_++;
+    out_.tone(freqHz, duty);
+  }
+
+  Out& out_;
+  const ToneCue* cue_;
+  uint8_t step_;
+  unsigned long stepEnd_;
+  uint32_t writes_;
+};
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Arduino.h>
+
+// Drives a passive buzzer from one LEDC channel. ledcWriteTone() leaves the
+// channel at 10-bit resolution, so duty is out of 1023. The timer is only
+// retuned when the frequency actually changes.
+struct LedcToneOut {
+  explicit LedcToneOut(int channel) : channel(channel), freqHz(0) {}
+
+  void tone(uint16_t f, uint16_t duty) {
+    if (f == 0 || duty == 0) {
+      ledcWrite(channel, 0);
+      return;
+    }
+    if (f != freqHz) {
+      ledcWriteTone(channel, f);
+      freqHz = f;
+    }
+    ledcWrite(channel, duty);
+  }
+
+  int channel;
+  uint16_t freqHz;
+};
+#endif
+
+// Output model for host tests: the current tone plus a count of writes.
+struct SimToneOut {
+  uint16_t freqHz = 0;
+  uint16_t duty = 0;
+  uint32_t writes = 0;
+
+  void tone(uint16_t f, uint16_t d) {
+    freqHz = f;
+    duty = d;
+    writes++;
+  }
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Binary frames on the /ws WebSocket channel. All integers are
+// little-endian; the first byte is always the message type.
+//
+// Device -> client
+//   PRESS   (16 bytes)  u8 type, u8 teamIndex, u8 orderNo, u8 pressCount,
+//                       u32 eventId, u64 timeUs (ISR edge time)
+//   RESULT  (12 bytes)  u8 type, u8 count, i8 top[3], u8 pad[3], u32 eventId
+//   START   (12 bytes)  u8 type, u8 pad[3], u32 startMs, u32 durationMs
+//   RESET   (4 bytes)   u8 type, u8 pad[3]
+//   ACK     (8 bytes)   u8 type, u8 op, u8 status, u8 pad, u32 seq
+//
+// Client -> device
+//   COMMAND (12 bytes)  u8 op, u8 pad[3], u32 seq, u32 value
+//
+// seq is chosen by the client and echoed in the ACK, so it can time round
+// trips. value is the duration in ms for WS_OP_CONFIG and unused otherwise.
+
+enum WsMessageType : uint8_t {
+  WS_MSG_PRESS = 1,
+  WS_MSG_RESULT = 2,
+  WS_MSG_START = 3,
+  WS_MSG_RESET = 4,
+  WS_MSG_ACK = 0x80,
+};
+
+enum WsOp : uint8_t {
+  WS_OP_START = 1,
+  WS_OP_RESET = 2,
+  WS_OP_CONFIG = 3,
+  WS_OP_PING = 4,
+};
+
+enum WsAckStatus : uint8_t { WS_ACK_OK = 0, WS_ACK_BAD_COMMAND = 1, WS_ACK_BUSY = 2 };
+
+const size_t WS_PRESS_LEN = 16;
+const size_t WS_RESULT_LEN = 12;
+const size_t WS_START_LEN = 12;
+const size_t WS_RESET_LEN = 4;
+const size_t WS_ACK_LEN = 8;
+const size_t WS_COMMAND_LEN = 12;
+
+struct WsCommand {
+  uint8_t op;
+  uint32_t seq;
+  uint32_t value;
+};
+
+inline void wsPutU32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+inline void wsPutU64(uint8_t* p, uint64_t v) {
+  wsPutU32(p, (uint32_t)v);
+  wsPutU32(p + 4, (uint32_t)(v >> 32));
+}
+inline uint32_t wsGetU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline size_t wsEncodePress(uint8_t* out, uint8_t teamIndex, uint8_t orderNo, uint8_t pressCount,
+                            uint32_t eventId, uint64_t timeUs) {
+  out[0] = WS_MSG_PRESS;
+  out[1] = teamIndex;
+  out[2] = orderNo;
+  out[3] = pressCount;
+  wsPutU32(out + 4, eventId);
+  wsPutU64(out + 8, timeUs);
+  return WS_PRESS_LEN;
+}
+
+inline size_t wsEncodeResult(uint8_t* out, const int* top, uint8_t count, uint32_t eventId) {
+  memset(out, 0, WS_RESULT_LEN);
+  out[0] = WS_MSG_RESULT;
+  out[1] = count;
+  for (int k = 0; k < 3; k++) out[2 + k] = (uint8_t)(int8_t)(k < count ? top[k] : -1);
+  wsPutU32(out + 8, eventId);
+  return WS_RESULT_LEN;
+}
+
+inline size_t wsEncodeStart(uint8_t* out, uint32_t startMs, uint32_t durationMs) {
+  memset(out, 0, WS_START_LEN);
+  out[0] = WS_MSG_START;
+  wsPutU32(out + 4, startMs);
+  wsPutU32(out + 8, durationMs);
+  return WS_START_LEN;
+}
+
+inline size_t wsEncodeReset(uint8_t* out) {
+  memset(out, 0, WS_RESET_LEN);
+  out[0] = WS_MSG_RESET;
+  return WS_RESET_LEN;
+}
+
+inline size_t wsEncodeAck(uint8_t* out, uint8_t op, uint8_t status, uint32_t seq) {
+  out[0] = WS_MSG_ACK;
+  out[1] = op;
+  out[2] = status;
+  out[3] = 0;
+  wsPutU32(out + 4, seq);
+  return WS_ACK_LEN;
+}
+
+inline bool wsDecodeCommand(const uint8_t* in, size_t len, WsCommand& cmd) {
+  if (len != WS_COMMAND_LEN) return false;
+  cmd.op = in[0];
+  cmd.seq = wsGetU32(in + 4);
+  cmd.value = wsGetU32(in + 8);
+  return cmd.op >= WS_OP_START && cmd.op <= WS_OP_PING;
+}
@@ -0,0 +1,427 @@
+#include "AsyncHttpServer.h"
+
+// Per-connection parser and output state. Created when a client connects and
+// deleted together with its AsyncClient when it disconnects.
+//
+// Closing a client runs the disconnect callback, which deletes both, so a
+// connection is only ever closed from its ACK callback: AsyncTCP touches
+// the client again after the data callback returns, but not after the ACK
+// callback. A handler that ends a response with Connection: close only
+// sets closeAfterSend.
+struct HttpConnection {
+  AsyncHttpServer* server;
+  AsyncClient* client;
+  String in;           // bytes received but not yet consumed
+  String out;          // response bytes TCP has not accepted yet
+  HttpMethod method;
+  String uri;
+  String query;
+  String headers;      // raw header block of the current request
+  String body;
+  String respHeaders;  // extra headers queued with sendHeader()
+  bool keepAlive;
+  bool closeAfterSend; // close once `out` has gone to TCP (see handleAck)
+  bool streaming;
+  int64_t rxUs;        // esp_timer time the latest data arrived
+};
+
+static const char* reasonPhrase(int code)
+{
+  switch (code) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 503: return "Service Unavailable";
+    default: return "";
+  }
+}
+
+static HttpMethod parseMethod(const String& m)
+{
+  if (m == "GET") return HTTP_GET;
+  if (m == "POST") return HTTP_POST;
+  if (m == "OPTIONS") return HTTP_OPTIONS;
+  return HTTP_OTHER;
+}
+
+static int hexValue(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static String urlDecode(const String& s)
+{
+  String out;
+  out.reserve(s.length());
+  for (unsigned i = 0; i < s.length(); i++) {
+    char c = s.charAt(i);
+    if (c == '+') {
+      out += ' ';
+    } else if (c == '%' && i + 2 < s.length() && hexValue(s.charAt(i + 1)) >= 0 && hexValue(s.charAt(i + 2)) >= 0) {
+      out += (char)(hexValue(s.charAt(i + 1)) * 16 + hexValue(s.charAt(i + 2)));
+      i += 2;
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+// Value of header `name` in a raw "Name: value\r\n" block, or "" if absent.
+static String findHeader(const String& block, const char* name)
+{
+  size_t nameLen = strlen(name);
+  int lineStart = 0;
+  while (lineStart < (int)block.length()) {
+    int lineEnd = block.indexOf("\r\n", lineStart);
+    if (lineEnd < 0) lineEnd = block.length();
+    int colon = block.indexOf(':', lineStart);
+    if (colon > lineStart && colon < lineEnd && (size_t)(colon - lineStart) == nameLen) {
+      String key = block.substring(lineStart, colon);
+      if (key.equalsIgnoreCase(name)) {
+        String value = block.substring(colon + 1, lineEnd);
+        value.trim();
+        return value;
+      }
+    }
+    lineStart = lineEnd + 2;
+  }
+  return String();
+}
+
+AsyncHttpServer::AsyncHttpServer(uint16_t port)
+  : tcp_(port), lock_(NULL), routeCount_(0), current_(NULL),
+    connectionCount_(0), requestsServed_(0), rejectedConnections_(0)
+{
+}
+
+void AsyncHttpServer::on(const char* uri, HttpMethod method, Handler handler)
+{
+  if (routeCount_ >= MAX_ROUTES) return;
+  routes_[routeCount_].uri = uri;
+  routes_[routeCount_].method = method;
+  routes_[routeCount_].handler = handler;
+  routeCount_++;
+}
+
+void AsyncHttpServer::onNotFound(Handler handler) { notFound_ = handler; }
+void AsyncHttpServer::onStreamClose(StreamHandler handler) { streamClose_ = handler; }
+void AsyncHttpServer::onStreamWritable(StreamHandler handler) { streamWritable_ = handler; }
+
+void AsyncHttpServer::begin()
+{
+  if (lock_ == NULL) lock_ = xSemaphoreCreateRecursiveMutex();
+  tcp_.setNoDelay(true);
+  tcp_.onClient([](void* arg, AsyncClient* client) {
+    ((AsyncHttpServer*)arg)->handleConnect(client);
+  }, this);
+  tcp_.begin();
+}
+
+void AsyncHttpServer::lock() { xSemaphoreTakeRecursive(lock_, portMAX_DELAY); }
+void AsyncHttpServer::unlock() { xSemaphoreGiveRecursive(lock_); }
+
+void AsyncHttpServer::handleConnect(AsyncClient* client)
+{
+  lock();
+  if (connectionCount_ >= MAX_CONNECTIONS) {
+    rejectedConnections_++;
+    unlock();
+    client->close(true);
+    client->free();
+    delete client;
+    return;
+  }
+  HttpConnection* conn = new HttpConnection();
+  conn->server = this;
+  conn->client = client;
+  conn->method = HTTP_OTHER;
+  conn->keepAlive = true;
+  conn->closeAfterSend = false;
+  conn->streaming = false;
+  conn->rxUs = 0;
+  connectionCount_++;
+  unlock();
+
+  client->setRxTimeout(KEEPALIVE_TIMEOUT_S);
+  client->onData([](void* arg, AsyncClient*, void* data, size_t len) {
+    HttpConnection* c = (HttpConnection*)arg;
+    c->server->handleData(c, (const char*)data, len);
+  }, conn);
+  client->onAck([](void* arg, AsyncClient*, size_t, uint32_t) {
+    HttpConnection* c = (HttpConnection*)arg;
+    c->server->handleAck(c);
+  }, conn);
+  client->onTimeout([](void*, AsyncClient* c, uint32_t) { c->close(); }, conn);
+  client->onError([](void*, AsyncClient*, int8_t) {}, conn);
+  client->onDisconnect([](void* arg, AsyncClient* c) {
+    HttpConnection* hc = (HttpConnection*)arg;
+    hc->server->handleDisconnect(hc);
+    delete c;
+  }, conn);
+}
+
+void AsyncHttpServer::handleData(HttpConnection* conn, const char* data, size_t len)
+{
+  // Stamp before taking the lock so waiting for it does not count as
+  // network delay.
+  conn->rxUs = esp_timer_get_time();
+  lock();
+  // Once a response ends the connection, whatever else arrives is dropped
+  // rather than buffered until the close.
+  if (!conn->streaming && !conn->closeAfterSend) {
+    conn->in.concat(data, len);
+    // Several pipelined requests may arrive in one segment.
+    while (!conn->streaming && !conn->closeAfterSend && parseRequest(conn)) {
+      dispatch(conn);
+    }
+  }
+  unlock();
+}
+
+void AsyncHttpServer::handleAck(HttpConnection* conn)
+{
+  lock();
+  if (conn->streaming) {
+    // The stream owner may close the client here, deleting conn.
+    if (streamWritable_) streamWritable_(conn->client);
+    unlock();
+    return;
+  }
+  flush(conn);
+  bool done = conn->closeAfterSend && conn->out.length() == 0;
+  unlock();
+  if (done) conn->client->close();
+}
+
+void AsyncHttpServer::handleDisconnect(HttpConnection* conn)
+{
+  lock();
+  if (conn->streaming && streamClose_) streamClose_(conn->client);
+  if (current_ == conn) current_ = NULL;
+  connectionCount_--;
+  unlock();
+  delete conn;
+}
+
+// Pull one complete request out of conn->in. Returns false if more bytes are
+// needed or the request was rejected.
+bool AsyncHttpServer::parseRequest(HttpConnection* conn)
+{
+  int headEnd = conn->in.indexOf("\r\n\r\n");
+  if (headEnd < 0) {
+    if (conn->in.length() > MAX_HEADER_BYTES) {
+      current_ = conn;
+      conn->keepAlive = false;
+      send(431);
+      current_ = NULL;
+    }
+    return false;
+  }
+
+  int lineEnd = conn->in.indexOf("\r\n");
+  String requestLine = conn->in.substring(0, lineEnd);
+  String headers = conn->in.substring(lineEnd + 2, headEnd + 2);
+  int sp1 = requestLine.indexOf(' ');
+  int sp2 = requestLine.indexOf(' ', sp1 + 1);
+  if (sp1 < 0 || sp2 < 0) {
+    current_ = conn;
+    conn->keepAlive = false;
+    send(400);
+    current_ = NULL;
+    return false;
+  }
+
+  String contentLength = findHeader(headers, "Content-Length");
+  long bodyLen = contentLength.length() ? contentLength.toInt() : 0;
+  if (bodyLen < 0 || (size_t)bodyLen > MAX_BODY_BYTES) {
+    current_ = conn;
+    conn->keepAlive = false;
+    send(413);
+    current_ = NULL;
+    return false;
+  }
+  size_t total = headEnd + 4 + bodyLen;
+  if (conn->in.length() < total) return false;
+
+  conn->method = parseMethod(requestLine.substring(0, sp1));
+  String target = requestLine.substring(sp1 + 1, sp2);
+  int q = target.indexOf('?');
+  conn->uri = (q < 0) ? target : target.substring(0, q);
+  conn->query = (q < 0) ? String() : target.substring(q + 1);
+  conn->headers = headers;
+  conn->body = conn->in.substring(headEnd + 4, total);
+  conn->in.remove(0, total);
+
+  // HTTP/1.1 keeps the connection open unless told otherwise; 1.0 closes
+  // unless asked to keep it.
+  String connection = findHeader(headers, "Connection");
+  bool http10 = requestLine.endsWith("HTTP/1.0");
+  if (http10) conn->keepAlive = connection.equalsIgnoreCase("keep-alive");
+  else conn->keepAlive = !connection.equalsIgnoreCase("close");
+  conn->respHeaders = String();
+  return true;
+}
+
+void AsyncHttpServer::dispatch(HttpConnection* conn)
+{
+  current_ = conn;
+  requestsServed_++;
+  int64_t t0 = esp_timer_get_time();
+  Handler* handler = NULL;
+  for (int i = 0; i < routeCount_; i++) {
+    Route& r = routes_[i];
+    if ((r.method == HTTP_ANY || r.method == conn->method) && conn->uri == r.uri) {
+      handler = &r.handler;
+      break;
+    }
+  }
+  if (handler != NULL) (*handler)();
+  else if (notFound_) notFound_();
+  else send(404, "text/plain", "Not found");
+  handlerUs_.record((uint32_t)(esp_timer_get_time() - t0));
+  current_ = NULL;
+  conn->body = String();
+  conn->headers = String();
+}
+
+HttpMethod AsyncHttpServer::method() const { return current_ ? current_->method : HTTP_OTHER; }
+
+const String& AsyncHttpServer::uri() const
+{
+  static const String empty;
+  return current_ ? current_->uri : empty;
+}
+
+String AsyncHttpServer::arg(const char* name) const
+{
+  if (current_ == NULL) return String();
+  if (strcmp(name, "plain") == 0) return current_->body;
+  const String& q = current_->query;
+  size_t nameLen = strlen(name);
+  int start = 0;
+  while (start <= (int)q.length()) {
+    int amp = q.indexOf('&', start);
+    if (amp < 0) amp = q.length();
+    int eq = q.indexOf('=', start);
+    int keyEnd = (eq >= 0 && eq < amp) ? eq : amp;
+    if ((size_t)(keyEnd - start) == nameLen && strncmp(q.c_str() + start, name, nameLen) == 0) {
+      return (keyEnd < amp) ? urlDecode(q.substring(keyEnd + 1, amp)) : String();
+    }
+    start = amp + 1;
+  }
+  return String();
+}
+
+bool AsyncHttpServer::hasArg(const char* name) const
+{
+  if (current_ == NULL) return false;
+  if (strcmp(name, "plain") == 0) return current_->body.length() > 0;
+  const String& q = current_->query;
+  size_t nameLen = strlen(name);
+  int start = 0;
+  while (start < (int)q.length()) {
+    if (strncmp(q.c_str() + start, name, nameLen) == 0) {
+      char next = q.charAt(start + nameLen);
+      if (next == '=' || next == '&' || next == '\0') return true;
+    }
+    int amp = q.indexOf('&', start);
+    if (amp < 0) break;
+    start = amp + 1;
+  }
+  return false;
+}
+
+int64_t AsyncHttpServer::receivedUs() const
+{
+  return current_ ? current_->rxUs : 0;
+}
+
+String AsyncHttpServer::header(const char* name) const
+{
+  return current_ ? findHeader(current_->headers, name) : String();
+}
+
+void AsyncHttpServer::sendHeader(const char* name, const char* value)
+{
+  if (current_ == NULL) return;
+  current_->respHeaders += name;
+  current_->respHeaders += ": ";
+  current_->respHeaders += value;
+  current_->respHeaders += "\r\n";
+}
+
+void AsyncHttpServer::send(int code, const char* contentType, const String& content)
+{
+  HttpConnection* conn = current_;
+  if (conn == NULL) return;
+  String head;
+  head.reserve(128 + conn->respHeaders.length());
+  head += "HTTP/1.1 ";
+  head += String(code);
+  head += " ";
+  head += reasonPhrase(code);
+  head += "\r\n";
+  head += conn->respHeaders;
+  if (contentType != NULL) {
+    head += "Content-Type: ";
+    head += contentType;
+    head += "\r\n";
+  }
+  head += "Content-Length: ";
+  head += String((unsigned long)content.length());
+  head += conn->keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+  conn->respHeaders = String();
+  writeOut(conn, head.c_str(), head.length());
+  writeOut(conn, content.c_str(), content.length());
+  if (!conn->keepAlive) {
+    conn->closeAfterSend = true;
+    conn->in = String();
+  }
+  flush(conn);
+}
+
+AsyncClient* AsyncHttpServer::beginStream()
+{
+  HttpConnection* conn = current_;
+  if (conn == NULL) return NULL;
+  // Responses to earlier pipelined requests must reach TCP before the
+  // stream owner starts writing to the client directly.
+  flush(conn);
+  if (conn->out.length() > 0) return NULL;
+  conn->streaming = true;
+  conn->in = String();
+  conn->client->setRxTimeout(0);
+  return conn->client;
+}
+
+void AsyncHttpServer::writeOut(HttpConnection* conn, const char* data, size_t len)
+{
+  if (len == 0) return;
+  conn->out.concat(data, len);
+}
+
+// Hand as much pending output to TCP as it will take; the rest goes out as
+// ACKs free up window space.
+void AsyncHttpServer::flush(HttpConnection* conn)
+{
+  size_t pending = conn->out.length();
+  if (pending > 0) {
+    size_t room = conn->client->space();
+    size_t n = pending < room ? pending : room;
+    if (n > 0) {
+      size_t added = conn->client->add(conn->out.c_str(), n);
+      if (added > 0) {
+        conn->client->send();
+        conn->out.remove(0, added);
+      }
+    }
+  }
+}
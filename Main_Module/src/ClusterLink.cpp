@@ -0,0 +1,258 @@
+#include "ClusterLink.h"
+
+ClusterLink::ClusterLink()
+  : role_(STANDALONE), board_(0), epoch_(0), coordinator_(0), coordinatorEpoch_(0), syncSeq_(0), lastSyncMs_(0),
+    pendingStart_(0), pendingCount_(0), pressSeq_(0), droppedPresses_(0), lastResendMs_(0), controlApplied_(0)
+{
+  for (int b = 0; b < MAX_BOARDS; b++) {
+    peers_[b].known = false;
+    peers_[b].ip = 0;
+    peers_[b].port = 0;
+    peers_[b].lastSeenMs = 0;
+    peers_[b].epoch = 0;
+    peers_[b].restarts = 0;
+    peers_[b].presses = 0;
+    peers_[b].lastErrorUs = 0;
+    peers_[b].controlStart = 0;
+    peers_[b].controlCount = 0;
+    peers_[b].controlSeq = 0;
+    peers_[b].controlDropped = 0;
+  }
+}
+
+void ClusterLink::begin(Role role, uint8_t board, uint32_t coordinatorIp)
+{
+  role_ = role;
+  board_ = board;
+  epoch_ = halRandom() | 1;  // 0 means no contact yet
+  coordinator_ = coordinatorIp;
+  if (role_ != STANDALONE) udp_.begin(CLUSTER_PORT);
+}
+
+void ClusterLink::poll(unsigned long nowMs)
+{
+  if (role_ == STANDALONE) return;
+  receive(nowMs);
+  if (role_ == COORDINATOR) {
+    if (nowMs - lastResendMs_ >= RESEND_MS) sendControl(nowMs);
+    return;
+  }
+  if (nowMs - lastSyncMs_ >= SYNC_INTERVAL_MS) {
+    lastSyncMs_ = nowMs;
+    ClusterMsg m = {};
+    m.type = CLUSTER_SYNC_REQ;
+    m.board = board_;
+    m.seq = ++syncSeq_;
+    m.t1 = (int64_t)halMicros();
+    send(coordinator_, CLUSTER_PORT, m);
+  }
+  if (nowMs - lastResendMs_ >= RESEND_MS) sendPending(nowMs);
+}
+
+void ClusterLink::receive(unsigned long nowMs)
+{
+  uint8_t buf[CLUSTER_MSG_LEN + 1];  // one spare byte so longer datagrams fail to decode
+  for (;;) {
+    uint32_t ip;
+    uint16_t port;
+    int len = udp_.receive(buf, sizeof(buf), ip, port);
+    if (len < 0) return;
+    int64_t rxUs = (int64_t)halMicros();
+    ClusterMsg m;
+    if (!clusterDecode(buf, (size_t)len, m) || m.epoch == 0) continue;
+    handle(m, ip, port, rxUs, nowMs);
+  }
+}
+
+void ClusterLink::handle(const ClusterMsg& m, uint32_t ip, uint16_t port, int64_t rxUs, unsigned long nowMs)
+{
+  if (role_ == COORDINATOR) {
+    if (m.board == 0 || m.board >= MAX_BOARDS) return;
+    Peer& p = peers_[m.board];
+    if (m.epoch != p.epoch) {
+      // The node booted again and numbers its presses from 1.
+      if (p.epoch != 0) p.restarts++;
+      p.epoch = m.epoch;
+      p.seqs = SeqWindow();
+    }
+    p.known = true;
+    p.ip = ip;
+    p.port = port;
+    p.lastSeenMs = nowMs;
+    if (m.type == CLUSTER_SYNC_REQ) {
+      ClusterMsg r = {};
+      r.type = CLUSTER_SYNC_RESP;
+      r.board = m.board;
+      r.seq = m.seq;
+      r.t1 = m.t1;
+      r.t2 = rxUs;
+      r.t3 = (int64_t)halMicros();
+      send(ip, port, r);
+    } else if (m.type == CLUSTER_PRESS) {
+      SeqWindow::Verdict verdict = p.seqs.check(m.seq);
+      if (verdict == SeqWindow::TOO_OLD) return;
+      if (verdict == SeqWindow::FRESH) {
+        // Not acknowledged unless taken; the node sends it again.
+        if (pressHandler_ && !pressHandler_(m.board, m.a, m.t1, m.value, (m.b & CLUSTER_PRESS_TIE) != 0)) return;
+        p.seqs.mark(m.seq);
+        p.presses++;
+        p.lastErrorUs = m.value;
+      }
+      ClusterMsg ack = {};
+      ack.type = CLUSTER_PRESS_ACK;
+      ack.board = m.board;
+      ack.seq = m.seq;
+      send(ip, port, ack);
+    } else if (m.type == CLUSTER_CTRL_ACK) {
+      while (p.controlCount > 0 && (int32_t)(m.seq - p.control[p.controlStart].seq) >= 0) {
+        p.controlStart = (p.controlStart + 1) % MAX_CONTROL;
+        p.controlCount--;
+      }
+    }
+    return;
+  }
+
+  // Node
+  if (m.board != board_) return;
+  if (m.epoch != coordinatorEpoch_) {
+    // The coordinator booted again: its clock restarted, so the old
+    // estimate maps presses onto nothing. Pending presses wait for the
+    // first exchange against the new one.
+    // Its ROUND/PLACE seqs start over as well.
+    if (coordinatorEpoch_ != 0) clock_ = ClockSync();
+    coordinatorEpoch_ = m.epoch;
+    controlApplied_ = 0;
+  }
+  if (m.type == CLUSTER_SYNC_RESP) {
+    clock_.addSample(m.t1, m.t2, m.t3, rxUs);
+  } else if (m.type == CLUSTER_PRESS_ACK) {
+    for (int k = 0; k < pendingCount_; k++) {
+      Pending& q = pending_[(pendingStart_ + k) % MAX_PENDING];
+      if (q.seq != m.seq) continue;
+      // Drop it in place; acked entries at the head are trimmed below.
+      q.seq = 0;
+    }
+    while (pendingCount_ > 0 && pending_[pendingStart_].seq == 0) {
+      pendingStart_ = (pendingStart_ + 1) % MAX_PENDING;
+      pendingCount_--;
+    }
+  } else if (m.type == CLUSTER_ROUND || m.type == CLUSTER_PLACE) {
+    // Applied in seq order only; skip what the coordinator gave up on.
+    uint32_t base = (uint32_t)m.t1;
+    if ((int32_t)(base - 1 - controlApplied_) > 0) controlApplied_ = base - 1;
+    if (m.seq == controlApplied_ + 1) {
+      bool taken = m.type == CLUSTER_ROUND ? (!roundHandler_ || roundHandler_(m.a, m.value))
+                                           : (!placeHandler_ || placeHandler_(m.a, m.b));
+      if (taken) controlApplied_ = m.seq;
+    }
+    ClusterMsg ack = {};
+    ack.type = CLUSTER_CTRL_ACK;
+    ack.board = board_;
+    ack.seq = controlApplied_;
+    send(coordinator_, CLUSTER_PORT, ack);
+  }
+}
+
+void ClusterLink::sendPress(uint8_t station, int64_t localUs, bool tie)
+{
+  if (pendingCount_ == MAX_PENDING) {
+    pendingStart_ = (pendingStart_ + 1) % MAX_PENDING;
+    pendingCount_--;
+    droppedPresses_++;
+  }
+  Pending& q = pending_[(pendingStart_ + pendingCount_) % MAX_PENDING];
+  q.seq = ++pressSeq_;
+  if (q.seq == 0) q.seq = ++pressSeq_; // 0 marks an acked slot
+  q.station = station;
+  q.tie = tie;
+  q.localUs = localUs;
+  pendingCount_++;
+  sendPending(halMillis());
+}
+
+// (Re)send every unacknowledged press. Times are converted with the current
+// clock estimate, so a press queued before the first sync exchange goes
+// out as soon as there is one.
+void ClusterLink::sendPending(unsigned long nowMs)
+{
+  lastResendMs_ = nowMs;
+  if (!clock_.synced()) return;
+  for (int k = 0; k < pendingCount_; k++) {
+    const Pending& q = pending_[(pendingStart_ + k) % MAX_PENDING];
+    if (q.seq == 0) continue;
+    ClusterMsg m = {};
+    m.type = CLUSTER_PRESS;
+    m.board = board_;
+    m.a = q.station;
+    m.b = q.tie ? CLUSTER_PRESS_TIE : 0;
+    m.seq = q.seq;
+    m.t1 = clock_.toRemote(q.localUs);
+    m.value = clock_.errorBoundUs(q.localUs);
+    send(coordinator_, CLUSTER_PORT, m);
+  }
+}
+
+void ClusterLink::sendRound(uint8_t action, uint32_t durationMs)
+{
+  for (int b = 1; b < MAX_BOARDS; b++) {
+    if (!peers_[b].known) continue;
+    ClusterMsg m = {};
+    m.type = CLUSTER_ROUND;
+    m.board = (uint8_t)b;
+    m.a = action;
+    m.value = durationMs;
+    queueControl((uint8_t)b, m);
+  }
+}
+
+void ClusterLink::sendPlace(uint8_t board, uint8_t station, uint8_t place)
+{
+  if (board == 0 || board >= MAX_BOARDS || !peers_[board].known) return;
+  ClusterMsg m = {};
+  m.type = CLUSTER_PLACE;
+  m.board = board;
+  m.a = station;
+  m.b = place;
+  queueControl(board, m);
+}
+
+// Give m the board's next ROUND/PLACE seq, keep it until acknowledged and
+// send it once now. When the node has not acknowledged MAX_CONTROL of
+// them the oldest is given up; base tells the node to skip it.
+void ClusterLink::queueControl(uint8_t board, ClusterMsg& m)
+{
+  Peer& p = peers_[board];
+  if (p.controlCount == MAX_CONTROL) {
+    p.controlStart = (p.controlStart + 1) % MAX_CONTROL;
+    p.controlCount--;
+    p.controlDropped++;
+  }
+  m.seq = ++p.controlSeq;
+  if (m.seq == 0) m.seq = ++p.controlSeq;
+  p.control[(p.controlStart + p.controlCount) % MAX_CONTROL] = m;
+  p.controlCount++;
+  m.t1 = p.control[p.controlStart].seq;
+  send(p.ip, p.port, m);
+}
+
+// Resend every unacknowledged ROUND/PLACE, oldest first.
+void ClusterLink::sendControl(unsigned long nowMs)
+{
+  lastResendMs_ = nowMs;
+  for (int b = 1; b < MAX_BOARDS; b++) {
+    Peer& p = peers_[b];
+    for (int k = 0; k < p.controlCount; k++) {
+      ClusterMsg& m = p.control[(p.controlStart + k) % MAX_CONTROL];
+      m.t1 = p.control[p.controlStart].seq;
+      send(p.ip, p.port, m);
+    }
+  }
+}
+
+void ClusterLink::send(uint32_t ip, uint16_t port, ClusterMsg& m)
+{
+  uint8_t buf[CLUSTER_MSG_LEN];
+  m.epoch = epoch_;
+  clusterEncode(buf, m);
+  udp_.send(ip, port, buf, sizeof(buf));
+}
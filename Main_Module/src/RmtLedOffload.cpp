@@ -0,0 +1,76 @@
+#include "LedOffload.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Arduino.h>
+#include <driver/rmt.h>
+
+RmtLedOffload::RmtLedOffload(const int* pins, int leds, int firstChannel, int channels)
+  : pins_(pins), leds_(leds), firstChannel_(firstChannel), channels_(0), busy_(0)
+{
+  wanted_ = channels < MAX_CHANNELS ? channels : MAX_CHANNELS;
+  for (int c = 0; c < MAX_CHANNELS; c++) owner_[c] = -1;
+}
+
+// Every channel is configured and its driver installed once, here.
+// rmt_config() needs a valid pin, so each is set up on the first LED's pin
+// and the pin handed straight back to its GPIO latch (low at boot); start()
+// and stop() only route a channel to an LED and back. From the first
+// channel that fails to install on, channels are left out.
+bool RmtLedOffload::begin()
+{
+  if (leds_ <= 0) return false;
+  int installed = channels_;
+  for (int c = channels_; c < wanted_; c++) {
+    rmt_channel_t ch = (rmt_channel_t)(firstChannel_ + c);
+    rmt_config_t cfg = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pins_[0], ch);
+    cfg.clk_div = 250;                       // 1 MHz REF_TICK / 250 = 4 ticks per ms
+    cfg.flags |= RMT_CHANNEL_FLAGS_AWARE_DFS; // REF_TICK source, stable across DFS
+    cfg.tx_config.loop_en = true;
+    cfg.tx_config.carrier_en = false;
+    cfg.tx_config.idle_output_en = true;
+    cfg.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    if (rmt_config(&cfg) != ESP_OK || rmt_driver_install(ch, 0, 0) != ESP_OK) break;
+    installed++;
+  }
+  pinMatrixOutDetach(pins_[0], false, false);
+  channels_ = installed;
+  return installed > 0;
+}
+
+bool RmtLedOffload::start(int led, const LedPattern* p, unsigned long now)
+{
+  if (led < 0 || led >= leds_ || !rmtLedPatternFits(p)) return false;
+  int c = 0;
+  while (c < channels_ && owner_[c] != -1) c++;
+  if (c == channels_) return false;
+  rmt_channel_t ch = (rmt_channel_t)(firstChannel_ + c);
+
+  rmt_item32_t items[RMT_LED_MAX_STEPS / 2 + 1];
+  int n = 0;
+  for (int k = 0; k < p->steps; k += 2, n++) {
+    items[n].level0 = 1;
+    items[n].duration0 = p->stepsMs[k] * RMT_LED_TICKS_PER_MS;
+    items[n].level1 = 0;
+    items[n].duration1 = p->stepsMs[k + 1] * RMT_LED_TICKS_PER_MS;
+  }
+  items[n].val = 0; // end marker; loop mode restarts from item 0
+  if (rmt_fill_tx_items(ch, items, n + 1, 0) != ESP_OK) return false;
+  if (rmt_set_gpio(ch, RMT_MODE_TX, (gpio_num_t)pins_[led], false) != ESP_OK) return false;
+  rmt_tx_start(ch, true);
+
+  owner_[c] = (int8_t)led;
+  busy_++;
+  return true;
+}
+
+void RmtLedOffload::stop(int led)
+{
+  for (int c = 0; c < channels_; c++) {
+    if (owner_[c] != led) continue;
+    rmt_tx_stop((rmt_channel_t)(firstChannel_ + c));
+    pinMatrixOutDetach(pins_[led], false, false); // back to the GPIO output latch
+    owner_[c] = -1;
+    busy_--;
+  }
+}
+#endif
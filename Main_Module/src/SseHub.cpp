@@ -0,0 +1,143 @@
+#include "SseHub.h"
+
+static const char HEARTBEAT[] = ": ping\n\n";
+
+SseHub::SseHub()
+  : policy_(DROP_OLDEST), nextId_(1), count_(0), rejected_(0), evictions_(0)
+{
+  for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) subs_[i].client = NULL;
+}
+
+bool SseHub::attach(HalStreamClient* client, bool hasLastId, uint32_t lastId)
+{
+  for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+    Subscriber& sub = subs_[i];
+    if (sub.client != NULL) continue;
+    unsigned long now = halMillis();
+    sub.client = client;
+    sub.queue.clear();
+    sub.queue.resetCounters();
+    sub.connectedMs = now;
+    sub.lastProgressMs = now;
+    sub.lastWriteMs = now;
+    sub.writeFailures = 0;
+    sub.closing = false;
+    count_++;
+    if (hasLastId) replayAfter(sub, lastId);
+    return true;
+  }
+  rejected_++;
+  return false;
+}
+
+void SseHub::detach(HalStreamClient* client)
+{
+  for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+    if (subs_[i].client == client) {
+      subs_[i].client = NULL;
+      subs_[i].queue.clear();
+      count_--;
+    }
+  }
+}
+
+void SseHub::onWritable(HalStreamClient* client)
+{
+  unsigned long now = halMillis();
+  for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+    if (subs_[i].client == client) drain(subs_[i], now);
+  }
+}
+
+// If some missed events are gone (or the id is from before a reboot) tell
+// the client to resync from /api/status instead.
+void SseHub::replayAfter(Subscriber& sub, uint32_t lastId)
+{
+  if (!replay_.canResumeAfter(lastId)) {
+    // Carries the newest id so the client resumes from here next time.
+    scratch_.begin("resync", nextId_ - 1);
+    scratch_.add("type", "resync");
+    scratch_.end();
+    sub.queue.push(scratch_.data(), scratch_.length());
+  } else {
+    for (int k = 0; k < replay_.count(); k++) {
+      size_t len;
+      uint32_t id;
+      const char* data = replay_.frame(k, len, id);
+      if (id > lastId) sub.queue.push(data, len);
+    }
+  }
+  drain(sub, halMillis());
+}
+
+// Hand as much of a subscriber's queue to TCP as its window allows. Never
+// blocks.
+void SseHub::drain(Subscriber& sub, unsigned long now)
+{
+  HalStreamClient* c = sub.client;
+  if (c == NULL || sub.closing) return;
+  bool progress = false;
+  while (!sub.queue.empty()) {
+    size_t room = c->space();
+    if (room == 0) break;
+    size_t len;
+    const char* p = sub.queue.front(len);
+    size_t n = len < room ? len : room;
+    size_t added = c->add(p, n);
+    if (added == 0) {
+      sub.writeFailures++;
+      break;
+    }
+    sub.queue.consume(added);
+    progress = true;
+  }
+  if (progress) {
+    if (!c->send()) sub.writeFailures++;
+    sub.lastProgressMs = now;
+    sub.lastWriteMs = now;
+  }
+}
+
+// The client stays in its slot, marked closing and skipped, until the
+// stream-close callback calls detach().
+void SseHub::evict(Subscriber& sub)
+{
+  evictions_++;
+  sub.closing = true;
+  sub.queue.clear();
+  sub.client->close(true);
+}
+
+void SseHub::broadcast(const SseFrame& frame)
+{
+  if (frame.overflowed()) return;
+  if (frame.id() != 0) replay_.add(frame.id(), frame.data(), frame.length());
+  unsigned long now = halMillis();
+  for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+    Subscriber& sub = subs_[i];
+    if (sub.client == NULL || sub.closing) continue;
+    if (sub.queue.empty()) sub.lastProgressMs = now;
+    bool fit = sub.queue.push(frame.data(), frame.length());
+    drain(sub, now);
+    bool stalled = !sub.queue.empty() && now - sub.lastProgressMs > STALL_TIMEOUT_MS;
+    if ((!fit && policy_ == DISCONNECT) || stalled) evict(sub);
+  }
+}
+
+void SseHub::service(unsigned long now)
+{
+  for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+    Subscriber& sub = subs_[i];
+    if (sub.client == NULL || sub.closing) continue;
+    if (!sub.queue.empty()) {
+      if (now - sub.lastProgressMs > STALL_TIMEOUT_MS) evict(sub);
+      else drain(sub, now);
+      continue;
+    }
+    if (now - sub.lastWriteMs >= HEARTBEAT_MS) {
+      sub.queue.push(HEARTBEAT, sizeof(HEARTBEAT) - 1);
+      sub.lastProgressMs = now;
+      drain(sub, now);
+    }
+  }
+}
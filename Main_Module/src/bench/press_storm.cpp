@@ -0,0 +1,378 @@
+// Press-storm benchmark for the game core (pio run -e native-bench).
+//
+// Replays generated button waveforms (reaction times, mashing, contact
+// bounce, short glitches on idle lines) into a SimBoard on the virtual
+// clock and models the rest of the device around it: pin interrupt
+// latency, the debounce scan timer, arbiter and network task wakeups,
+// and HTTP clients polling /api/status, which hold the server lock the
+// network task needs before it can write SSE frames. For every scenario it
+// prints one JSON line with press-to-record and press-to-SSE histograms,
+// how far recorded timestamps are from the true first contact,
+// misorderings against those contacts, dropped and phantom presses, the
+// debouncer's bounce and glitch counts and queue overflows, so runs can be
+// compared between builds.
+//
+//   program                         run the built-in suite
+//   program --scenario mash-bounce  run one scenario
+//   program --bounceMax 12 ...      override any scenario field
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <queue>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include "SimBoard.h"
+#include "RoundFrames.h"
+#include "SseHub.h"
+
+const int STATIONS = 10;
+
+struct Scenario {
+  const char* name;
+  uint32_t teams;          // stations that take part
+  uint32_t rounds;
+  uint32_t roundMs;
+  double reactionMeanMs;   // first press after the round starts
+  double reactionSdMs;
+  double mashHz;           // further presses per second per team, 0 = one press
+  uint32_t holdMs;         // how long each press is held down
+  uint32_t bounceMax;      // bounces per transition, uniform 0..bounceMax
+  uint32_t bounceSpanUs;   // bounces happen within this long after a transition
+  uint32_t glitchHz;       // short low pulses per second per idle station
+  uint32_t glitchUs;       // pulse width
+  uint32_t isrLatencyUs;   // edge -> switch ISR reads the inputs
+  uint32_t scanHz;         // debounce scan timer
+  uint32_t tieWindowUs;
+  uint32_t arbiterWakeUs;  // notify -> arbiter task runs
+  uint32_t netWakeUs;      // notify -> network task runs
+  uint32_t pollMs;         // /api/status interval per client, 0 = no polling
+  uint32_t pollClients;
+  uint32_t statusHoldUs;   // server lock held per /api/status request
+  uint32_t seed;
+};
+
+const Scenario SUITE[] = {
+  // name          teams rounds roundMs  mean  sd  mash hold bMax span  gHz gUs isr  scan  tie arb net poll cl hold seed
+  {"single",          1,   20,   3000,  400,  80,   0,  120,  0,    0,   0,  0,  2, 1000, 1000, 15, 30,   0, 0,   0, 1},
+  {"all-ten",        10,   20,   3000,  300,  60,   0,  120,  0,    0,   0,  0,  2, 1000, 1000, 15, 30,   0, 0,   0, 2},
+  {"all-ten-bounce", 10,   20,   3000,  300,  60,   0,  120,  8, 3000,   0,  0,  2, 1000, 1000, 15, 30,   0, 0,   0, 3},
+  {"mash-bounce",    10,   20,   3000,  300,  60,   8,   40,  8, 3000,   0,  0,  2, 1000, 1000, 15, 30,   0, 0,   0, 4},
+  {"mash-bounce-poll",10,  20,   3000,  300,  60,   8,   40,  8, 3000,   0,  0,  2, 1000, 1000, 15, 30, 100, 4, 400, 5},
+  {"glitch-bounce",   4,   20,   3000,  300,  60,   0,  120,  8, 3000,  20, 20,  2, 1000, 1000, 15, 30,   0, 0,   0, 6},
+};
+
+// Field table for --name value overrides.
+struct Field {
+  const char* name;
+  size_t offset;
+  bool isDouble;
+};
+#define FIELD(f, d) {#f, offsetof(Scenario, f), d}
+const Field FIELDS[] = {
+  FIELD(teams, false), FIELD(rounds, false), FIELD(roundMs, false), FIELD(reactionMeanMs, true),
+  FIELD(reactionSdMs, true), FIELD(mashHz, true), FIELD(holdMs, false), FIELD(bounceMax, false),
+  FIELD(bounceSpanUs, false), FIELD(glitchHz, false), FIELD(glitchUs, false), FIELD(isrLatencyUs, false),
+  FIELD(scanHz, false), FIELD(tieWindowUs, false), FIELD(arbiterWakeUs, false),
+  FIELD(netWakeUs, false), FIELD(pollMs, false), FIELD(pollClients, false), FIELD(statusHoldUs, false),
+  FIELD(seed, false),
+};
+
+struct PinEdge {
+  uint64_t us;
+  int team;
+  bool down;
+  bool operator<(const PinEdge& o) const { return us < o.us; }
+};
+
+// A transition plus its contact bounce: the pin flips back and forth at
+// random points in the bounce span and settles on `down`.
+void addTransition(std::vector<PinEdge>& out, std::mt19937& rng, const Scenario& s, int team, uint64_t us, bool down)
+{
+  out.push_back({us, team, down});
+  uint32_t bounces = s.bounceMax ? std::uniform_int_distribution<uint32_t>(0, s.bounceMax)(rng) : 0;
+  if (bounces == 0 || s.bounceSpanUs == 0) return;
+  std::vector<uint64_t> at;
+  for (uint32_t k = 0; k < 2 * bounces; k++) {
+    at.push_back(us + 1 + std::uniform_int_distribution<uint32_t>(0, s.bounceSpanUs - 1)(rng));
+  }
+  std::sort(at.begin(), at.end());
+  for (size_t k = 0; k < at.size(); k++) out.push_back({at[k], team, (k % 2 == 0) ? !down : down});
+}
+
+// Every pin transition of one round, and each team's first contact. Idle
+// stations, and active ones before they press, get glitch pulses.
+std::vector<PinEdge> makeRound(std::mt19937& rng, const Scenario& s, uint64_t startUs, uint64_t* firstUs)
+{
+  std::vector<PinEdge> edges;
+  std::normal_distribution<double> reaction(s.reactionMeanMs, s.reactionSdMs);
+  std::exponential_distribution<double> gap(s.mashHz > 0 ? s.mashHz : 1.0);
+  uint64_t endUs = startUs + (uint64_t)s.roundMs * 1000;
+  uint64_t holdUs = (uint64_t)s.holdMs * 1000;
+  for (int t = 0; t < STATIONS; t++) firstUs[t] = 0;
+  for (uint32_t t = 0; t < s.teams && t < (uint32_t)STATIONS; t++) {
+    double ms = reaction(rng);
+    if (ms < 1) ms = 1;
+    uint64_t at = startUs + (uint64_t)(ms * 1000);
+    firstUs[t] = at < endUs ? at : 0;
+    while (at < endUs) {
+      addTransition(edges, rng, s, (int)t, at, true);
+      addTransition(edges, rng, s, (int)t, at + holdUs, false);
+      if (s.mashHz <= 0) break;
+      at += holdUs + s.bounceSpanUs + 1000 + (uint64_t)(gap(rng) * 1e6);
+    }
+  }
+  if (s.glitchHz > 0 && s.glitchUs > 0) {
+    std::exponential_distribution<double> glitchGap(s.glitchHz);
+    for (int t = 0; t < STATIONS; t++) {
+      uint64_t quietUs = !firstUs[t] ? endUs : firstUs[t] > startUs + 10000 ? firstUs[t] - 10000 : startUs;
+      for (uint64_t at = startUs + (uint64_t)(glitchGap(rng) * 1e6); at + s.glitchUs < quietUs;
+           at += s.glitchUs + (uint64_t)(glitchGap(rng) * 1e6)) {
+        edges.push_back({at, t, true});
+        edges.push_back({at + s.glitchUs, t, false});
+      }
+    }
+  }
+  std::stable_sort(edges.begin(), edges.end());
+  return edges;
+}
+
+enum SimEventType { EV_PIN, EV_ISR, EV_SCAN, EV_ARBITER, EV_NET, EV_POLL };
+struct SimEvent {
+  uint64_t us;
+  uint64_t seq;
+  int type;
+  uint32_t arg;
+  bool operator>(const SimEvent& o) const { return us != o.us ? us > o.us : seq > o.seq; }
+};
+
+void printHistogram(const char* name, const LatencyHistogram& h)
+{
+  printf("\"%s\":{\"count\":%u,\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u,\"buckets\":[",
+         name, h.count(), h.percentile(50), h.percentile(90), h.percentile(99), h.max());
+  int last = -1;
+  for (int b = 0; b < LatencyHistogram::BUCKETS; b++) if (h.bucket(b)) last = b;
+  for (int b = 0; b <= last; b++) printf("%s%u", b ? "," : "", h.bucket(b));
+  printf("]}");
+}
+
+void run(const Scenario& s)
+{
+  SimBoard<STATIONS> board;
+  SseHub sseHub;
+  SseFrame frame;
+  HalStreamClient client;
+  sseHub.attach(&client, false, 0);
+  std::mt19937 rng(s.seed);
+
+  LatencyHistogram pressToSseUs;
+  LatencyHistogram contactToStampUs; // first contact -> recorded press timestamp
+  LatencyHistogram arbiterPassNs;  // host time, not virtual
+  uint32_t presses = 0, recorded = 0, dropped = 0, phantom = 0, misordered = 0, misorderedInTies = 0, ties = 0;
+  uint32_t edgesSeen = 0, isrRuns = 0, statusRequests = 0;
+
+  std::priority_queue<SimEvent, std::vector<SimEvent>, std::greater<SimEvent> > events;
+  uint64_t seq = 0;
+  auto schedule = [&](uint64_t us, int type, uint32_t arg) { events.push({us, seq++, type, arg}); };
+
+  uint64_t arbiterAt = UINT64_MAX, netAt = UINT64_MAX, lockFreeAt = 0;
+  auto notifyArbiter = [&](uint64_t now) {
+    uint64_t at = now + s.arbiterWakeUs;
+    if (at < arbiterAt) { arbiterAt = at; schedule(at, EV_ARBITER, 0); }
+  };
+  auto notifyNet = [&](uint64_t now) {
+    uint64_t at = now + s.netWakeUs;
+    if (at < netAt) { netAt = at; schedule(at, EV_NET, 0); }
+  };
+
+  uint64_t startUs = 1000000;
+  board.command(CMD_SET_DURATION, s.roundMs);
+  board.command(CMD_SET_TIE_WINDOW, s.tieWindowUs);
+  for (uint32_t r = 0; r < s.rounds; r++) {
+    simClockSetUs(startUs);
+    uint64_t firstUs[STATIONS];
+    std::vector<PinEdge> wave = makeRound(rng, s, startUs, firstUs);
+    for (size_t k = 0; k < wave.size(); k++) schedule(wave[k].us, EV_PIN, (uint32_t)k);
+    if (s.pollMs) {
+      for (uint32_t c = 0; c < s.pollClients; c++) {
+        schedule(startUs + std::uniform_int_distribution<uint32_t>(0, s.pollMs * 1000 - 1)(rng), EV_POLL, 0);
+      }
+    }
+    if (s.scanHz) schedule(startUs, EV_SCAN, 0);
+    board.command(CMD_START);
+    arbiterAt = UINT64_MAX;
+    notifyArbiter(startUs);
+    notifyNet(startUs);
+
+    int order[STATIONS];
+    int place[STATIONS];
+    int tieGroup[STATIONS];
+    bool tie[STATIONS];
+    uint64_t timeUs[STATIONS];
+    int count = 0;
+    uint64_t roundStartUs = startUs;
+    uint64_t stopUs = startUs + (uint64_t)s.roundMs * 1000 + 500000;
+    while (!events.empty() && events.top().us < stopUs) {
+      SimEvent ev = events.top();
+      events.pop();
+      simClockSetUs(ev.us);
+      uint64_t now = ev.us;
+      if (ev.type == EV_PIN) {
+        const PinEdge& p = wave[ev.arg];
+        uint32_t edges = board.setSwitches(1u << p.team, p.down);
+        if (edges) {
+          edgesSeen++;
+          schedule(now + s.isrLatencyUs, EV_ISR, edges);
+        }
+      } else if (ev.type == EV_ISR) {
+        isrRuns++;
+        if (board.isr(ev.arg) > 0) notifyArbiter(now);
+      } else if (ev.type == EV_SCAN) {
+        if (board.isr(0) > 0) notifyArbiter(now);
+        schedule(now + 1000000 / s.scanHz, EV_SCAN, 0);
+      } else if (ev.type == EV_ARBITER) {
+        if (now != arbiterAt) continue; // superseded by an earlier wakeup
+        arbiterAt = UINT64_MAX;
+        std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        unsigned long next = board.arbiterPass();
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        arbiterPassNs.record((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        if (next) {
+          uint64_t at = (uint64_t)next * 1000;
+          if (at <= now) at = now + 1;
+          if (at < arbiterAt) { arbiterAt = at; schedule(at, EV_ARBITER, 0); }
+        }
+        if (!board.netEvents.empty()) notifyNet(now);
+      } else if (ev.type == EV_NET) {
+        if (now != netAt) continue;
+        netAt = UINT64_MAX;
+        if (lockFreeAt > now) { // an HTTP handler has the server lock
+          netAt = lockFreeAt;
+          schedule(lockFreeAt, EV_NET, 0);
+          continue;
+        }
+        NetEvent e;
+        while (board.netEvents.pop(e)) {
+          if (e.type == NET_ROUND_START) {
+            roundStartUs = e.timeUs;
+          } else if (e.type == NET_PRESS) {
+            if (!firstUs[e.teamIndex]) {
+              phantom++;
+            } else if (count < STATIONS) {
+              order[count] = e.teamIndex;
+              place[count] = e.orderNo;
+              tieGroup[count] = e.tie ? e.tieGroup : -1;
+              tie[count] = e.tie;
+              timeUs[count] = e.timeUs;
+              count++;
+            }
+            renderPressFrame(frame, sseHub.nextId(), e, roundStartUs);
+            sseHub.broadcast(frame);
+            pressToSseUs.record((uint32_t)(now - e.timeUs));
+          } else if (e.type == NET_ROUND_END) {
+            renderResultFrame(frame, sseHub.nextId(), order, place, tieGroup, count);
+            sseHub.broadcast(frame);
+          }
+        }
+        client.ack(client.inFlight);
+      } else if (ev.type == EV_POLL) {
+        statusRequests++;
+        lockFreeAt = (lockFreeAt > now ? lockFreeAt : now) + s.statusHoldUs;
+        if (lockFreeAt < stopUs) schedule(now + (uint64_t)s.pollMs * 1000, EV_POLL, 0);
+      }
+    }
+    while (!events.empty()) events.pop(); // stale polls and wakeups
+    netAt = UINT64_MAX;
+
+    // Score the round against the waveform's first contacts.
+    for (int t = 0; t < STATIONS; t++) if (firstUs[t]) presses++;
+    recorded += count;
+    for (int t = 0; t < STATIONS; t++) {
+      if (!firstUs[t]) continue;
+      bool found = false;
+      for (int k = 0; k < count; k++) found = found || order[k] == t;
+      if (!found) dropped++;
+    }
+    for (int k = 0; k < count; k++) {
+      if (tie[k]) ties++;
+      contactToStampUs.record((uint32_t)(timeUs[k] - firstUs[order[k]]));
+    }
+    for (int a = 0; a < count; a++) {
+      for (int b = a + 1; b < count; b++) {
+        if (firstUs[order[b]] >= firstUs[order[a]]) continue;
+        misordered++;
+        if (tieGroup[a] >= 0 && tieGroup[a] == tieGroup[b]) misorderedInTies++;
+      }
+    }
+    startUs = stopUs + 1000000;
+  }
+
+  uint32_t bounces = 0, glitches = 0;
+  for (int i = 0; i < STATIONS; i++) {
+    bounces += board.inputScanner.stats(i).bounces;
+    glitches += board.inputScanner.stats(i).glitches;
+  }
+  printf("{\"scenario\":\"%s\",\"config\":{", s.name);
+  for (size_t f = 0; f < sizeof(FIELDS) / sizeof(FIELDS[0]); f++) {
+    const char* p = (const char*)&s + FIELDS[f].offset;
+    if (FIELDS[f].isDouble) printf("%s\"%s\":%g", f ? "," : "", FIELDS[f].name, *(const double*)p);
+    else printf("%s\"%s\":%u", f ? "," : "", FIELDS[f].name, *(const uint32_t*)p);
+  }
+  printf("},\"presses\":%u,\"recorded\":%u,\"dropped\":%u,\"phantom\":%u,\"misordered\":%u,\"misorderedInTies\":%u,"
+         "\"ties\":%u,\"edges\":%u,\"isrRuns\":%u,\"statusRequests\":%u,"
+         "\"pressQueueDropped\":%u,\"netQueueDropped\":%u,\"sseBytes\":%u,"
+         "\"bounces\":%u,\"glitches\":%u,",
+         presses, recorded, dropped, phantom, misordered, misorderedInTies, ties, edgesSeen, isrRuns, statusRequests,
+         board.pressEvents.dropped(), board.netEvents.dropped(), (unsigned)client.sent.size(),
+         bounces, glitches);
+  printHistogram("pressToRecordUs", board.game.pressToRecordUs());
+  printf(",");
+  printHistogram("pressToSseUs", pressToSseUs);
+  printf(",");
+  printHistogram("contactToStampUs", contactToStampUs);
+  printf(",");
+  printHistogram("hostArbiterPassNs", arbiterPassNs);
+  printf("}\n");
+}
+
+int main(int argc, char** argv)
+{
+  const char* only = NULL;
+  std::vector<std::pair<const Field*, const char*> > overrides;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char* key = argv[i] + (strncmp(argv[i], "--", 2) == 0 ? 2 : 0);
+    if (strcmp(key, "scenario") == 0) {
+      only = argv[i + 1];
+      continue;
+    }
+    const Field* field = NULL;
+    for (size_t f = 0; f < sizeof(FIELDS) / sizeof(FIELDS[0]); f++) {
+      if (strcmp(FIELDS[f].name, key) == 0) field = &FIELDS[f];
+    }
+    if (field == NULL) {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+    overrides.push_back(std::make_pair(field, argv[i + 1]));
+  }
+
+  int runs = 0;
+  for (size_t k = 0; k < sizeof(SUITE) / sizeof(SUITE[0]); k++) {
+    if (only != NULL && strcmp(only, SUITE[k].name) != 0) continue;
+    Scenario s = SUITE[k];
+    for (size_t o = 0; o < overrides.size(); o++) {
+      char* p = (char*)&s + overrides[o].first->offset;
+      if (overrides[o].first->isDouble) *(double*)p = atof(overrides[o].second);
+      else *(uint32_t*)p = (uint32_t)strtoul(overrides[o].second, NULL, 10);
+    }
+    if (s.teams > (uint32_t)STATIONS) s.teams = STATIONS;
+    run(s);
+    runs++;
+  }
+  if (runs == 0) {
+    fprintf(stderr, "no scenario named %s\n", only);
+    return 2;
+  }
+  return 0;
+}
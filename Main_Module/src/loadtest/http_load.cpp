@@ -0,0 +1,438 @@
+// HTTP load generator for the board's REST server (pio run -e
+// native-http-load), for comparing firmware builds on real hardware.
+//
+// Each scenario runs for a fixed time against a board on the network and
+// prints one JSON line: requests, errors, throughput and request latency
+// percentiles as the clients saw them, and, when the firmware serves
+// /api/metrics, how the arbiter's timed wakeups slipped (arbiterLateUs) and
+// how long route handlers ran during the scenario, from the histogram
+// deltas. Builds without /api/metrics (such as the synchronous WebServer
+// one) report those as null; the client-side numbers still compare.
+//
+//   keepalive   clients poll GET /api/status over persistent connections
+//   close       the same with a new connection per request
+//   slow-body   keepalive, while one more client sends a POST
+//               /api/game/config body a byte at a time (the body is not
+//               JSON, so the config stays as it is)
+//   idle        no load, as the jitter baseline
+//   command-rtt one client, one request at a time: a no-op command on the
+//               /ws channel (PING, answered with an ACK) against GET
+//               /api/time over a kept-alive and over a new connection
+//
+//   program <host> [--port 80] [--ws-port 81] [--seconds 10] [--clients 4]
+//           [--scenario name]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+  const char* host = NULL;
+  const char* port = "80";
+  const char* wsPort = "81";
+  double seconds = 10;
+  int clients = 4;
+  const char* scenario = NULL;
+};
+
+Options opt;
+
+int64_t nowUs()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+int connectTo(const char* port)
+{
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res = NULL;
+  if (getaddrinfo(opt.host, port, &hints, &res) != 0 || res == NULL) return -1;
+  int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  if (fd >= 0) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    timeval tv = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(res);
+  return fd;
+}
+
+bool sendAll(int fd, const char* p, size_t len)
+{
+  while (len > 0) {
+    ssize_t n = ::send(fd, p, len, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    p += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+// Read one response with a Content-Length body. Returns the status code,
+// or -1 on a closed or timed-out connection; `keep` tells whether the
+// server left the connection open.
+int readResponse(int fd, std::string& body, bool& keep)
+{
+  std::string in;
+  char buf[2048];
+  size_t headEnd;
+  while ((headEnd = in.find("\r\n\r\n")) == std::string::npos) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return -1;
+    in.append(buf, (size_t)n);
+  }
+  std::string head = in.substr(0, headEnd);
+  for (char& c : head) c = (char)tolower(c);
+  size_t cl = head.find("content-length:");
+  size_t want = cl == std::string::npos ? 0 : strtoul(head.c_str() + cl + 15, NULL, 10);
+  keep = head.find("connection: close") == std::string::npos;
+  body = in.substr(headEnd + 4);
+  while (body.size() < want) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return -1;
+    body.append(buf, (size_t)n);
+  }
+  return atoi(head.c_str() + 9);
+}
+
+// One GET on a fresh connection, for /api/metrics snapshots.
+bool fetch(const char* path, std::string& body)
+{
+  int fd = connectTo(opt.port);
+  if (fd < 0) return false;
+  std::string req = std::string("GET ") + path + " HTTP/1.1\r\nHost: " + opt.host + "\r\nConnection: close\r\n\r\n";
+  bool keep;
+  int code = sendAll(fd, req.data(), req.size()) ? readResponse(fd, body, keep) : -1;
+  close(fd);
+  return code == 200;
+}
+
+// Bucket counts of one histogram in a /api/metrics document.
+std::vector<uint64_t> histogramBuckets(const std::string& json, const char* name)
+{
+  std::vector<uint64_t> out;
+  size_t at = json.find(std::string("\"") + name + "\"");
+  if (at == std::string::npos) return out;
+  at = json.find("\"buckets\"", at);
+  if (at == std::string::npos || (at = json.find('[', at)) == std::string::npos) return out;
+  const char* p = json.c_str() + at + 1;
+  for (;;) {
+    char* end;
+    unsigned long long v = strtoull(p, &end, 10);
+    if (end == p) break;
+    out.push_back(v);
+    p = end;
+    while (*p == ' ' || *p == ',') p++;
+  }
+  return out;
+}
+
+// Percentile of the samples recorded between two snapshots, as the upper
+// bound of its bucket (bucket k holds samples up to 2^(k+1) - 1 µs).
+uint64_t bucketPercentile(const std::vector<uint64_t>& d, double pct)
+{
+  uint64_t total = 0;
+  for (uint64_t c : d) total += c;
+  if (total == 0) return 0;
+  uint64_t rank = (uint64_t)(total * pct / 100.0 + 0.5);
+  if (rank == 0) rank = 1;
+  uint64_t seen = 0;
+  for (size_t k = 0; k < d.size(); k++) {
+    seen += d[k];
+    if (seen >= rank) return (2ull << k) - 1;
+  }
+  return (2ull << (d.size() - 1)) - 1;
+}
+
+void printHistogramDelta(const char* name, bool haveMetrics, const std::string& before, const std::string& after)
+{
+  printf(",\"%s\":", name);
+  std::vector<uint64_t> a = histogramBuckets(before, name), b = histogramBuckets(after, name);
+  if (!haveMetrics || b.empty()) {
+    printf("null");
+    return;
+  }
+  std::vector<uint64_t> d(b.size());
+  uint64_t count = 0;
+  for (size_t k = 0; k < b.size(); k++) {
+    d[k] = b[k] - (k < a.size() ? a[k] : 0);
+    count += d[k];
+  }
+  printf("{\"count\":%llu,\"p50\":%llu,\"p99\":%llu}", (unsigned long long)count,
+         (unsigned long long)bucketPercentile(d, 50), (unsigned long long)bucketPercentile(d, 99));
+}
+
+// Minimal RFC 6455 client for the /ws channel: the device's frames are
+// small and never fragmented, and client frames must be masked.
+struct WsClient {
+  int fd = -1;
+  std::string in;
+
+  bool open() {
+    fd = connectTo(opt.wsPort);
+    if (fd < 0) return false;
+    std::string req = std::string("GET /ws HTTP/1.1\r\nHost: ") + opt.host +
+                      "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                      "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    if (!sendAll(fd, req.data(), req.size())) return false;
+    size_t headEnd;
+    while ((headEnd = in.find("\r\n\r\n")) == std::string::npos) {
+      if (!fill()) return false;
+    }
+    bool upgraded = in.compare(0, 12, "HTTP/1.1 101") == 0;
+    in.erase(0, headEnd + 4);
+    return upgraded;
+  }
+
+  bool fill() {
+    char buf[512];
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return false;
+    in.append(buf, (size_t)n);
+    return true;
+  }
+
+  bool sendFrame(uint8_t opcode, const uint8_t* data, size_t len) {
+    uint8_t frame[2 + 4 + 125];
+    if (len > 125) return false;
+    const uint8_t mask[4] = {0x37, 0xFA, 0x21, 0x3D};
+    frame[0] = 0x80 | opcode;
+    frame[1] = 0x80 | (uint8_t)len;
+    memcpy(frame + 2, mask, 4);
+    for (size_t k = 0; k < len; k++) frame[6 + k] = data[k] ^ mask[k % 4];
+    return sendAll(fd, (const char*)frame, 6 + len);
+  }
+
+  // Next binary message; pings (the server's heartbeat) are answered on
+  // the way.
+  bool receive(std::string& msg) {
+    for (;;) {
+      while (in.size() < 2) if (!fill()) return false;
+      uint8_t opcode = (uint8_t)in[0] & 0x0F;
+      size_t len = (uint8_t)in[1] & 0x7F, head = 2;
+      if (len == 126) {
+        while (in.size() < 4) if (!fill()) return false;
+        len = ((size_t)(uint8_t)in[2] << 8) | (uint8_t)in[3];
+        head = 4;
+      } else if (len == 127) {
+        return false;
+      }
+      while (in.size() < head + len) if (!fill()) return false;
+      msg = in.substr(head, len);
+      in.erase(0, head + len);
+      if (opcode == 0x9) sendFrame(0xA, (const uint8_t*)msg.data(), msg.size());
+      else if (opcode == 0x8) return false;
+      else if (opcode == 0x2) return true;
+    }
+  }
+
+  ~WsClient() { if (fd >= 0) close(fd); }
+};
+
+void printPercentiles(const char* name, std::vector<uint32_t> v)
+{
+  std::sort(v.begin(), v.end());
+  auto pct = [&](double p) -> uint32_t {
+    if (v.empty()) return 0;
+    return v[(size_t)(p / 100.0 * (v.size() - 1) + 0.5)];
+  };
+  printf(",\"%s\":{\"samples\":%zu,\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u}", name, v.size(),
+         pct(50), pct(90), pct(99), v.empty() ? 0 : v.back());
+}
+
+// Round trips of the cheapest command on each transport, a third of the
+// run each, strictly one at a time so they measure latency, not queueing.
+void runCommandRtt()
+{
+  double each = opt.seconds / 3;
+  std::vector<uint32_t> ws, httpKeep, httpNew;
+  uint64_t errors = 0;
+
+  WsClient c;
+  if (c.open()) {
+    uint8_t cmd[12] = {4};  // WS_OP_PING
+    std::string msg;
+    int64_t end = nowUs() + (int64_t)(each * 1e6);
+    for (uint32_t seq = 1; nowUs() < end; seq++) {
+      for (int k = 0; k < 4; k++) cmd[4 + k] = (uint8_t)(seq >> (8 * k));
+      int64_t t0 = nowUs();
+      if (!c.sendFrame(0x2, cmd, sizeof(cmd))) { errors++; break; }
+      bool acked = false;
+      while (!acked && c.receive(msg)) {
+        // Skip pushed round updates; the ACK echoes seq at offset 4.
+        acked = msg.size() >= 8 && (uint8_t)msg[0] == 0x80 && memcmp(msg.data() + 4, cmd + 4, 4) == 0;
+      }
+      if (!acked) { errors++; break; }
+      ws.push_back((uint32_t)(nowUs() - t0));
+    }
+  } else {
+    errors++;
+  }
+
+  for (int fresh = 0; fresh < 2; fresh++) {
+    std::vector<uint32_t>& out = fresh ? httpNew : httpKeep;
+    std::string req = std::string("GET /api/time?t1=0 HTTP/1.1\r\nHost: ") + opt.host +
+                      (fresh ? "\r\nConnection: close\r\n\r\n" : "\r\n\r\n");
+    std::string body;
+    int fd = -1;
+    int64_t end = nowUs() + (int64_t)(each * 1e6);
+    while (nowUs() < end) {
+      int64_t t0 = nowUs();  // a new connection's handshake counts
+      if (fd < 0 && (fd = connectTo(opt.port)) < 0) { errors++; break; }
+      bool keep = false;
+      int code = sendAll(fd, req.data(), req.size()) ? readResponse(fd, body, keep) : -1;
+      if (code == 200) out.push_back((uint32_t)(nowUs() - t0));
+      else errors++;
+      if (fresh || code < 0 || !keep) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    if (fd >= 0) close(fd);
+  }
+
+  printf("{\"scenario\":\"command-rtt\",\"errors\":%llu", (unsigned long long)errors);
+  printPercentiles("wsPingUs", ws);
+  printPercentiles("httpKeepAliveUs", httpKeep);
+  printPercentiles("httpNewConnectionUs", httpNew);
+  printf("}\n");
+  fflush(stdout);
+}
+
+struct ClientStats {
+  std::vector<uint32_t> latencyUs;
+  uint64_t errors = 0;
+};
+
+// GET /api/status until `stop`, reconnecting whenever the connection is
+// not (or no longer) kept alive.
+void pollStatus(bool keepAlive, std::atomic<bool>& stop, ClientStats& st)
+{
+  std::string req = std::string("GET /api/status HTTP/1.1\r\nHost: ") + opt.host +
+                    (keepAlive ? "\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+  int fd = -1;
+  std::string body;
+  while (!stop.load()) {
+    if (fd < 0 && (fd = connectTo(opt.port)) < 0) {
+      st.errors++;
+      usleep(10000);
+      continue;
+    }
+    int64_t t0 = nowUs();
+    bool keep = false;
+    int code = sendAll(fd, req.data(), req.size()) ? readResponse(fd, body, keep) : -1;
+    if (code == 200) st.latencyUs.push_back((uint32_t)(nowUs() - t0));
+    else st.errors++;
+    if (code < 0 || !keep || !keepAlive) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  if (fd >= 0) close(fd);
+}
+
+// A client on a slow link: a 64-byte body, one byte every 100 ms.
+void slowBody(std::atomic<bool>& stop)
+{
+  while (!stop.load()) {
+    int fd = connectTo(opt.port);
+    if (fd < 0) {
+      usleep(100000);
+      continue;
+    }
+    std::string head = std::string("POST /api/game/config HTTP/1.1\r\nHost: ") + opt.host +
+                       "\r\nContent-Type: application/json\r\nContent-Length: 64\r\nConnection: close\r\n\r\n";
+    bool ok = sendAll(fd, head.data(), head.size());
+    for (int k = 0; ok && k < 64 && !stop.load(); k++) {
+      ok = sendAll(fd, "x", 1);
+      usleep(100000);
+    }
+    close(fd);
+  }
+}
+
+void runScenario(const char* name)
+{
+  bool keepAlive = strcmp(name, "close") != 0;
+  int clients = strcmp(name, "idle") == 0 ? 0 : opt.clients;
+  std::string before, after;
+  bool haveMetrics = fetch("/api/metrics", before);
+
+  std::atomic<bool> stop(false);
+  std::vector<ClientStats> stats(clients);
+  std::vector<std::thread> threads;
+  for (int c = 0; c < clients; c++) {
+    threads.emplace_back(pollStatus, keepAlive, std::ref(stop), std::ref(stats[c]));
+  }
+  if (strcmp(name, "slow-body") == 0) threads.emplace_back(slowBody, std::ref(stop));
+  int64_t t0 = nowUs();
+  usleep((useconds_t)(opt.seconds * 1e6));
+  stop.store(true);
+  for (std::thread& t : threads) t.join();
+  double elapsed = (nowUs() - t0) / 1e6;
+  if (haveMetrics) haveMetrics = fetch("/api/metrics", after);
+
+  std::vector<uint32_t> all;
+  uint64_t errors = 0;
+  for (const ClientStats& st : stats) {
+    all.insert(all.end(), st.latencyUs.begin(), st.latencyUs.end());
+    errors += st.errors;
+  }
+  printf("{\"scenario\":\"%s\",\"clients\":%d,\"seconds\":%.1f,\"requests\":%zu,\"errors\":%llu,"
+         "\"requestsPerS\":%.1f", name, clients, elapsed, all.size(), (unsigned long long)errors,
+         all.size() / elapsed);
+  printPercentiles("latencyUs", all);
+  printHistogramDelta("arbiterLateUs", haveMetrics, before, after);
+  printHistogramDelta("httpHandlerUs", haveMetrics, before, after);
+  printf("}\n");
+  fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+  for (int k = 1; k < argc; k++) {
+    const char* a = argv[k];
+    const char* v = k + 1 < argc ? argv[k + 1] : NULL;
+    if (strcmp(a, "--port") == 0 && v) { opt.port = v; k++; }
+    else if (strcmp(a, "--ws-port") == 0 && v) { opt.wsPort = v; k++; }
+    else if (strcmp(a, "--seconds") == 0 && v) { opt.seconds = atof(v); k++; }
+    else if (strcmp(a, "--clients") == 0 && v) { opt.clients = atoi(v); k++; }
+    else if (strcmp(a, "--scenario") == 0 && v) { opt.scenario = v; k++; }
+    else if (a[0] != '-' && opt.host == NULL) opt.host = a;
+    else {
+      fprintf(stderr, "unknown option %s\n", a);
+      return 2;
+    }
+  }
+  if (opt.host == NULL) {
+    fprintf(stderr, "usage: %s <host> [--port 80] [--ws-port 81] [--seconds 10] [--clients 4] [--scenario name]\n",
+            argv[0]);
+    return 2;
+  }
+  const char* suite[] = {"idle", "keepalive", "close", "slow-body"};
+  for (const char* name : suite) {
+    if (opt.scenario == NULL || strcmp(opt.scenario, name) == 0) runScenario(name);
+  }
+  if (opt.scenario == NULL || strcmp(opt.scenario, "command-rtt") == 0) runCommandRtt();
+  return 0;
+}
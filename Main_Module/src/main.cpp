@@ -1,115 +1,291 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <WebServer.h>
 #include <ArduinoJson.h>
 #include <ESPmDNS.h>
+#include "AsyncHttpServer.h"
+#include "SpscRing.h"
+#include "LatencyHistogram.h"
+#include "SseFrame.h"
+#include "SseHub.h"
+#include "LedPatternEngine.h"
+#include "GpioOutputBatch.h"
+#include "GpioInputSnapshot.h"
+#include "ShiftRegisterIO.h"
+#include "ToneSequencer.h"
+#include "InputScanner.h"
+#include "GameCore.h"
+#include "RoundFrames.h"
+#include <WebSocketsServer.h>
+#include "WsProtocol.h"
+#include "ClusterLink.h"
+#include "PrometheusText.h"
+#include "FlashFs.h"
+#include "PressJournal.h"
+#include "RoundHistory.h"
 
+// Number of buzzer stations. Up to 10 with one GPIO per switch and LED, up to
+// 32 with shift-register chains (-DBUZZER_IO=BUZZER_IO_SHIFT).
+#ifndef PARTICIPANTS
+#define PARTICIPANTS 10
+#endif
+#define BUZZER_IO_GPIO 0
+#define BUZZER_IO_SHIFT 1
+#ifndef BUZZER_IO
+#define BUZZER_IO BUZZER_IO_GPIO
+#endif
 
-// Pin definitions for 10 participants - CORRECTED according to your pinout plan
+// Multi-board clusters. Every board wires LOCAL_STATIONS stations; node
+// boards (ids 1..7) forward their presses to the coordinator (board 0),
+// where station s of board b is participant b * LOCAL_STATIONS + s. On the
+// coordinator, PARTICIPANTS counts the whole cluster and presses are held
+// for CLUSTER_MERGE_HOLD_MS so they can be merged in timestamp order.
+#define CLUSTER_STANDALONE 0
+#define CLUSTER_COORDINATOR 1
+#define CLUSTER_NODE 2
+#ifndef CLUSTER_ROLE
+#define CLUSTER_ROLE CLUSTER_STANDALONE
+#endif
+#ifndef CLUSTER_BOARD_ID
+#define CLUSTER_BOARD_ID 0
+#endif
+#ifndef CLUSTER_COORDINATOR_IP
+#define CLUSTER_COORDINATOR_IP ""  // empty: resolve esp32.local
+#endif
+#ifndef LOCAL_STATIONS
+#define LOCAL_STATIONS PARTICIPANTS
+#endif
+#ifndef CLUSTER_MERGE_HOLD_MS
+#define CLUSTER_MERGE_HOLD_MS ((CLUSTER_ROLE == CLUSTER_COORDINATOR) ? 40 : 0)
+#endif
+// The arbiter holds every press for the longer of the cluster merge hold
+// and INPUT_ORDER_HOLD_MS (InputScanner.h).
+#define MERGE_HOLD_MS ((CLUSTER_MERGE_HOLD_MS > INPUT_ORDER_HOLD_MS) ? CLUSTER_MERGE_HOLD_MS : INPUT_ORDER_HOLD_MS)
+
+static_assert(PARTICIPANTS >= 1 && PARTICIPANTS <= 32, "PARTICIPANTS must be 1..32");
+static_assert(LOCAL_STATIONS >= 1 && LOCAL_STATIONS <= PARTICIPANTS, "LOCAL_STATIONS must be 1..PARTICIPANTS");
+static_assert((CLUSTER_ROLE == CLUSTER_NODE) == (CLUSTER_BOARD_ID != 0), "board 0 is the coordinator; nodes use ids 1..7");
+static_assert(CLUSTER_BOARD_ID >= 0 && CLUSTER_BOARD_ID < 8, "cluster board ids are 0..7");
+#if BUZZER_IO == BUZZER_IO_GPIO
+static_assert(LOCAL_STATIONS <= 10, "direct GPIO wiring has pins for 10 stations; use BUZZER_IO_SHIFT");
+#endif
+
+// Pin definitions for direct GPIO wiring - CORRECTED according to your pinout plan
 const int switchPins[10] = {34, 35, 36, 39, 32, 33, 25, 26, 27, 14}; // GPIO numbers
 const int ledPins[10] = {12, 13, 15, 2, 4, 16, 17, 5, 18, 19};      // GPIO numbers
 const int buzzerPin = 23; // GPIO 23
 
-// Participant labels for serial output
-const char* participantNames[10] = {
-  "Participant 1", "Participant 2", "Participant 3", "Participant 4", "Participant 5",
-  "Participant 6", "Participant 7", "Participant 8", "Participant 9", "Participant 10"
-};
+// Shift-register wiring: a 74HC165 chain for the switches, a 74HC595 chain
+// for the LEDs, participant i on chain bit i.
+const int SR_IN_LOAD_PIN = 32;   // 74HC165 /PL
+const int SR_IN_CLOCK_PIN = 33;  // 74HC165 CP
+const int SR_IN_DATA_PIN = 34;   // 74HC165 Q7 of the last register
+const int SR_OUT_DATA_PIN = 25;  // 74HC595 DS
+const int SR_OUT_CLOCK_PIN = 26; // 74HC595 SHCP
+const int SR_OUT_LATCH_PIN = 27; // 74HC595 STCP
+// The debouncer integrates over input snapshots taken at SCAN_HZ. With
+// direct wiring, pin interrupts add exact edge times on top of the scan.
+#ifndef SCAN_HZ
+#define SCAN_HZ ((BUZZER_IO == BUZZER_IO_GPIO) ? 1000 : 10000)
+#endif
 
 // PWM properties
 const int PWM_FREQ = 5000;
 const int PWM_CHANNEL = 0;
 const int PWM_RESOLUTION = 8;
 
-WebServer server(80);
+AsyncHttpServer server(80);
+// Binary push/command channel. links2004 WebSockets runs its own listener,
+// so it cannot share port 80 with the async HTTP server.
+WebSocketsServer wsServer(81);
 const char* ssid = "LabExpert_1.0";
 const char* pass = "11111111";
 
 // API handler function declarations
 void handleHealth();
+void handleMetrics();
+void handleJournal();
+void handleHistory();
+void handleTime();
 void handleStatus();
 void handleGameConfig();
 void handleGameStart();
 void handleGameReset();
+void handleGameTieBreak();
 void handleOptions();
 void handleEvents();
+void handleStreamClose(AsyncClient* client);
+void handleStreamWritable(AsyncClient* client);
+void handleWsEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length);
 void sendCors();
-void sendSSEEvent(const char* event, const char* data);
-
-volatile bool gameActive = false;
-volatile unsigned long gameStartTime = 0;
-volatile unsigned long gameDuration = 10000;
-volatile int pressOrder[10] = {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1};
-volatile int pressCount = 0;
-volatile bool recorded[10] = {false,false,false,false,false,false,false,false,false,false};
-
-// State variables for 10 participants
-volatile bool switchPressed[10] = {false, false, false, false, false, false, false, false, false, false};
-volatile bool firstPressDetected = false;
-volatile bool ignoreInputs = false;
-volatile unsigned long buzzerStartTime = 0;
-volatile int firstPress = -1; // -1 means no press yet
-
-// Debouncing variables for all 10 switches
-volatile unsigned long lastInterruptTime[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-const unsigned long DEBOUNCE_DELAY = 50;
-
-// Pattern variables
-bool ledBlinkState = false;
-unsigned long lastLedBlinkTime = 0;
-const unsigned long LED_BLINK_INTERVAL = 80; // Faster blink for excitement
-
-// Buzzer pattern variables
-int buzzerPatternStep = 0;
-unsigned long lastBuzzerStepTime = 0;
-
-// SSE and timestamp tracking
-volatile unsigned long pressTimestamps[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-volatile int pressOrderNo[10] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
-volatile int currentOrderNo = 0;
-const unsigned long BUZZER_STEP_INTERVAL = 150; // Faster pattern steps
-volatile unsigned long ledOffAt[10] = {0,0,0,0,0,0,0,0,0,0};
-volatile unsigned long beepEndTime = 0;
-const unsigned long PRESS_LED_MS = 700;
-const unsigned long PRESS_BEEP_MS = 200;
-
-volatile int ledEffect[10] = {0,0,0,0,0,0,0,0,0,0};
-volatile bool ledCurrentState[10] = {false,false,false,false,false,false,false,false,false,false};
-volatile unsigned long patternUntil[10] = {0,0,0,0,0,0,0,0,0,0};
-volatile int patternIndex[10] = {0,0,0,0,0,0,0,0,0,0};
-const unsigned short E3_SEQ_MS[6] = {120,60,120,60,120,500};
-const unsigned short E2_SEQ_MS[4] = {120,80,120,600};
-const unsigned short E1_SEQ_MS[2] = {150,700};
-const int E3_LEN = 6;
-const int E2_LEN = 4;
-const int E1_LEN = 2;
-volatile unsigned long startBlinkEnd = 0;
-
-// Generic interrupt handler for any switch
-void IRAM_ATTR handleSwitchInterrupt(int switchIndex)
+void sendBusy(const char* message);
+void sendSSEEvent(const SseFrame& frame);
+void arbiterLoop(void* arg);
+void netLoop(void* arg);
+void attachSwitchInterrupts();
+void beginCluster();
+bool sendCommand(uint8_t type, uint32_t value);
+void journalConfig(uint8_t key, uint32_t before, uint32_t after);
+void drainNetEvents();
+void recordHistory(bool aborted, uint64_t endUs);
+
+// One PressEvent per debounced edge, pushed by the switch ISR and drained
+// by the arbiter task in arrival order. All GPIO interrupts are dispatched
+// from the same core, so the ISR side is a single producer.
+SpscRing<PressEvent, 64> pressEvents;
+
+// Core split. Input capture and round arbitration run on INPUT_CORE, HTTP/SSE
+// serving on NET_CORE (core 0 is where the WiFi/lwIP tasks already live).
+// Build with -DSPLIT_CORES=0 to keep both tasks on the Arduino core.
+#ifndef SPLIT_CORES
+#define SPLIT_CORES 1
+#endif
+#if SPLIT_CORES
+const BaseType_t INPUT_CORE = 1;
+const BaseType_t NET_CORE = 0;
+#else
+const BaseType_t INPUT_CORE = ARDUINO_RUNNING_CORE;
+const BaseType_t NET_CORE = ARDUINO_RUNNING_CORE;
+#endif
+
+// The arbiter and network tasks share no state; they talk only through
+// these two bounded lock-free queues (records in GameEvents.h). Commands
+// flow net -> arbiter, round updates flow arbiter -> net.
+SpscRing<Command, 8> commands;
+
+SpscRing<NetEvent, 32> netEvents;
+
+// Cluster plumbing. The link is owned by the net task; presses from node
+// boards reach the coordinator's arbiter through remotePresses, already in
+// coordinator time and global participant numbering. The game core merges
+// them with its own presses and releases each one MERGE_HOLD_MS
+// after it happened, which must cover a node's send/retransmit latency.
+ClusterLink cluster;
+SpscRing<PressEvent, 32> remotePresses;
+
+TaskHandle_t arbiterTask = NULL;
+TaskHandle_t netTask = NULL;
+LatencyHistogram pressToEventUs;  // ISR edge -> SSE event written (net core)
+LatencyHistogram recordToSseUs;   // arbiter recorded the press -> SSE event written (net core)
+LatencyHistogram wsCommandUs;     // WebSocket command received -> ACK sent
+LatencyHistogram arbiterPassUs;   // one wakeup of the arbiter task, sleep excluded
+LatencyHistogram netPassUs;       // one wakeup of the network task, sleep excluded
+LatencyHistogram arbiterLateUs;   // timed arbiter wakeup -> its deadline, i.e. loop jitter
+volatile uint32_t wifiDisconnects = 0;
+volatile uint32_t wifiReconnects = 0;  // got an address again after the first time
+
+// Network-side view of the round, rebuilt from netEvents. Only the net task
+// writes it; HTTP handlers read it under the server lock.
+struct RoundView {
+  bool active;
+  unsigned long startMs;
+  uint64_t startUs;
+  uint64_t endUs;                   // set when it ends
+  unsigned long durationMs;
+  int pressCount;
+  int pressOrder[PARTICIPANTS];
+  uint64_t pressTimestampsUs[PARTICIPANTS];
+  bool pressTie[PARTICIPANTS];
+  int pressPlace[PARTICIPANTS];     // equal within a tie awaiting the judge
+  int pressTieGroup[PARTICIPANTS];  // -1 = no tie
+  uint8_t tieBreak;
+  uint32_t tieWindowUs;
+  uint32_t seed;
+  bool ended;                       // result sent; judge decisions resend it
+  uint32_t round;                   // numbered across reboots from the journal
+};
+RoundView roundView = {};
+unsigned long configuredDuration = 10000;
+uint32_t configuredTieWindowUs = TIE_WINDOW_US;
+uint8_t configuredTieBreak = TIE_BREAK;
+
+const char* const TIE_BREAK_NAMES[] = {"timestamp", "random", "judge"};
+
+// Press journal on LittleFS (PressJournal.h). Records are appended by the
+// net task and HTTP handlers under the server lock and reach flash only
+// between rounds: mid-round, a record the RAM buffer cannot take is dropped
+// and counted instead. GET /api/journal streams it to one client at a time.
+HalFlashFs flashFs;
+PressJournal<HalFlashFs> journal(flashFs);
+JournalExport<PressJournal<HalFlashFs>, AsyncClient> journalExport;
+
+// Finished and aborted rounds for GET /api/history, kept by the net task
+// under the server lock. Lost on reboot; the journal has the rest.
+RoundHistory<PARTICIPANTS> history;
+const int HISTORY_PAGE = 8;  // rounds per /api/history response, at most
+
+SseHub sseHub;
+const TickType_t WS_POLL_MS = 2;
+uint8_t wsBuf[WS_PRESS_LEN];  // largest device->client frame
+volatile int wsClients = 0;
+
+LedcToneOut buzzerOut(PWM_CHANNEL);
+ToneSequencer<LedcToneOut> tones(buzzerOut);  // arbiter side
+
+Esp32GpioRegs gpioRegs;
+#if BUZZER_IO == BUZZER_IO_GPIO
+GpioOutputBatch<Esp32GpioRegs, LOCAL_STATIONS> ledOutputs(gpioRegs, ledPins);
+void writeLedFrame(uint32_t frame) { ledOutputs.apply(frame); }
+GpioInputSnapshot<Esp32GpioRegs, LOCAL_STATIONS> switchInputs(gpioRegs, switchPins);
+#else
+Hc595Chain<Esp32GpioRegs, LOCAL_STATIONS> ledChain(gpioRegs, SR_OUT_DATA_PIN, SR_OUT_CLOCK_PIN, SR_OUT_LATCH_PIN);
+void writeLedFrame(uint32_t frame) { ledChain.write(frame); }
+Hc165Chain<Esp32GpioRegs, LOCAL_STATIONS> switchInputs(gpioRegs, SR_IN_LOAD_PIN, SR_IN_CLOCK_PIN, SR_IN_DATA_PIN);
+#endif
+hw_timer_t* scanTimer = NULL;
+// Blink patterns play from RMT channels when one is free, so they keep
+// exact timing however late the arbiter wakes. Build with -DLED_OFFLOAD=0
+// for the software path only. LEDs behind a 74HC595 chain cannot be
+// offloaded.
+#ifndef LED_OFFLOAD
+#define LED_OFFLOAD (BUZZER_IO == BUZZER_IO_GPIO)
+#endif
+#if LED_OFFLOAD
+static_assert(BUZZER_IO == BUZZER_IO_GPIO, "LED_OFFLOAD needs one GPIO per LED");
+RmtLedOffload ledOffload(ledPins, LOCAL_STATIONS, 0, RmtLedOffload::MAX_CHANNELS);
+typedef LedPatternEngine<LOCAL_STATIONS, RmtLedOffload> Leds;
+Leds leds(writeLedFrame, &ledOffload);  // arbiter side
+#else
+typedef LedPatternEngine<LOCAL_STATIONS> Leds;
+Leds leds(writeLedFrame);  // arbiter side
+#endif
+InputScanner<LOCAL_STATIONS> inputScanner;  // ISR side
+
+void publish(const NetEvent& e);
+GameCore<PARTICIPANTS, Leds, ToneSequencer<LedcToneOut> >
+  game(leds, tones, publish, LOCAL_STATIONS, (uint32_t)MERGE_HOLD_MS * 1000,
+       CLUSTER_ROLE == CLUSTER_NODE);  // arbiter side
+
+// Debounce one input snapshot (bit i = station i down), queue the settled
+// PressEvents and wake the arbiter. Runs in ISR context.
+void IRAM_ATTR acceptInputs(uint32_t down, uint32_t changed, uint64_t nowUs)
 {
-  unsigned long interruptTime = millis();
-  if (interruptTime - lastInterruptTime[switchIndex] > DEBOUNCE_DELAY)
-  {
-    if (digitalRead(switchPins[switchIndex]) == LOW)
-    {
-      switchPressed[switchIndex] = true;
-    }
-    lastInterruptTime[switchIndex] = interruptTime;
+  if (inputScanner.scan(down, changed, nowUs, pressEvents) == 0) return;
+  if (arbiterTask != NULL) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(arbiterTask, &woken);
+    if (woken) portYIELD_FROM_ISR();
   }
 }
 
-// Interrupt handler functions for all 10 switches
-void IRAM_ATTR handleSwitch0() { handleSwitchInterrupt(0); }
-void IRAM_ATTR handleSwitch1() { handleSwitchInterrupt(1); }
-void IRAM_ATTR handleSwitch2() { handleSwitchInterrupt(2); }
-void IRAM_ATTR handleSwitch3() { handleSwitchInterrupt(3); }
-void IRAM_ATTR handleSwitch4() { handleSwitchInterrupt(4); }
-void IRAM_ATTR handleSwitch5() { handleSwitchInterrupt(5); }
-void IRAM_ATTR handleSwitch6() { handleSwitchInterrupt(6); }
-void IRAM_ATTR handleSwitch7() { handleSwitchInterrupt(7); }
-void IRAM_ATTR handleSwitch8() { handleSwitchInterrupt(8); }
-void IRAM_ATTR handleSwitch9() { handleSwitchInterrupt(9); }
+#if BUZZER_IO == BUZZER_IO_GPIO
+// Either edge on one switch pin; arg is the participant index. Both input
+// banks are read in one snapshot, so buttons that went down together start
+// settling from the same timestamp whichever interrupt is serviced first.
+void IRAM_ATTR handleSwitchInterrupt(void* arg)
+{
+  uint64_t edgeUs = esp_timer_get_time();
+  acceptInputs(switchInputs.readDown(), 1u << (int)(intptr_t)arg, edgeUs);
+}
+#endif
+
+// Scan timer: reads the inputs at SCAN_HZ so transitions settle without
+// further edges. On a 74HC165 chain it is the only input path, and edge
+// times are accurate to one scan period.
+void IRAM_ATTR handleScanTimer()
+{
+  uint64_t scanUs = esp_timer_get_time();
+  acceptInputs(switchInputs.readDown(), 0, scanUs);
+}
 void setup()
 {
   // === BOOT PROTECTION - CRITICAL FOR ESP32 ===
@@ -123,23 +299,37 @@ void setup()
 
   Serial.begin(115200);
   delay(100);  // Allow Serial to stabilize
-  Serial.println("Starting Quiz Competition System with 10 Participants...");
+  Serial.printf("Starting Quiz Competition System with %d Participants...\n", PARTICIPANTS);
 
+#if BUZZER_IO == BUZZER_IO_GPIO
   // Initialize all LED pins to OUTPUT and set LOW
-  for (int i = 0; i < 10; i++) {
+  for (int i = 0; i < LOCAL_STATIONS; i++) {
     pinMode(ledPins[i], OUTPUT);
-    digitalWrite(ledPins[i], LOW);
   }
+#if LED_OFFLOAD
+  if (!ledOffload.begin()) Serial.println("RMT unavailable: LED patterns run in software");
+#endif
 
   // Initialize all switch pins with correct pull-up configuration
   // Note: GPIO 34, 35, 36, 39 don't have internal pull-ups, need external 10KΩ resistors
-  for (int i = 0; i < 10; i++) {
+  for (int i = 0; i < LOCAL_STATIONS; i++) {
     if (i < 4) { // GPIO 34, 35, 36, 39 - external pull-up required
       pinMode(switchPins[i], INPUT);
+      inputScanner.setSettleUs(i, DEBOUNCE_US_EXT_PULLUP);
     } else { // GPIO 32, 33, 25, 26, 27, 14 - internal pull-up available
       pinMode(switchPins[i], INPUT_PULLUP);
     }
   }
+#else
+  pinMode(SR_IN_LOAD_PIN, OUTPUT);
+  digitalWrite(SR_IN_LOAD_PIN, HIGH);
+  pinMode(SR_IN_CLOCK_PIN, OUTPUT);
+  pinMode(SR_IN_DATA_PIN, INPUT);
+  pinMode(SR_OUT_DATA_PIN, OUTPUT);
+  pinMode(SR_OUT_CLOCK_PIN, OUTPUT);
+  pinMode(SR_OUT_LATCH_PIN, OUTPUT);
+#endif
+  writeLedFrame(0);
 
   // Initialize buzzer pin
   pinMode(buzzerPin, OUTPUT);
@@ -152,31 +342,47 @@ void setup()
 
   delay(100);
 
-  // Attach interrupts for all 10 switches
-  attachInterrupt(digitalPinToInterrupt(switchPins[0]), handleSwitch0, FALLING);
-  attachInterrupt(digitalPinToInterrupt(switchPins[1]), handleSwitch1, FALLING);
-  attachInterrupt(digitalPinToInterrupt(switchPins[2]), handleSwitch2, FALLING);
-  attachInterrupt(digitalPinToInterrupt(switchPins[3]), handleSwitch3, FALLING);
-  attachInterrupt(digitalPinToInterrupt(switchPins[4]), handleSwitch4, FALLING);
-  attachInterrupt(digitalPinToInterrupt(switchPins[5]), handleSwitch5, FALLING);
-  attachInterrupt(digitalPinToInterrupt(switchPins[6]), handleSwitch6, FALLING);
-  attachInterrupt(digitalPinToInterrupt(switchPins[7]), handleSwitch7, FALLING);
-  attachInterrupt(digitalPinToInterrupt(switchPins[8]), handleSwitch8, FALLING);
-  attachInterrupt(digitalPinToInterrupt(switchPins[9]), handleSwitch9, FALLING);
-
-  Serial.println("🎯 10-Participant Quiz Competition System READY!");
+  if (journal.begin((uint8_t)esp_reset_reason())) {
+    Serial.printf("Journal: %d segments, last round %u\n", journal.segmentCount(), (unsigned)journal.lastRound());
+  } else {
+    Serial.println("Journal disabled: LittleFS did not mount");
+  }
+  roundView.round = journal.lastRound();
+  roundView.tieBreak = configuredTieBreak;  // until the first round reports its own
+  roundView.tieWindowUs = configuredTieWindowUs;
+
+  // The arbiter attaches the switch interrupts (or the scan timer) itself so
+  // the input ISR is serviced on INPUT_CORE.
+  xTaskCreatePinnedToCore(arbiterLoop, "arbiter", 6144, NULL, 3, &arbiterTask, INPUT_CORE);
+
+  Serial.printf("🎯 %d-Participant Quiz Competition System READY!\n", PARTICIPANTS);
   Serial.println("Press any buzzer to start...");
+#if BUZZER_IO == BUZZER_IO_GPIO
   Serial.println("Pin Mapping:");
-  for (int i = 0; i < 10; i++) {
+  for (int i = 0; i < LOCAL_STATIONS; i++) {
     Serial.printf("Participant %d: Switch=GPIO%d, LED=GPIO%d\n", 
                  i+1, switchPins[i], ledPins[i]);
   }
+#else
+  Serial.printf("74HC165 chain: /PL=GPIO%d CP=GPIO%d Q7=GPIO%d, scanned at %d Hz\n",
+                SR_IN_LOAD_PIN, SR_IN_CLOCK_PIN, SR_IN_DATA_PIN, SCAN_HZ);
+  Serial.printf("74HC595 chain: DS=GPIO%d SHCP=GPIO%d STCP=GPIO%d\n",
+                SR_OUT_DATA_PIN, SR_OUT_CLOCK_PIN, SR_OUT_LATCH_PIN);
+#endif
 
+#if CLUSTER_ROLE == CLUSTER_NODE
+  static char mdnsName[16];
+  snprintf(mdnsName, sizeof(mdnsName), "esp32-node%d", CLUSTER_BOARD_ID);
+#else
+  static const char* mdnsName = "esp32";
+#endif
   WiFi.mode(WIFI_STA);
   WiFi.setAutoReconnect(true);
   WiFi.persistent(true);
   WiFi.onEvent([](WiFiEvent_t event){
+    static bool connectedBefore = false;
     if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED){
+      wifiDisconnects++;
       int tries = 0;
       while (WiFi.status() != WL_CONNECTED && tries < 10){
         WiFi.reconnect();
@@ -184,27 +390,42 @@ void setup()
         tries++;
       }
     } else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP){
-      MDNS.begin("esp32");
+      if (connectedBefore) wifiReconnects++;
+      connectedBefore = true;
+      MDNS.begin(mdnsName);
     }
   });
   WiFi.begin(ssid, pass);
   unsigned long t0 = millis();
   while (WiFi.status() != WL_CONNECTED && millis() - t0 < 15000){ delay(200); }
-  MDNS.begin("esp32");
+  MDNS.begin(mdnsName);
+  beginCluster();
 
+  // With the radio up esp_random() is a true random number.
+  sseHub.setBootEpoch(esp_random());
   server.on("/api/health", HTTP_GET, handleHealth);
+  server.on("/api/metrics", HTTP_GET, handleMetrics);
   server.on("/api/status", HTTP_GET, handleStatus);
+  server.on("/api/time", HTTP_GET, handleTime);
   server.on("/api/game/config", HTTP_GET, handleGameConfig);
   server.on("/api/game/config", HTTP_POST, handleGameConfig);
   server.on("/api/game/start", HTTP_POST, handleGameStart);
   server.on("/api/game/reset", HTTP_POST, handleGameReset);
+  server.on("/api/game/tiebreak", HTTP_POST, handleGameTieBreak);
+  server.on("/api/journal", HTTP_GET, handleJournal);
+  server.on("/api/history", HTTP_GET, handleHistory);
   server.on("/events", HTTP_GET, handleEvents);
   server.on("/events", HTTP_OPTIONS, handleOptions);
   server.on("/api/health", HTTP_OPTIONS, handleOptions);
+  server.on("/api/metrics", HTTP_OPTIONS, handleOptions);
   server.on("/api/status", HTTP_OPTIONS, handleOptions);
+  server.on("/api/time", HTTP_OPTIONS, handleOptions);
   server.on("/api/game/config", HTTP_OPTIONS, handleOptions);
   server.on("/api/game/start", HTTP_OPTIONS, handleOptions);
   server.on("/api/game/reset", HTTP_OPTIONS, handleOptions);
+  server.on("/api/game/tiebreak", HTTP_OPTIONS, handleOptions);
+  server.on("/api/journal", HTTP_OPTIONS, handleOptions);
+  server.on("/api/history", HTTP_OPTIONS, handleOptions);
   server.onNotFound([](){
     if (server.method() == HTTP_OPTIONS) {
       sendCors();
@@ -214,39 +435,76 @@ void setup()
     sendCors();
     server.send(404, "text/plain", "Not found");
   });
+  server.onStreamClose(handleStreamClose);
+  server.onStreamWritable(handleStreamWritable);
   server.begin();
+  wsServer.onEvent(handleWsEvent);
+  wsServer.enableHeartbeat(5000, 2000, 2);
+  wsServer.begin();
+  xTaskCreatePinnedToCore(netLoop, "net", 8192, NULL, 2, &netTask, NET_CORE);
 }
 
-void playThrillingBuzzer()
+// Join the cluster configured at build time. Nodes find the coordinator at
+// CLUSTER_COORDINATOR_IP, or as esp32.local when that is empty.
+void beginCluster()
 {
-  unsigned long currentTime = millis();
-  unsigned long elapsed = currentTime - buzzerStartTime;
-
-  // High-pitched 2-second beep at 2000Hz
-  if (elapsed < 2000) {
-    // Play continuous 2000Hz tone for 2 seconds
-    ledcWriteTone(PWM_CHANNEL, 2000);
-    ledcWrite(PWM_CHANNEL, 255); // FULL VOLUME
-  } else {
-    // Stop the buzzer after 2 seconds
-    ledcWrite(PWM_CHANNEL, 0);
-  }
+#if CLUSTER_ROLE == CLUSTER_NODE
+  IPAddress coordinator;
+  if (!coordinator.fromString(CLUSTER_COORDINATOR_IP)) coordinator = MDNS.queryHost("esp32");
+  Serial.printf("Cluster node %d, coordinator %s\n", CLUSTER_BOARD_ID, coordinator.toString().c_str());
+  // A command that does not fit the arbiter's queue is not acknowledged,
+  // so the coordinator sends it again.
+  cluster.onRound([](uint8_t action, uint32_t durationMs){
+    bool queued = true;
+    server.lock();
+    if (action == CLUSTER_ROUND_START) {
+      queued = sendCommand(CMD_SET_DURATION, durationMs) && sendCommand(CMD_START, 0);
+    } else if (action == CLUSTER_ROUND_RESET) {
+      queued = sendCommand(CMD_RESET, 0);
+    } else if (action == CLUSTER_ROUND_END) {
+      queued = sendCommand(CMD_END_ROUND, 0);
+    }
+    server.unlock();
+    return queued;
+  });
+  cluster.onPlace([](uint8_t station, uint8_t place){
+    server.lock();
+    bool queued = sendCommand(CMD_SHOW_PLACE, station | ((uint32_t)place << 8));
+    server.unlock();
+    return queued;
+  });
+  cluster.begin(ClusterLink::NODE, CLUSTER_BOARD_ID, (uint32_t)coordinator);
+#elif CLUSTER_ROLE == CLUSTER_COORDINATOR
+  cluster.onPress([](uint8_t board, uint8_t station, int64_t timeUs, uint32_t errorUs, bool tie){
+    int index = board * LOCAL_STATIONS + station;
+    if (station >= LOCAL_STATIONS || index >= PARTICIPANTS || timeUs < 0) return true;  // nothing to retry
+    PressEvent ev;
+    ev.timeUs = (uint64_t)timeUs;
+    ev.index = (uint8_t)index;
+    ev.level = LOW;
+    ev.tie = tie;
+    if (!remotePresses.push(ev)) return false;  // the node resends it
+    xTaskNotifyGive(arbiterTask);
+    return true;
+  });
+  cluster.begin(ClusterLink::COORDINATOR, 0, 0);
+#endif
 }
 
-void updateExcitingLEDs()
+// Start input capture: the scan timer, plus one interrupt per switch pin
+// with direct wiring. Both are allocated on this core, so their ISRs never
+// run concurrently.
+void attachSwitchInterrupts()
 {
-  unsigned long currentTime = millis();
-  if (currentTime - lastLedBlinkTime >= LED_BLINK_INTERVAL)
-  {
-    lastLedBlinkTime = currentTime;
-    ledBlinkState = !ledBlinkState;
-    for (int i = 0; i < 10; i++) {
-      digitalWrite(ledPins[i], LOW);
-    }
-    if (firstPress >= 0 && firstPress < 10) {
-      digitalWrite(ledPins[firstPress], ledBlinkState ? HIGH : LOW);
-    }
+#if BUZZER_IO == BUZZER_IO_GPIO
+  for (int i = 0; i < LOCAL_STATIONS; i++) {
+    attachInterruptArg(digitalPinToInterrupt(switchPins[i]), handleSwitchInterrupt, (void*)(intptr_t)i, CHANGE);
   }
+#endif
+  scanTimer = timerBegin(0, 80, true);  // 1 MHz
+  timerAttachInterrupt(scanTimer, handleScanTimer, true);
+  timerAlarmWrite(scanTimer, 1000000 / SCAN_HZ, true);
+  timerAlarmEnable(scanTimer);
 }
 
 void sendCors(){
@@ -255,37 +513,325 @@ void sendCors(){
   server.sendHeader("Access-Control-Allow-Headers","Content-Type, Accept");
 }
 
+// 503 with a hint to retry shortly.
+void sendBusy(const char* message){
+  sendCors();
+  server.sendHeader("Retry-After", "5");
+  server.send(503, "text/plain", message);
+}
+
 void handleOptions(){
   sendCors();
   server.send(204);
 }
 
 void handleHealth(){
-  DynamicJsonDocument doc(256);
+  DynamicJsonDocument doc(3072 + JSON_ARRAY_SIZE(LOCAL_STATIONS) + LOCAL_STATIONS * JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(3));
   doc["ok"] = true;
   doc["ssid"] = WiFi.SSID();
   doc["ip"] = WiFi.localIP().toString();
+  doc["pressQueueDropped"] = pressEvents.dropped();
+  doc["pressQueueHighWater"] = pressEvents.highWater();
+  doc["commandQueueDropped"] = commands.dropped();
+  doc["netQueueDropped"] = netEvents.dropped();
+  // pressToRecordUs is owned by the arbiter; a read racing an update can be
+  // one sample off, which is fine for telemetry.
+  const LatencyHistogram& pressToRecordUs = game.pressToRecordUs();
+  JsonObject rec = doc.createNestedObject("pressToRecordUs");
+  rec["count"] = pressToRecordUs.count();
+  rec["p50"] = pressToRecordUs.percentile(50);
+  rec["p99"] = pressToRecordUs.percentile(99);
+  rec["max"] = pressToRecordUs.max();
+  JsonObject lat = doc.createNestedObject("pressToEventUs");
+  lat["count"] = pressToEventUs.count();
+  lat["p50"] = pressToEventUs.percentile(50);
+  lat["p99"] = pressToEventUs.percentile(99);
+  lat["max"] = pressToEventUs.max();
+  // Debouncer state per local station, written by the input ISR. Climbing
+  // bounce or glitch counts point at a worn switch or a noisy line; a large
+  // heldMs at a stuck button.
+  uint32_t held = inputScanner.downMask();
+  JsonArray inputs = doc.createNestedArray("inputs");
+  for (int i=0;i<LOCAL_STATIONS;i++){
+    const InputScanner<LOCAL_STATIONS>::ChannelStats& st = inputScanner.stats(i);
+    JsonObject o = inputs.createNestedObject();
+#if BUZZER_IO == BUZZER_IO_GPIO
+    o["pin"] = switchPins[i];
+#endif
+    o["settleUs"] = inputScanner.settleUs(i);
+    o["heldMs"] = (held & (1u << i)) ? millis() - inputScanner.downSinceMs(i) : 0;
+    o["presses"] = st.presses;
+    o["releases"] = st.releases;
+    o["bounces"] = st.bounces;
+    o["glitches"] = st.glitches;
+  }
+  JsonObject ws = doc.createNestedObject("ws");
+  ws["port"] = 81;
+  ws["clients"] = wsClients;
+  ws["commandToAckUs"] = wsCommandUs.percentile(50);
+  ws["commandToAckUsP99"] = wsCommandUs.percentile(99);
+#if CLUSTER_ROLE != CLUSTER_STANDALONE
+  // The link is owned by the net task; these reads can race it by a sample.
+  JsonObject cl = doc.createNestedObject("cluster");
+  cl["board"] = CLUSTER_BOARD_ID;
+  cl["mergeHoldMs"] = MERGE_HOLD_MS;
+#if CLUSTER_ROLE == CLUSTER_NODE
+  const ClockSync& clock = cluster.clock();
+  cl["role"] = "node";
+  cl["synced"] = clock.synced();
+  cl["offsetUs"] = clock.offsetUs();
+  cl["driftPpm"] = clock.driftPpm();
+  cl["rttUs"] = clock.rttUs();
+  cl["errorBoundUs"] = clock.errorBoundUs(esp_timer_get_time());
+  cl["syncSamples"] = clock.samples();
+  cl["pendingPresses"] = cluster.pending();
+  cl["droppedPresses"] = cluster.droppedPresses();
+#else
+  cl["role"] = "coordinator";
+  cl["remoteQueueDropped"] = remotePresses.dropped();
+  cl["mergeDropped"] = game.mergeDropped();
+  JsonArray peers = cl.createNestedArray("peers");
+  for (int b=1;b<ClusterLink::MAX_BOARDS;b++){
+    const ClusterLink::Peer& p = cluster.peer(b);
+    if (!p.known) continue;
+    JsonObject o = peers.createNestedObject();
+    o["board"] = b;
+    o["ip"] = IPAddress(p.ip).toString();
+    o["lastSeenMs"] = millis() - p.lastSeenMs;
+    o["presses"] = p.presses;
+    o["restarts"] = p.restarts;
+    o["controlPending"] = p.controlCount;
+    o["controlDropped"] = p.controlDropped;
+    o["lastErrorUs"] = p.lastErrorUs;
+  }
+#endif
+#endif
+  JsonObject hist = doc.createNestedObject("history");
+  hist["rounds"] = history.count();
+  hist["capacity"] = history.capacity();
+  hist["bytes"] = sizeof(history);
+  JsonObject sse = doc.createNestedObject("sse");
+  sse["subscribers"] = sseHub.count();
+  sse["capacity"] = SseHub::capacity();
+  sse["bytesPerSubscriber"] = SseHub::bytesPerSubscriber();
+  sse["registryBytes"] = sizeof(SseHub);
+  sse["rejected"] = sseHub.rejected();
+  sse["evictions"] = sseHub.evictions();
+  JsonArray clients = sse.createNestedArray("clients");
+  for (int i=0;i<SseHub::capacity();i++){
+    const SseHub::Subscriber& sub = sseHub.subscriber(i);
+    if (sub.client == NULL) continue;
+    JsonObject o = clients.createNestedObject();
+    o["slot"] = i;
+    o["ageMs"] = millis() - sub.connectedMs;
+    o["queuedBytes"] = sub.queue.queuedBytes();
+    o["queuedFrames"] = sub.queue.queuedFrames();
+    o["droppedFrames"] = sub.queue.droppedFrames();
+    o["sentBytes"] = sub.queue.sentBytes();
+  }
   String out; serializeJson(doc,out);
   sendCors(); server.send(200,"application/json",out);
 }
 
+// Hot-path latency histograms and device counters, as JSON or, with
+// ?format=prometheus or an Accept header asking for text/plain (what
+// Prometheus scrapers send), in the Prometheus text format. Everything here
+// is a fixed-bucket LatencyHistogram or a plain counter updated in place,
+// so the press path never allocates for it; only this handler does.
+// Counters owned by other tasks are read without their locks and can be a
+// sample behind.
+struct HistogramMetric {
+  const char* json;
+  const char* prom;
+  const char* help;
+  const LatencyHistogram& h;
+};
+
+void addHistogram(JsonObject parent, const char* name, const LatencyHistogram& h){
+  JsonObject o = parent.createNestedObject(name);
+  o["count"] = h.count();
+  o["sum"] = h.sum();
+  o["max"] = h.max();
+  o["p50"] = h.percentile(50);
+  o["p90"] = h.percentile(90);
+  o["p99"] = h.percentile(99);
+  // bucket k counts samples up to 2^(k+1) - 1 us
+  JsonArray b = o.createNestedArray("buckets");
+  int last = -1;
+  for (int k=0;k<LatencyHistogram::BUCKETS;k++){ if (h.bucket(k)) last = k; }
+  for (int k=0;k<=last;k++){ b.add(h.bucket(k)); }
+}
+
+void handleMetrics(){
+  const HistogramMetric histograms[] = {
+    {"arbiterPassUs", "quiz_arbiter_pass_microseconds", "Arbiter task work per wakeup", arbiterPassUs},
+    {"netPassUs", "quiz_net_pass_microseconds", "Network task work per wakeup", netPassUs},
+    {"arbiterLateUs", "quiz_arbiter_wake_late_microseconds", "Timed arbiter wakeups past their deadline", arbiterLateUs},
+    {"pressToRecordUs", "quiz_press_to_record_microseconds", "First edge to press recorded by the arbiter", game.pressToRecordUs()},
+    {"recordToSseUs", "quiz_record_to_sse_microseconds", "Press recorded to SSE event written", recordToSseUs},
+    {"pressToSseUs", "quiz_press_to_sse_microseconds", "First edge to SSE event written", pressToEventUs},
+    {"httpHandlerUs", "quiz_http_handler_microseconds", "HTTP route handler run time", server.handlerUs()},
+    {"wsCommandToAckUs", "quiz_ws_command_to_ack_microseconds", "WebSocket command received to ACK sent", wsCommandUs},
+  };
+  const int HISTOGRAMS = sizeof(histograms) / sizeof(histograms[0]);
+  uint32_t heapFree = ESP.getFreeHeap();
+  uint32_t heapLargest = ESP.getMaxAllocHeap();
+  uint32_t heapMin = ESP.getMinFreeHeap();
+  int rssi = WiFi.RSSI();
+
+  sendCors();
+  if (server.arg("format") == "prometheus" || server.header("Accept").indexOf("text/plain") >= 0) {
+    String out;
+    out.reserve(4096);
+    PrometheusText<String> prom(out);
+    for (int k=0;k<HISTOGRAMS;k++){ prom.histogram(histograms[k].prom, histograms[k].help, histograms[k].h); }
+    prom.counter("quiz_press_queue_dropped_total", "Presses lost to a full ISR queue", pressEvents.dropped());
+    prom.counter("quiz_net_queue_dropped_total", "Round updates lost to a full network queue", netEvents.dropped());
+    prom.counter("quiz_command_queue_dropped_total", "Commands lost to a full arbiter queue", commands.dropped());
+    prom.counter("quiz_http_requests_total", "HTTP requests served", server.requestsServed());
+    prom.gauge("quiz_sse_subscribers", "Connected SSE clients", sseHub.count());
+    prom.counter("quiz_sse_rejected_total", "SSE clients turned away at capacity", sseHub.rejected());
+    prom.counter("quiz_sse_evictions_total", "SSE clients dropped for stalling", sseHub.evictions());
+    const char* clientMetrics[4][2] = {
+      {"quiz_sse_client_sent_bytes_total", "Bytes handed to TCP per SSE client"},
+      {"quiz_sse_client_sent_frames_total", "Frames fully handed to TCP per SSE client"},
+      {"quiz_sse_client_dropped_frames_total", "Frames dropped from a full queue per SSE client"},
+      {"quiz_sse_client_write_failures_total", "TCP writes refused per SSE client"},
+    };
+    for (int m=0;m<4;m++){
+      prom.header(clientMetrics[m][0], clientMetrics[m][1], "counter");
+      for (int i=0;i<SseHub::capacity();i++){
+        const SseHub::Subscriber& sub = sseHub.subscriber(i);
+        if (sub.client == NULL) continue;
+        uint32_t v = m == 0 ? sub.queue.sentBytes() : m == 1 ? sub.queue.sentFrames()
+                   : m == 2 ? sub.queue.droppedFrames() : sub.writeFailures;
+        prom.sample(clientMetrics[m][0], "slot", i, v);
+      }
+    }
+    prom.gauge("quiz_heap_free_bytes", "Free heap", heapFree);
+    prom.gauge("quiz_heap_largest_free_block_bytes", "Largest allocatable heap block", heapLargest);
+    prom.gauge("quiz_heap_min_free_bytes", "Lowest free heap since boot", heapMin);
+    prom.gauge("quiz_wifi_rssi_dbm", "WiFi signal strength", rssi);
+    prom.counter("quiz_wifi_disconnects_total", "WiFi disconnect events", wifiDisconnects);
+    prom.counter("quiz_wifi_reconnects_total", "WiFi reconnections after the first connect", wifiReconnects);
+    prom.gauge("quiz_journal_segments", "Journal segment files on flash", journal.segmentCount());
+    prom.counter("quiz_journal_records_total", "Records appended to the journal since boot", journal.records());
+    prom.counter("quiz_journal_written_bytes_total", "Journal bytes written to flash since boot", journal.bytesWritten());
+    prom.counter("quiz_journal_flushes_total", "Journal writes to flash since boot", journal.flushes());
+    prom.counter("quiz_journal_write_errors_total", "Journal writes that fell short", journal.writeErrors());
+    prom.counter("quiz_journal_dropped_records_total", "Records dropped by a full journal buffer mid-round", journal.droppedRecords());
+    prom.gauge("quiz_journal_torn_bytes", "Corrupt or torn journal bytes found at boot", journal.tornBytes());
+    prom.gauge("quiz_uptime_seconds", "Time since boot", millis() / 1000.0);
+    server.send(200, "text/plain; version=0.0.4", out);
+    return;
+  }
+
+  DynamicJsonDocument doc(JSON_OBJECT_SIZE(8) + JSON_OBJECT_SIZE(HISTOGRAMS) +
+                          HISTOGRAMS * (JSON_OBJECT_SIZE(7) + JSON_ARRAY_SIZE(LatencyHistogram::BUCKETS)) +
+                          JSON_OBJECT_SIZE(4) + JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(SSE_MAX_SUBSCRIBERS) +
+                          SSE_MAX_SUBSCRIBERS * JSON_OBJECT_SIZE(5) + 2 * JSON_OBJECT_SIZE(3) +
+                          JSON_OBJECT_SIZE(9));
+  doc["uptimeMs"] = millis();
+  JsonObject hist = doc.createNestedObject("histograms");
+  for (int k=0;k<HISTOGRAMS;k++){ addHistogram(hist, histograms[k].json, histograms[k].h); }
+  JsonObject queues = doc.createNestedObject("queueDropped");
+  queues["press"] = pressEvents.dropped();
+  queues["net"] = netEvents.dropped();
+  queues["command"] = commands.dropped();
+  doc["httpRequests"] = server.requestsServed();
+  JsonObject sse = doc.createNestedObject("sse");
+  sse["subscribers"] = sseHub.count();
+  sse["rejected"] = sseHub.rejected();
+  sse["evictions"] = sseHub.evictions();
+  JsonArray clients = sse.createNestedArray("clients");
+  for (int i=0;i<SseHub::capacity();i++){
+    const SseHub::Subscriber& sub = sseHub.subscriber(i);
+    if (sub.client == NULL) continue;
+    JsonObject o = clients.createNestedObject();
+    o["slot"] = i;
+    o["sentBytes"] = sub.queue.sentBytes();
+    o["sentFrames"] = sub.queue.sentFrames();
+    o["droppedFrames"] = sub.queue.droppedFrames();
+    o["writeFailures"] = sub.writeFailures;
+  }
+  JsonObject heap = doc.createNestedObject("heap");
+  heap["free"] = heapFree;
+  heap["largestFreeBlock"] = heapLargest;
+  heap["minFree"] = heapMin;
+  JsonObject jr = doc.createNestedObject("journal");
+  jr["segments"] = journal.segmentCount();
+  jr["bufferedBytes"] = journal.bufferedBytes();
+  jr["records"] = journal.records();
+  jr["bytesWritten"] = journal.bytesWritten();
+  jr["flushes"] = journal.flushes();
+  jr["writeErrors"] = journal.writeErrors();
+  jr["lostBytes"] = journal.lostBytes();
+  jr["droppedRecords"] = journal.droppedRecords();
+  jr["tornBytes"] = journal.tornBytes();
+  JsonObject wifi = doc.createNestedObject("wifi");
+  wifi["rssi"] = rssi;
+  wifi["disconnects"] = wifiDisconnects;
+  wifi["reconnects"] = wifiReconnects;
+  String out; serializeJson(doc,out);
+  server.send(200,"application/json",out);
+}
+
 void handleStatus(){
-  DynamicJsonDocument doc(512);
-  doc["gameActive"] = gameActive;
-  long remaining = gameActive ? (long)(gameStartTime + gameDuration - millis()) : 0;
+  // 12 keys, five of them arrays of up to PARTICIPANTS entries
+  DynamicJsonDocument doc(JSON_OBJECT_SIZE(12) + 5 * JSON_ARRAY_SIZE(PARTICIPANTS));
+  const RoundView& v = roundView;
+  doc["gameActive"] = v.active;
+  long remaining = v.active ? (long)(v.startMs + v.durationMs - millis()) : 0;
   if (remaining < 0) remaining = 0;
   doc["remainingMs"] = remaining;
+  doc["startUs"] = v.startUs;
   JsonArray arr = doc.createNestedArray("pressOrder");
-  for (int i=0;i<pressCount;i++){ arr.add(pressOrder[i]); }
+  for (int i=0;i<v.pressCount;i++){ arr.add(v.pressOrder[i]); }
+  JsonArray ts = doc.createNestedArray("pressTimestampsUs");
+  for (int i=0;i<v.pressCount;i++){ ts.add(v.pressTimestampsUs[i]); }
+  JsonArray ties = doc.createNestedArray("pressTies");
+  for (int i=0;i<v.pressCount;i++){ ties.add(v.pressTie[i]); }
+  JsonArray groups = doc.createNestedArray("pressTieGroups");
+  for (int i=0;i<v.pressCount;i++){ groups.add(v.pressTieGroup[i]); }
+  JsonArray places = doc.createNestedArray("pressPlaces");
+  bool provisional = false;
+  for (int i=0;i<v.pressCount;i++){ places.add(v.pressPlace[i]); provisional = provisional || v.pressPlace[i] != i; }
+  doc["provisional"] = provisional;
+  doc["tieWindowUs"] = v.tieWindowUs;
+  doc["tieBreak"] = TIE_BREAK_NAMES[v.tieBreak];
+  doc["tieSeed"] = v.seed;
   String out; serializeJson(doc,out);
   sendCors(); server.send(200,"application/json",out);
 }
 
-// Store game duration or return current config
+// NTP-style exchange on the device's esp_timer clock. The client sends its
+// own send time as ?t1= and gets it back with t2 (request received) and t3
+// (response sent), all in µs; with its receive time t4 it can estimate
+//   offset = ((t2 - t1) + (t3 - t4)) / 2,  rtt = (t4 - t1) - (t3 - t2)
+// and the offset is good to within rtt / 2. Press timestamps (timestampUs)
+// and roundStartUs are on the same clock. The body is formatted by hand so
+// t3 is taken as late as possible.
+void handleTime(){
+  const RoundView& v = roundView;
+  double t1 = server.arg("t1").toDouble();
+  long long t2 = server.receivedUs();
+  char out[160];
+  long long t3 = esp_timer_get_time();
+  snprintf(out, sizeof(out),
+           "{\"t1\":%.3f,\"t2\":%lld,\"t3\":%lld,\"roundActive\":%s,\"roundStartUs\":%llu}",
+           t1, t2, t3, v.active ? "true" : "false", (unsigned long long)v.startUs);
+  sendCors(); server.send(200,"application/json",out);
+}
+
+// Store game duration or return current config. Changes made during a
+// round apply from the next one; /api/status keeps showing the running
+// round's settings.
 void handleGameConfig(){
   if (server.method() == HTTP_GET) {
-    DynamicJsonDocument outDoc(128);
-    outDoc["durationMs"] = gameDuration;
+    DynamicJsonDocument outDoc(JSON_OBJECT_SIZE(3));
+    outDoc["durationMs"] = configuredDuration;
+    outDoc["tieWindowUs"] = configuredTieWindowUs;
+    outDoc["tieBreak"] = TIE_BREAK_NAMES[configuredTieBreak];
     String out;
     serializeJson(outDoc, out);
     sendCors();
@@ -295,211 +841,384 @@ void handleGameConfig(){
   String body = server.arg("plain");
   DynamicJsonDocument doc(256);
   deserializeJson(doc, body);
-  unsigned long d = doc["durationMs"] | gameDuration;
-  gameDuration = d;
+  unsigned long d = doc["durationMs"] | configuredDuration;
+  journalConfig(CMD_SET_DURATION, configuredDuration, d);
+  configuredDuration = d;
+  sendCommand(CMD_SET_DURATION, d);
+  uint32_t tieWindowUs = doc["tieWindowUs"] | configuredTieWindowUs;
+  journalConfig(CMD_SET_TIE_WINDOW, configuredTieWindowUs, tieWindowUs);
+  configuredTieWindowUs = tieWindowUs;
+  sendCommand(CMD_SET_TIE_WINDOW, configuredTieWindowUs);
+  const char* tieBreak = doc["tieBreak"] | TIE_BREAK_NAMES[configuredTieBreak];
+  for (uint8_t k=0;k<=TIE_BREAK_JUDGE;k++){
+    if (strcmp(tieBreak, TIE_BREAK_NAMES[k]) != 0) continue;
+    journalConfig(CMD_SET_TIE_BREAK, configuredTieBreak, k);
+    configuredTieBreak = k;
+  }
+  sendCommand(CMD_SET_TIE_BREAK, configuredTieBreak);
   sendCors(); server.send(200,"application/json","{}");
 }
 
+// Every round gets a fresh tie-break seed; it is logged when the round
+// starts and reported by /api/status.
 void handleGameStart(){
-  // Start game using current gameDuration
-  for (int i=0;i<10;i++){
-    pressOrder[i] = -1;
-    recorded[i] = false;
-    pressTimestamps[i] = 0;
-    pressOrderNo[i] = -1;
-    ledOffAt[i] = 0;
-    ledEffect[i] = 0;
-    ledCurrentState[i] = false;
-    patternUntil[i] = 0;
-    patternIndex[i] = 0;
-  }
-  pressCount = 0;
-  currentOrderNo = 0;
-  firstPressDetected = false;
-  firstPress = -1;
-  gameActive = true;
-  gameStartTime = millis();
-  beepEndTime = 0;
-  startBlinkEnd = gameStartTime + 200;
+  sendCommand(CMD_START, esp_random());
   sendCors(); server.send(200,"application/json","{}");
 }
 
-void handleGameReset(){
-  gameActive = false;
-  for (int i=0;i<10;i++){
-    pressOrder[i] = -1;
-    recorded[i] = false;
-    pressTimestamps[i] = 0;
-    pressOrderNo[i] = -1;
-    digitalWrite(ledPins[i], LOW);
-    ledOffAt[i] = 0;
+// The judge's call on a tie: {"teamIndex": n} takes the next place in its
+// tie group. Only ties under the "judge" policy are waiting for one.
+void handleGameTieBreak(){
+  DynamicJsonDocument doc(JSON_OBJECT_SIZE(1));
+  deserializeJson(doc, server.arg("plain"));
+  int team = doc["teamIndex"] | -1;
+  sendCors();
+  if (team < 0 || team >= PARTICIPANTS) {
+    server.send(400,"application/json","{\"error\":\"teamIndex required\"}");
+    return;
   }
-  pressCount = 0;
-  currentOrderNo = 0;
-  ledcWrite(PWM_CHANNEL,0);
-  beepEndTime = 0;
+  sendCommand(CMD_JUDGE_TIE, team);
+  server.send(200,"application/json","{}");
+}
+
+void handleGameReset(){
+  sendCommand(CMD_RESET, 0);
   sendCors(); server.send(200,"application/json","{}");
 }
 
-void loop()
+// Journal a setting the operator changed. Callers hold the server lock.
+void journalConfig(uint8_t key, uint32_t before, uint32_t after){
+  if (before == after) return;
+  JournalEntry j = journalEntry(JR_CONFIG, roundView.round, esp_timer_get_time());
+  j.key = key;
+  j.value = after;
+  journal.append(j);
+}
+
+// Queue a command for the arbiter and wake it. Callers hold the server lock,
+// which keeps the command ring single-producer across HTTP and WebSocket.
+bool sendCommand(uint8_t type, uint32_t value){
+  Command c;
+  c.type = type;
+  c.value = value;
+  if (!commands.push(c)) return false;
+  xTaskNotifyGive(arbiterTask);
+  return true;
+}
+
+// Hand a round update to the network task. Arbiter side.
+void publish(const NetEvent& e){
+  if (netEvents.push(e) && netTask != NULL) xTaskNotifyGive(netTask);
+}
+
+// Arbitration task: sleeps until the switch ISR notifies it or the next
+// LED/buzzer/round-end/merge deadline is due, so a press is handled as soon
+// as it arrives instead of on the next HTTP polling pass. The round logic
+// itself lives in GameCore.
+void arbiterLoop(void* arg)
 {
-  server.handleClient();
-  if (gameActive) {
+  attachSwitchInterrupts();
+  TickType_t wait = portMAX_DELAY;
+  unsigned long deadline = 0;
+  for (;;) {
+    uint32_t notified = ulTaskNotifyTake(pdTRUE, wait);
+    int64_t t0 = esp_timer_get_time();
+    // How late a wakeup that only waited for its deadline came; this is
+    // what load on the network core must not move.
+    int64_t lateUs = t0 - (int64_t)deadline * 1000;
+    if (notified == 0 && deadline != 0) arbiterLateUs.record(lateUs > 0 ? (uint32_t)lateUs : 0);
+    Command c;
+    while (commands.pop(c)) game.command(c);
+    PressEvent ev;
+    while (pressEvents.pop(ev)) game.addLocalPress(ev);
+    while (remotePresses.pop(ev)) game.addRemotePress(ev);
+    unsigned long next = game.service();
+    arbiterPassUs.record((uint32_t)(esp_timer_get_time() - t0));
     unsigned long now = millis();
-    for (int i = 0; i < 10; i++) {
-      if (switchPressed[i]) {
-        switchPressed[i] = false;
-        bool isPress = (digitalRead(switchPins[i]) == LOW);
-        if (isPress && !recorded[i]) {
-          recorded[i] = true;
-          pressTimestamps[i] = millis(); // Server-side timestamp
-          pressOrderNo[i] = currentOrderNo++; // Assign order number
-          if (pressCount < 10) pressOrder[pressCount++] = i;
-          ledOffAt[i] = now + PRESS_LED_MS;
-          beepEndTime = now + PRESS_BEEP_MS;
-          int order = pressOrderNo[i];
-          if (order == 0) {
-            ledEffect[i] = 3;
-            patternIndex[i] = 0;
-            ledCurrentState[i] = true;
-            digitalWrite(ledPins[i], HIGH);
-            patternUntil[i] = now + E3_SEQ_MS[0];
-          } else if (order == 1) {
-            ledEffect[i] = 2;
-            patternIndex[i] = 0;
-            ledCurrentState[i] = true;
-            digitalWrite(ledPins[i], HIGH);
-            patternUntil[i] = now + E2_SEQ_MS[0];
-          } else if (order == 2) {
-            ledEffect[i] = 1;
-            patternIndex[i] = 0;
-            ledCurrentState[i] = true;
-            digitalWrite(ledPins[i], HIGH);
-            patternUntil[i] = now + E1_SEQ_MS[0];
-          } else {
-            ledEffect[i] = 4;
-            patternUntil[i] = 0;
-            patternIndex[i] = 0;
-            ledCurrentState[i] = true;
-            digitalWrite(ledPins[i], HIGH);
-          }
-          
-          // Send SSE event with timestamp and order number
-          DynamicJsonDocument eventData(256);
-          eventData["type"] = "press";
-          eventData["teamIndex"] = i;
-          eventData["timestamp"] = pressTimestamps[i];
-          eventData["orderNo"] = pressOrderNo[i];
-          eventData["pressCount"] = pressCount;
-          
-          String eventStr;
-          serializeJson(eventData, eventStr);
-          sendSSEEvent("buzzer", eventStr.c_str());
-        }
-      }
-    }
-    if (startBlinkEnd > now) {
-      for (int i=0;i<10;i++){ digitalWrite(ledPins[i], HIGH); }
+    deadline = next;
+    if (next == 0) {
+      wait = portMAX_DELAY;
     } else {
-      for (int i = 0; i < 10; i++) {
-        int eff = ledEffect[i];
-        if (eff == 0) {
-          digitalWrite(ledPins[i], LOW);
-        } else if (eff == 4) {
-          digitalWrite(ledPins[i], HIGH);
-        } else if (eff == 3) {
-          if (patternUntil[i] == 0) {
-            patternIndex[i] = 0;
-            ledCurrentState[i] = true;
-            digitalWrite(ledPins[i], HIGH);
-            patternUntil[i] = now + E3_SEQ_MS[0];
-          } else if (now >= patternUntil[i]) {
-            patternIndex[i] = (patternIndex[i] + 1) % E3_LEN;
-            ledCurrentState[i] = (patternIndex[i] % 2 == 0);
-            digitalWrite(ledPins[i], ledCurrentState[i] ? HIGH : LOW);
-            patternUntil[i] = now + E3_SEQ_MS[patternIndex[i]];
-          }
-        } else if (eff == 2) {
-          if (patternUntil[i] == 0) {
-            patternIndex[i] = 0;
-            ledCurrentState[i] = true;
-            digitalWrite(ledPins[i], HIGH);
-            patternUntil[i] = now + E2_SEQ_MS[0];
-          } else if (now >= patternUntil[i]) {
-            patternIndex[i] = (patternIndex[i] + 1) % E2_LEN;
-            ledCurrentState[i] = (patternIndex[i] % 2 == 0);
-            digitalWrite(ledPins[i], ledCurrentState[i] ? HIGH : LOW);
-            patternUntil[i] = now + E2_SEQ_MS[patternIndex[i]];
-          }
-        } else if (eff == 1) {
-          if (patternUntil[i] == 0) {
-            patternIndex[i] = 0;
-            ledCurrentState[i] = true;
-            digitalWrite(ledPins[i], HIGH);
-            patternUntil[i] = now + E1_SEQ_MS[0];
-          } else if (now >= patternUntil[i]) {
-            patternIndex[i] = (patternIndex[i] + 1) % E1_LEN;
-            ledCurrentState[i] = (patternIndex[i] % 2 == 0);
-            digitalWrite(ledPins[i], ledCurrentState[i] ? HIGH : LOW);
-            patternUntil[i] = now + E1_SEQ_MS[patternIndex[i]];
-          }
-        }
-      }
+      wait = (next > now) ? pdMS_TO_TICKS(next - now) : 0;
+      if (wait == 0) wait = 1;
     }
-    if (beepEndTime > now) {
-      ledcWriteTone(PWM_CHANNEL, 2000);
-      ledcWrite(PWM_CHANNEL, 255);
-    } else {
-      ledcWrite(PWM_CHANNEL, 0);
+  }
+}
+
+// Frames are rendered here once and reused for every subscriber.
+SseFrame frame;
+
+// Apply one round update to roundView and fan it out to SSE clients.
+// Net side.
+void applyNetEvent(const NetEvent& e)
+{
+  RoundView& v = roundView;
+  // A round cut short by a reset or a restart still goes into the history.
+  if ((e.type == NET_ROUND_START || e.type == NET_RESET) && v.active) recordHistory(true, e.timeUs);
+  if (e.type == NET_ROUND_START) v.round++;
+  JournalEntry j;
+  if (journalEntryFor(e, v.round, j)) journal.append(j);
+  if (e.type == NET_ROUND_START || e.type == NET_RESET) {
+    v.active = (e.type == NET_ROUND_START);
+    v.startMs = e.startMs;
+    v.startUs = v.active ? e.timeUs : 0;
+    v.durationMs = e.durationMs;
+    v.pressCount = 0;
+    v.ended = false;
+    for (int i=0;i<PARTICIPANTS;i++){
+      v.pressOrder[i] = -1; v.pressTimestampsUs[i] = 0; v.pressTie[i] = false;
+      v.pressPlace[i] = -1; v.pressTieGroup[i] = -1;
+    }
+    if (e.type == NET_ROUND_START) {
+      v.tieBreak = e.tieBreak;
+      v.tieWindowUs = e.tieWindowUs;
+      v.seed = e.seed;
+      Serial.printf("Round started: tie break %s, seed %u\n", TIE_BREAK_NAMES[e.tieBreak], (unsigned)e.seed);
+    }
+    if (e.type == NET_ROUND_START) wsServer.broadcastBIN(wsBuf, wsEncodeStart(wsBuf, e.startMs, e.durationMs));
+    else wsServer.broadcastBIN(wsBuf, wsEncodeReset(wsBuf));
+    if (cluster.role() == ClusterLink::COORDINATOR) {
+      cluster.sendRound(e.type == NET_ROUND_START ? CLUSTER_ROUND_START : CLUSTER_ROUND_RESET, e.durationMs);
+    }
+  } else if (e.type == NET_FORWARD_PRESS) {
+    cluster.sendPress((uint8_t)e.teamIndex, (int64_t)e.timeUs, e.tie);
+  } else if (e.type == NET_PRESS) {
+    if (e.teamIndex >= LOCAL_STATIONS && cluster.role() == ClusterLink::COORDINATOR) {
+      cluster.sendPlace(e.teamIndex / LOCAL_STATIONS, e.teamIndex % LOCAL_STATIONS, e.orderNo);
     }
-    if (now - gameStartTime >= gameDuration) {
-      DynamicJsonDocument d(256);
-      d["type"] = "result";
-      JsonArray top = d.createNestedArray("top3");
-      for (int k=0;k<3;k++){ if (k<pressCount) top.add(pressOrder[k]); }
-      String s; serializeJson(d,s);
-      sendSSEEvent("result", s.c_str());
-      gameActive = false;
-      for (int i=0;i<10;i++) { digitalWrite(ledPins[i], LOW); }
+    if (v.pressCount < PARTICIPANTS) {
+      v.pressOrder[v.pressCount] = e.teamIndex;
+      v.pressTimestampsUs[v.pressCount] = e.timeUs;
+      v.pressTie[v.pressCount] = e.tie;
+      v.pressPlace[v.pressCount] = e.orderNo;
+      v.pressTieGroup[v.pressCount] = e.tie ? e.tieGroup : -1;
+      v.pressCount++;
     }
+    // Send SSE event with timestamp and order number
+    renderPressFrame(frame, sseHub.nextId(), e, v.startUs);
+    sendSSEEvent(frame);
+    recordToSseUs.record((uint32_t)esp_timer_get_time() - e.recordUs);
+    wsServer.broadcastBIN(wsBuf, wsEncodePress(wsBuf, e.teamIndex, e.orderNo, e.pressCount, frame.id(), e.timeUs));
+    pressToEventUs.record((uint32_t)(esp_timer_get_time() - e.timeUs));
+  } else if (e.type == NET_TIE_RESOLVED) {
+    // Move the team to its final place; the rest of its group shifts down
+    // and shares the next place.
+    int k = 0;
+    while (k < v.pressCount && v.pressOrder[k] != e.teamIndex) k++;
+    if (k == v.pressCount || e.orderNo > k) return;
+    uint64_t ts = v.pressTimestampsUs[k];
+    for (; k > e.orderNo; k--) {
+      v.pressOrder[k] = v.pressOrder[k-1];
+      v.pressTimestampsUs[k] = v.pressTimestampsUs[k-1];
+      v.pressPlace[k] = v.pressPlace[k-1];
+    }
+    v.pressOrder[k] = e.teamIndex;
+    v.pressTimestampsUs[k] = ts;
+    v.pressPlace[k] = e.orderNo;
+    for (int j=k+1;j<v.pressCount;j++){ if (v.pressTieGroup[j] == e.tieGroup && v.pressPlace[j] <= e.orderNo) v.pressPlace[j] = e.orderNo + 1; }
+    if (e.teamIndex >= LOCAL_STATIONS && cluster.role() == ClusterLink::COORDINATOR) {
+      cluster.sendPlace(e.teamIndex / LOCAL_STATIONS, e.teamIndex % LOCAL_STATIONS, e.orderNo);
+    }
+    renderTieFrame(frame, sseHub.nextId(), e);
+    sendSSEEvent(frame);
+    if (v.ended) {
+      renderResultFrame(frame, sseHub.nextId(), v.pressOrder, v.pressPlace, v.pressTieGroup, v.pressCount);
+      sendSSEEvent(frame);
+      recordHistory(false, v.endUs);
+    }
+  } else if (e.type == NET_ROUND_END) {
+    v.active = false;
+    v.ended = true;
+    v.endUs = e.timeUs;
+    recordHistory(false, v.endUs);
+    renderResultFrame(frame, sseHub.nextId(), v.pressOrder, v.pressPlace, v.pressTieGroup, v.pressCount);
+    sendSSEEvent(frame);
+    uint8_t top = v.pressCount < 3 ? v.pressCount : 3;
+    wsServer.broadcastBIN(wsBuf, wsEncodeResult(wsBuf, v.pressOrder, top, frame.id()));
+    if (cluster.role() == ClusterLink::COORDINATOR) cluster.sendRound(CLUSTER_ROUND_END, 0);
   }
-  delay(10);
 }
 
-WiFiClient sseClients[4];
-bool sseActive[4] = {false,false,false,false};
+// Store the round in roundView in the history. Net side.
+void recordHistory(bool aborted, uint64_t endUs)
+{
+  const RoundView& v = roundView;
+  RoundHistory<PARTICIPANTS>::Record r;
+  r.round = v.round;
+  r.elapsedMs = RoundHistory<PARTICIPANTS>::elapsedMs(v.startUs, endUs);
+  r.tieBreak = v.tieBreak;
+  r.aborted = aborted;
+  r.pressCount = v.pressCount;
+  for (int i=0;i<v.pressCount;i++){
+    r.order[i] = v.pressOrder[i];
+    r.place[i] = v.pressPlace[i];
+    r.reactionUs[i] = (uint32_t)(v.pressTimestampsUs[i] - v.startUs);
+  }
+  history.put(r);
+}
+
+void drainNetEvents()
+{
+  NetEvent e;
+  while (netEvents.pop(e)) applyNetEvent(e);
+}
+
+// Network task: pushes round updates to SSE and WebSocket clients whenever
+// the arbiter publishes, and services SSE heartbeats. HTTP requests are
+// served from the AsyncTCP task; both sides take the server lock before
+// touching roundView or the SSE registry. The WebSocket server and the
+// cluster socket are polled, so the task wakes every WS_POLL_MS as well; only
+// this task touches wsServer and cluster.
+void netLoop(void* arg)
+{
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WS_POLL_MS));
+    int64_t t0 = esp_timer_get_time();
+    server.lock();
+    drainNetEvents();
+    sseHub.service(millis());
+    if (!roundView.active) journal.flush();
+    server.unlock();
+    wsServer.loop();
+    cluster.poll(millis());
+    netPassUs.record((uint32_t)(esp_timer_get_time() - t0));
+  }
+}
+
+// Commands arrive as 12-byte binary frames (see WsProtocol.h) and are
+// acknowledged on the same socket once queued for the arbiter.
+void handleWsEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length)
+{
+  if (type == WStype_CONNECTED) wsClients++;
+  if (type == WStype_DISCONNECTED && wsClients > 0) wsClients--;
+  if (type != WStype_BIN) return;
+  int64_t t0 = esp_timer_get_time();
+  uint8_t ack[WS_ACK_LEN];
+  WsCommand cmd;
+  if (!wsDecodeCommand(payload, length, cmd)) {
+    wsServer.sendBIN(num, ack, wsEncodeAck(ack, length ? payload[0] : 0, WS_ACK_BAD_COMMAND, 0));
+    return;
+  }
+  bool queued = true;
+  server.lock();
+  if (cmd.op == WS_OP_START) {
+    queued = sendCommand(CMD_START, esp_random());
+  } else if (cmd.op == WS_OP_RESET) {
+    queued = sendCommand(CMD_RESET, 0);
+  } else if (cmd.op == WS_OP_CONFIG) {
+    journalConfig(CMD_SET_DURATION, configuredDuration, cmd.value);
+    configuredDuration = cmd.value;
+    queued = sendCommand(CMD_SET_DURATION, cmd.value);
+  }
+  server.unlock();
+  wsServer.sendBIN(num, ack, wsEncodeAck(ack, cmd.op, queued ? WS_ACK_OK : WS_ACK_BUSY, cmd.seq));
+  wsCommandUs.record((uint32_t)(esp_timer_get_time() - t0));
+}
+
+void loop()
+{
+  // All work happens in the arbiter and net tasks.
+  vTaskDelete(NULL);
+}
 
 void handleEvents() {
-  WiFiClient client = server.client();
-  client.print(
+  if (sseHub.full()) {
+    sseHub.noteRejected();
+    sendBusy("SSE subscriber limit reached");
+    return;
+  }
+  // EventSource sends Last-Event-ID on its own reconnects; a freshly created
+  // EventSource can pass it as ?lastEventId= instead.
+  String lastId = server.header("Last-Event-ID");
+  if (lastId.length() == 0) lastId = server.arg("lastEventId");
+  AsyncClient* client = server.beginStream();
+  if (client == NULL) {
+    sendBusy("Earlier response still sending");
+    return;
+  }
+  const char* head =
     "HTTP/1.1 200 OK\r\n"
     "Content-Type: text/event-stream\r\n"
     "Cache-Control: no-cache\r\n"
     "Connection: keep-alive\r\n"
     "Access-Control-Allow-Origin: *\r\n\r\n"
-  );
-  client.print(": connected\n\n");
-  client.setNoDelay(true);
-  for (int i=0;i<4;i++){
-    if (!sseActive[i] || !sseClients[i].connected()){
-      sseClients[i] = client;
-      sseActive[i] = true;
-      break;
+    "retry: 1000\n"
+    ": connected\n\n";
+  client->write(head);
+  sseHub.attach(client, lastId.length() > 0, (uint32_t)strtoul(lastId.c_str(), NULL, 10));
+}
+
+// Past rounds, oldest first. ?from=<round> pages forward from that round,
+// otherwise the newest rounds are returned; ?limit= caps the page at up to
+// HISTORY_PAGE rounds. "next" is the from= of the following page, absent
+// on the last one.
+void handleHistory(){
+  int count = history.count();
+  int limit = server.hasArg("limit") ? server.arg("limit").toInt() : HISTORY_PAGE;
+  if (limit < 1 || limit > HISTORY_PAGE) limit = HISTORY_PAGE;
+  RoundHistory<PARTICIPANTS>::Page page =
+    history.page(server.hasArg("from"), strtoul(server.arg("from").c_str(), NULL, 10), limit);
+  DynamicJsonDocument doc(JSON_OBJECT_SIZE(5) + JSON_ARRAY_SIZE(HISTORY_PAGE) +
+                          HISTORY_PAGE * (JSON_OBJECT_SIZE(7) + 3 * JSON_ARRAY_SIZE(PARTICIPANTS)));
+  doc["capacity"] = history.capacity();
+  doc["oldest"] = count ? history.at(0).round : 0;
+  doc["newest"] = count ? history.at(count - 1).round : 0;
+  if (page.last < count) doc["next"] = history.at(page.last).round;
+  JsonArray rounds = doc.createNestedArray("rounds");
+  for (int k=page.first;k<page.last;k++){
+    const RoundHistory<PARTICIPANTS>::Record& r = history.at(k);
+    JsonObject o = rounds.createNestedObject();
+    o["round"] = r.round;
+    o["elapsedMs"] = r.elapsedMs;
+    o["tieBreak"] = TIE_BREAK_NAMES[r.tieBreak];
+    o["aborted"] = r.aborted;
+    JsonArray order = o.createNestedArray("order");
+    JsonArray places = o.createNestedArray("places");
+    JsonArray reaction = o.createNestedArray("reactionUs");
+    for (int i=0;i<r.pressCount;i++){
+      order.add(r.order[i]);
+      places.add(r.place[i]);
+      reaction.add(r.reactionUs[i]);
     }
   }
+  String out; serializeJson(doc,out);
+  sendCors(); server.send(200,"application/json",out);
 }
 
-void sendSSEEvent(const char* event, const char* data) {
-  for (int i=0;i<4;i++){
-    if (sseActive[i] && sseClients[i].connected()){
-      sseClients[i].print("event: ");
-      sseClients[i].print(event);
-      sseClients[i].print("\ndata: ");
-      sseClients[i].print(data);
-      sseClients[i].print("\n\n");
-    } else {
-      sseActive[i] = false;
-    }
+// The journal as one chunked application/octet-stream, oldest record first
+// (framing in PressJournal.h), sent as fast as the client ACKs it.
+void handleJournal() {
+  if (!journal.enabled() || journalExport.active()) {
+    sendBusy(journal.enabled() ? "Journal export in progress" : "Journal unavailable");
+    return;
+  }
+  AsyncClient* client = server.beginStream();
+  if (client == NULL) {
+    sendBusy("Earlier response still sending");
+    return;
   }
-  Serial.printf("SSE Event: %s - %s\n", event, data);
+  const char* head =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/octet-stream\r\n"
+    "Content-Disposition: attachment; filename=\"journal.bin\"\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: close\r\n"
+    "Access-Control-Allow-Origin: *\r\n\r\n";
+  client->write(head);
+  journalExport.begin(journal, client);
+}
+
+void handleStreamClose(AsyncClient* client) {
+  if (client == journalExport.client()) journalExport.abort();
+  else sseHub.detach(client);
+}
+
+void handleStreamWritable(AsyncClient* client) {
+  if (client == journalExport.client()) journalExport.pump();
+  else sseHub.onWritable(client);
+}
+
+void sendSSEEvent(const SseFrame& frame) {
+  sseHub.broadcast(frame);
 }
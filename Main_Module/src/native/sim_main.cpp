@@ -0,0 +1,237 @@
+// Host build of the game core (pio run -e native). Runs a SimBoard on the
+// virtual clock, plays one scripted round and prints every round update and
+// the SSE bytes a client would have received, then journals the round on
+// the flash emulator, cuts the power in the middle of a write, boots the
+// journal again and exports it the way GET /api/journal does. Runs are
+// deterministic, so the output can be diffed between builds.
+//
+//   program [timestamp|random|judge] [seed]   tie-break policy for the round
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SimBoard.h"
+#include "RoundFrames.h"
+#include "SseHub.h"
+#include "FlashFs.h"
+#include "PressJournal.h"
+
+// `pio test -e native` builds src/ into every test; the tests bring their
+// own main().
+#ifndef PIO_UNIT_TESTING
+
+#ifndef PARTICIPANTS
+#define PARTICIPANTS 10
+#endif
+
+SimBoard<PARTICIPANTS> board;
+SseHub sseHub;
+SseFrame frame;
+HalStreamClient client;
+uint64_t roundStartUs = 0;
+int pressOrder[PARTICIPANTS];
+int pressPlace[PARTICIPANTS];
+int pressTieGroup[PARTICIPANTS];
+int pressCount = 0;
+bool roundEnded = false;
+uint32_t roundNo = 0;
+PressJournal<SimFlashFs>* journal = NULL;
+
+void setSwitches(uint32_t mask, bool down)
+{
+  uint32_t edges = board.setSwitches(mask, down);
+  if (edges) board.isr(edges);
+}
+
+void setSwitch(int i, bool down) { setSwitches(1u << i, down); }
+
+// The network task's half: round updates become SSE frames.
+void drainNetEvents()
+{
+  NetEvent e;
+  while (board.netEvents.pop(e)) {
+    if (e.type == NET_ROUND_START) roundNo++;
+    JournalEntry j;
+    if (journalEntryFor(e, roundNo, j)) journal->append(j);
+    printf("%10.3f ms  ", halMicros() / 1000.0);
+    if (e.type == NET_ROUND_START) {
+      roundStartUs = e.timeUs;
+      pressCount = 0;
+      printf("round start, %u ms\n", (unsigned)e.durationMs);
+    } else if (e.type == NET_RESET) {
+      pressCount = 0;
+      printf("reset\n");
+    } else if (e.type == NET_PRESS) {
+      if (pressCount < PARTICIPANTS) {
+        pressOrder[pressCount] = e.teamIndex;
+        pressPlace[pressCount] = e.orderNo;
+        pressTieGroup[pressCount] = e.tie ? e.tieGroup : -1;
+        pressCount++;
+      }
+      printf("press team %d place %d", e.teamIndex, e.orderNo);
+      if (e.tie) printf(" (tie group %d)", e.tieGroup);
+      printf("\n");
+      renderPressFrame(frame, sseHub.nextId(), e, roundStartUs);
+      sseHub.broadcast(frame);
+    } else if (e.type == NET_TIE_RESOLVED) {
+      int k = 0;
+      while (pressOrder[k] != e.teamIndex) k++;
+      for (; k > e.orderNo; k--) {
+        pressOrder[k] = pressOrder[k - 1];
+        pressPlace[k] = pressPlace[k - 1];
+      }
+      pressOrder[k] = e.teamIndex;
+      pressPlace[k] = e.orderNo;
+      for (int j = k + 1; j < pressCount; j++) {
+        if (pressTieGroup[j] == e.tieGroup && pressPlace[j] <= e.orderNo) pressPlace[j] = e.orderNo + 1;
+      }
+      printf("judge places team %d at %d\n", e.teamIndex, e.orderNo);
+      renderTieFrame(frame, sseHub.nextId(), e);
+      sseHub.broadcast(frame);
+      if (roundEnded) {
+        renderResultFrame(frame, sseHub.nextId(), pressOrder, pressPlace, pressTieGroup, pressCount);
+        sseHub.broadcast(frame);
+      }
+    } else if (e.type == NET_ROUND_END) {
+      printf("round end\n");
+      roundEnded = true;
+      renderResultFrame(frame, sseHub.nextId(), pressOrder, pressPlace, pressTieGroup, pressCount);
+      sseHub.broadcast(frame);
+    }
+    client.ack(client.inFlight);
+  }
+  if (!board.game.active()) journal->flush();
+}
+
+// Print a journal export: undo the chunked encoding, then decode the
+// records, skipping whatever fails its CRC.
+void printJournal(const std::string& http)
+{
+  std::string body;
+  size_t at = http.find("\r\n\r\n") + 4;
+  for (;;) {
+    size_t len = strtoul(http.c_str() + at, NULL, 16);
+    at = http.find("\r\n", at) + 2;
+    if (len == 0) break;
+    body.append(http, at, len);
+    at += len + 2;
+  }
+  const char* names[] = {"?", "boot", "round start", "press", "tie resolved", "round end", "reset", "config"};
+  const uint8_t* p = (const uint8_t*)body.data();
+  size_t have = body.size();
+  size_t skipped = 0;
+  while (have > 0) {
+    JournalEntry e;
+    size_t used = 0;
+    if (JournalCodec::decode(p, have, e, used) != JournalCodec::OK) {
+      p++;
+      have--;
+      skipped++;
+      continue;
+    }
+    printf("  round %u %-12s", (unsigned)e.round, names[e.type <= JR_CONFIG ? e.type : 0]);
+    if (e.type == JR_ROUND_START) printf(" %u ms, window %u us, policy %u, seed %u",
+                                         (unsigned)e.value, (unsigned)e.tieWindowUs, e.key, (unsigned)e.seed);
+    if (e.type == JR_PRESS) printf(" team %d place %d at %.3f ms", e.team, e.place, e.timeUs / 1000.0);
+    if (e.type == JR_PRESS && e.tieGroup >= 0) printf(" (tie group %d)", e.tieGroup);
+    if (e.type == JR_TIE_RESOLVED) printf(" team %d place %d", e.team, e.place);
+    if (e.type == JR_ROUND_END) printf(" %d presses", e.place);
+    if (e.type == JR_CONFIG) printf(" command %u = %u", e.key, (unsigned)e.value);
+    printf("\n");
+    p += used;
+    have -= used;
+  }
+  printf("  %u bytes, %u skipped\n", (unsigned)body.size(), (unsigned)skipped);
+}
+
+// Advance the virtual clock in 100 µs steps, running the arbiter each step
+// and the 1 kHz scan timer every tenth.
+void runFor(uint64_t us)
+{
+  for (uint64_t t = 0; t < us; t += 100) {
+    simClockAdvanceUs(100);
+    if (halMicros() % 1000 == 0) board.isr(0);
+    board.arbiterPass();
+    drainNetEvents();
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const char* names[] = {"timestamp", "random", "judge"};
+  uint32_t tieBreak = TIE_BREAK;
+  for (uint32_t k = 0; argc > 1 && k <= TIE_BREAK_JUDGE; k++) {
+    if (strcmp(argv[1], names[k]) == 0) tieBreak = k;
+  }
+  uint32_t seed = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 1;
+  char dir[] = "/tmp/quiz-flash-XXXXXX";
+  if (mkdtemp(dir) == NULL) return 1;
+  // Small segments and buffer so one round already rotates.
+  SimFlashFs flash(dir);
+  PressJournal<SimFlashFs> bootJournal(flash, 256, 4, 192);
+  bootJournal.begin(0);
+  journal = &bootJournal;
+  simClockSetUs(1000000);
+  sseHub.attach(&client, false, 0);
+
+  board.command(CMD_SET_DURATION, 2000);
+  board.command(CMD_SET_TIE_BREAK, tieBreak);
+  board.command(CMD_START, seed);
+  drainNetEvents();
+
+  runFor(150000);
+  setSwitches((1u << 3) | (1u << 1), true); // teams 1 and 3 in the same snapshot
+  runFor(200);
+  for (int k = 0; k < 4; k++) { // team 7 with contact bounce
+    setSwitch(7, true);
+    runFor(300);
+    setSwitch(7, false);
+    runFor(300);
+  }
+  setSwitch(7, true);
+  runFor(400000);
+  setSwitch(3, false);
+  runFor(100000);
+  setSwitch(3, true);          // second press of the same team is ignored
+  setSwitch(5, true);          // well outside the tie window
+  runFor(1500000);
+  if (tieBreak == TIE_BREAK_JUDGE) { // the judge ranks the tie 7, 3, 1
+    board.command(CMD_JUDGE_TIE, 7);
+    runFor(1000);
+    board.command(CMD_JUDGE_TIE, 3);
+    runFor(1000);
+  }
+
+  printf("\nSSE stream (%u bytes):\n%s", (unsigned)client.sent.size(), client.sent.c_str());
+  printf("buzzer writes %u, LED register stores %u, press-to-record p99 %u us\n",
+         (unsigned)board.buzzerOut.writes, (unsigned)board.regs.stores,
+         (unsigned)board.game.pressToRecordUs().percentile(99));
+
+  // Power fails 10 bytes into writing a config change; the next boot skips
+  // the torn record and starts a fresh segment.
+  JournalEntry change = journalEntry(JR_CONFIG, roundNo, halMicros());
+  change.key = CMD_SET_DURATION;
+  change.value = 3000;
+  journal->append(change);
+  flash.powerCut(10);
+  journal->flush();
+  flash.powerOn();
+  PressJournal<SimFlashFs> rebooted(flash, 256, 4, 192);
+  rebooted.begin(0);
+  printf("\njournal after reboot: %d segments, last round %u, %u torn bytes, %u flash erases\n",
+         rebooted.segmentCount(), (unsigned)rebooted.lastRound(), (unsigned)rebooted.tornBytes(),
+         (unsigned)flash.erases);
+
+  // GET /api/journal through a 600-byte TCP window.
+  HalStreamClient http;
+  http.window = 600;
+  const char* head = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+  http.add(head, strlen(head));
+  http.send();
+  JournalExport<PressJournal<SimFlashFs>, HalStreamClient> exporter;
+  exporter.begin(rebooted, &http);
+  while (exporter.pump()) http.ack(http.inFlight);
+  printJournal(http.sent);
+  std::filesystem::remove_all(dir);
+  return 0;
+}
+#endif
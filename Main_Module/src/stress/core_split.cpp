@@ -0,0 +1,292 @@
+// Core-split stress test (pio run -e native-core-split).
+//
+// Two host threads stand in for the device's cores and share only the
+// SpscRing queues main.cpp uses: the arbiter thread plays the switch ISR
+// and the arbiter task, pushing presses into pressEvents and running the
+// game core; the net thread plays the network task and the HTTP server,
+// draining netEvents, fanning presses out to SSE clients and starting the
+// next round through commands. The virtual clock follows the wall clock,
+// set by the arbiter thread only.
+//
+// Presses fall at random points in each round. A press is measured from
+// when the game core should have recorded it (its time plus the merge
+// hold) to when it did: that lateness is the arbitration latency. Each
+// phase runs for the same time and prints one JSON line:
+//
+//   split-idle  the net thread only drains round updates, every 2 ms
+//   split-load  the net thread also serves /api/status-sized requests
+//               back to back, each holding the server lock
+//   loop-load   one thread does both, one request per pass, as the
+//               firmware did before the split
+//
+// A last line compares split-load with split-idle: arbitration is flat
+// when the p99 lateness under load stays within FLAT_US of the idle one.
+// The arbiter thread gets SCHED_FIFO when the host allows it, as the
+// arbiter task outranks the network task on the device, and the threads
+// are pinned to separate CPUs when there are two.
+//
+//   program [--seconds 4] [--requestUs 2000] [--clients 8]
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SimBoard.h"
+#include "RoundFrames.h"
+#include "SseHub.h"
+
+typedef std::chrono::steady_clock Clock;
+
+const int STATIONS = 10;
+const uint32_t ROUND_MS = 300;
+const uint32_t FLAT_US = 250;
+const uint32_t HOLD_US = (uint32_t)INPUT_ORDER_HOLD_MS * 1000;
+
+struct Options {
+  double seconds = 4;
+  uint32_t requestUs = 2000;  // handler time of one request
+  int clients = 8;            // SSE subscribers
+};
+
+Options opt;
+Clock::time_point epoch;
+
+// Wall time as the virtual clock reads it: starts at 1 s, like the sims.
+uint64_t wallUs()
+{
+  return 1000000 + std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - epoch).count();
+}
+
+void sleepUntilUs(uint64_t us)
+{
+  std::this_thread::sleep_until(epoch + std::chrono::microseconds(us - 1000000));
+}
+
+struct Phase {
+  const char* name;
+  bool split;
+  bool load;
+};
+
+struct Result {
+  LatencyHistogram lateUs;
+  uint32_t scheduled = 0;
+  uint32_t recorded = 0;
+  uint32_t rounds = 0;
+  uint32_t requests = 0;
+  uint64_t sseBytes = 0;
+  uint32_t pressQueueDropped = 0;
+  uint32_t netQueueDropped = 0;
+  uint32_t commandQueueDropped = 0;
+  bool realtime = false;
+  bool pinned = false;
+};
+
+// Everything one phase runs on. The arbiter side touches board, presses
+// and the clock; the net side the hub, clients, lock and result counters.
+struct Rig {
+  SimBoard<STATIONS> board;
+  SpscRing<Command, 8> commands;
+  std::mt19937 rng{7};
+  std::vector<uint64_t> presses;  // this round's, sorted
+  size_t nextPress = 0;
+  uint32_t scheduled = 0;
+
+  SseHub hub;
+  SseFrame frame;
+  std::vector<HalStreamClient> clients;
+  std::mutex serverLock;
+  std::string status;
+  Result result;
+
+  explicit Rig(int n) : clients(n) {
+    for (HalStreamClient& c : clients) hub.attach(&c, false, 0);
+  }
+
+  // ISR and arbiter task: push the presses that are due, apply commands,
+  // run the game core. Returns when it next has something to do.
+  uint64_t arbiterStep() {
+    uint64_t now = wallUs();
+    simClockSetUs(now);
+    for (; nextPress < presses.size() && presses[nextPress] <= now; nextPress++) {
+      PressEvent ev = {presses[nextPress], (uint8_t)(nextPress % STATIONS), LOW, 0};
+      board.pressEvents.push(ev);
+    }
+    Command c;
+    while (commands.pop(c)) {
+      board.game.command(c);
+      if (c.type == CMD_START) schedulePresses();
+    }
+    unsigned long next = board.arbiterPass();
+    uint64_t wake = now + 1000;  // commands are polled, not notified
+    if (next && (uint64_t)next * 1000 < wake) wake = (uint64_t)next * 1000;
+    if (nextPress < presses.size() && presses[nextPress] < wake) wake = presses[nextPress];
+    return wake;
+  }
+
+  // One press per station, 10 ms to ROUND_MS - 10 ms into the round.
+  void schedulePresses() {
+    std::uniform_int_distribution<uint32_t> at(10000, ROUND_MS * 1000 - 10000);
+    presses.clear();
+    for (int i = 0; i < STATIONS; i++) presses.push_back(board.game.startUs() + at(rng));
+    std::sort(presses.begin(), presses.end());
+    nextPress = 0;
+    scheduled += STATIONS;
+  }
+
+  // Network task: round updates to SSE, the next round after each end.
+  void netStep() {
+    std::lock_guard<std::mutex> lock(serverLock);
+    NetEvent e;
+    while (board.netEvents.pop(e)) {
+      if (e.type == NET_PRESS) {
+        uint32_t dueUs = (uint32_t)(e.timeUs + HOLD_US);
+        int32_t late = (int32_t)(e.recordUs - dueUs);
+        result.lateUs.record(late > 0 ? (uint32_t)late : 0);
+        result.recorded++;
+        renderPressFrame(frame, hub.nextId(), e, 0);
+        hub.broadcast(frame);
+      } else if (e.type == NET_ROUND_END) {
+        result.rounds++;
+        Command c = {CMD_START, 0};
+        commands.push(c);
+      }
+    }
+    for (HalStreamClient& c : clients) {
+      result.sseBytes += c.inFlight;
+      c.ack(c.inFlight);
+    }
+  }
+
+  // One /api/status-sized request: render the round under the server
+  // lock for requestUs.
+  void serveRequest() {
+    std::lock_guard<std::mutex> lock(serverLock);
+    Clock::time_point end = Clock::now() + std::chrono::microseconds(opt.requestUs);
+    do {
+      status.clear();
+      char buf[64];
+      for (int i = 0; i < STATIONS; i++) {
+        snprintf(buf, sizeof(buf), "{\"team\":%d,\"place\":%d,\"us\":%llu},", i, i, (unsigned long long)wallUs());
+        status += buf;
+      }
+    } while (Clock::now() < end);
+    result.requests++;
+  }
+};
+
+bool makeRealtime(std::thread& t, int priority)
+{
+  sched_param sp = {};
+  sp.sched_priority = priority;
+  return pthread_setschedparam(t.native_handle(), SCHED_FIFO, &sp) == 0;
+}
+
+bool pin(std::thread& t, int cpu)
+{
+  if (sysconf(_SC_NPROCESSORS_ONLN) < 2) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+}
+
+Result run(const Phase& p)
+{
+  Rig* rig = new Rig(opt.clients);
+  simClockSetUs(wallUs());
+  rig->board.command(CMD_SET_DURATION, ROUND_MS);
+  Command start = {CMD_START, 0};
+  rig->commands.push(start);
+  uint64_t stopUs = wallUs() + (uint64_t)(opt.seconds * 1e6);
+  std::atomic<bool> stop(false);
+
+  if (p.split) {
+    std::thread arbiter([&]() {
+      while (!stop.load(std::memory_order_relaxed)) sleepUntilUs(rig->arbiterStep());
+    });
+    std::thread net([&]() {
+      while (!stop.load(std::memory_order_relaxed)) {
+        rig->netStep();
+        if (p.load) rig->serveRequest();
+        else sleepUntilUs(wallUs() + 2000);
+      }
+    });
+    rig->result.realtime = makeRealtime(arbiter, 10);
+    rig->result.pinned = pin(arbiter, 1) && pin(net, 0);
+    while (wallUs() < stopUs) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    stop.store(true);
+    arbiter.join();
+    net.join();
+  } else {
+    while (wallUs() < stopUs) {
+      rig->arbiterStep();
+      rig->netStep();
+      if (p.load) rig->serveRequest();
+    }
+  }
+
+  Result r = rig->result;
+  r.scheduled = rig->scheduled;
+  r.pressQueueDropped = rig->board.pressEvents.dropped();
+  r.netQueueDropped = rig->board.netEvents.dropped();
+  r.commandQueueDropped = rig->commands.dropped();
+  delete rig;
+  return r;
+}
+
+void printHistogram(const char* name, const LatencyHistogram& h)
+{
+  printf("\"%s\":{\"count\":%u,\"p50\":%u,\"p90\":%u,\"p99\":%u,\"max\":%u}",
+         name, h.count(), h.percentile(50), h.percentile(90), h.percentile(99), h.max());
+}
+
+int main(int argc, char** argv)
+{
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--seconds") == 0) opt.seconds = atof(argv[i + 1]);
+    else if (strcmp(argv[i], "--requestUs") == 0) opt.requestUs = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+    else if (strcmp(argv[i], "--clients") == 0) opt.clients = atoi(argv[i + 1]);
+    else {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 2;
+    }
+  }
+  epoch = Clock::now();
+
+  const Phase PHASES[] = {
+    {"split-idle", true, false},
+    {"split-load", true, true},
+    {"loop-load", false, true},
+  };
+  Result results[3];
+  for (int k = 0; k < 3; k++) {
+    const Phase& p = PHASES[k];
+    Result& r = results[k] = run(p);
+    printf("{\"phase\":\"%s\",\"seconds\":%g,\"requestUs\":%u,\"clients\":%d,\"cpus\":%ld,"
+           "\"realtime\":%s,\"pinned\":%s,\"rounds\":%u,\"pressesScheduled\":%u,\"pressesRecorded\":%u,"
+           "\"requests\":%u,\"sseBytes\":%llu,\"pressQueueDropped\":%u,\"netQueueDropped\":%u,"
+           "\"commandQueueDropped\":%u,",
+           p.name, opt.seconds, opt.requestUs, opt.clients, sysconf(_SC_NPROCESSORS_ONLN),
+           r.realtime ? "true" : "false", r.pinned ? "true" : "false", r.rounds, r.scheduled, r.recorded,
+           r.requests, (unsigned long long)r.sseBytes, r.pressQueueDropped, r.netQueueDropped,
+           r.commandQueueDropped);
+    printHistogram("arbitrationLateUs", r.lateUs);
+    printf("}\n");
+  }
+  uint32_t idle = results[0].lateUs.percentile(99), loaded = results[1].lateUs.percentile(99);
+  bool flat = loaded <= idle + FLAT_US;
+  printf("{\"summary\":\"split-load vs split-idle\",\"idleP99Us\":%u,\"loadP99Us\":%u,\"loopP99Us\":%u,"
+         "\"flatWithinUs\":%u,\"flat\":%s}\n",
+         idle, loaded, results[2].lateUs.percentile(99), FLAT_US, flat ? "true" : "false");
+  return flat ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+// ClockSync offset filter: exchanges against a simulated coordinator clock
+// with a fixed offset, drift and one-sided WiFi queueing delay. The mapped
+// time must stay within the reported error bound, the drift fit must find
+// the drift, and each window contributes one anchor.
+#include <unity.h>
+#include <stdlib.h>
+#include "ClockSync.h"
+
+void setUp() {}
+void tearDown() {}
+
+// The coordinator's clock as a function of the node's.
+struct RemoteClock {
+  int64_t offsetUs;
+  double driftPpm;
+  int64_t at(int64_t localUs) const { return localUs + offsetUs + (int64_t)(localUs * driftPpm / 1e6); }
+};
+
+static uint32_t rng = 1;
+static uint32_t nextRandom() {
+  rng = rng * 1664525u + 1013904223u;
+  return rng >> 8;
+}
+
+// One exchange starting at localUs with the given one-way delays; the
+// coordinator takes 40 µs to answer, which is not part of the RTT.
+static void exchange(ClockSync& c, const RemoteClock& r, int64_t localUs, int64_t upUs, int64_t downUs) {
+  int64_t t1 = localUs;
+  int64_t t2 = r.at(localUs + upUs);
+  int64_t t3 = r.at(localUs + upUs + 40);
+  int64_t t4 = localUs + upUs + 40 + downUs;
+  c.addSample(t1, t2, t3, t4);
+}
+
+// 1 ms each way plus up to 8 ms of queueing on either leg.
+static int64_t jitteredExchanges(ClockSync& c, const RemoteClock& r, int64_t localUs, int n) {
+  for (int k = 0; k < n; k++, localUs += 250000) {
+    exchange(c, r, localUs, 1000 + nextRandom() % 8000, 1000 + nextRandom() % 8000);
+  }
+  return localUs;
+}
+
+// The exchange sums against a known offset: exact when the legs are equal,
+// off by at most the bound however unequal they are, including an odd
+// round trip whose halving rounds away from the true offset.
+void test_exchange_bound_covers_the_true_offset() {
+  const int64_t offsets[] = {0, 5, -5, 123456789, -3000001};
+  const int64_t legs[][2] = {{1000, 1000}, {4000, 4000}, {9000, 1000}, {1000, 9000},
+                             {3, 0}, {0, 3}, {0, 0}, {12345, 0}, {0, 12345}, {1, 2}};
+  for (int64_t theta : offsets) {
+    for (const int64_t* leg : legs) {
+      int64_t t1 = 7000000;
+      int64_t t2 = t1 + leg[0] + theta;
+      int64_t t3 = t2 + 40;  // the server's turnaround is not part of the RTT
+      int64_t t4 = t3 - theta + leg[1];
+      TimeExchange x = timeExchange(t1, t2, t3, t4);
+      TEST_ASSERT_TRUE(x.valid());
+      TEST_ASSERT_EQUAL_INT64(leg[0] + leg[1], x.rttUs);
+      int64_t err = x.offsetUs - theta;
+      if (err < 0) err = -err;
+      TEST_ASSERT_TRUE(err <= x.errorBoundUs);
+      if (leg[0] == leg[1]) TEST_ASSERT_EQUAL_INT64(theta, x.offsetUs);
+    }
+  }
+  // All of the delay on one leg is the worst case: the bound is tight.
+  TimeExchange x = timeExchange(0, 10000, 10000, 10000);
+  TEST_ASSERT_EQUAL_INT64(10000, x.rttUs);
+  TEST_ASSERT_EQUAL_INT64(5000, x.errorBoundUs);
+  TEST_ASSERT_EQUAL_INT64(5000, x.offsetUs);
+  TEST_ASSERT_FALSE(timeExchange(1000, 500000, 500000, 900).valid());
+}
+
+// Within a window the lowest-RTT exchange is the one kept, not the latest
+// or the one closest to the window's average.
+void test_lowest_rtt_exchange_is_kept() {
+  ClockSync c;
+  RemoteClock r = {-777777, 0};
+  const int64_t legs[ClockSync::WINDOW][2] = {{3000, 9000}, {5000, 500}, {800, 900}, {7000, 7000},
+                                              {400, 2100}, {2000, 2000}, {6000, 100}, {1500, 1500}};
+  for (int k = 0; k < ClockSync::WINDOW; k++) exchange(c, r, 1000000 + k * 250000, legs[k][0], legs[k][1]);
+  TEST_ASSERT_EQUAL_UINT32(1700, c.rttUs());
+  TimeExchange fastest = timeExchange(1500000, r.at(1500800), r.at(1500840), 1501740);
+  TEST_ASSERT_EQUAL_INT64(fastest.offsetUs, c.offsetUs());
+  int64_t err = c.toRemote(1501000) - r.at(1501000);
+  if (err < 0) err = -err;
+  TEST_ASSERT_TRUE(err <= fastest.errorBoundUs);
+}
+
+void test_first_exchange_is_anchored_once() {
+  ClockSync c;
+  RemoteClock r = {5000000, 0};
+  exchange(c, r, 1000000, 500, 500);  // fastest of its window
+  TEST_ASSERT_TRUE(c.synced());
+  TEST_ASSERT_EQUAL(1, c.anchors());
+  for (int k = 1; k < ClockSync::WINDOW; k++) exchange(c, r, 1000000 + k * 250000, 3000, 3000);
+  TEST_ASSERT_EQUAL(1, c.anchors());
+  TEST_ASSERT_EQUAL_UINT32(1000, c.rttUs());
+  for (int k = 0; k < ClockSync::WINDOW; k++) exchange(c, r, 3000000 + k * 250000, 3000, 3000);
+  TEST_ASSERT_EQUAL(2, c.anchors());
+}
+
+void test_faster_exchange_is_adopted_before_the_window_ends() {
+  ClockSync c;
+  RemoteClock r = {-20000, 0};
+  exchange(c, r, 0, 4000, 4000);
+  TEST_ASSERT_EQUAL_UINT32(8000, c.rttUs());
+  exchange(c, r, 250000, 600, 700);
+  TEST_ASSERT_EQUAL_UINT32(1300, c.rttUs());
+  TEST_ASSERT_EQUAL(1, c.anchors());
+}
+
+void test_impossible_exchange_is_ignored() {
+  ClockSync c;
+  c.addSample(1000, 500000, 500000, 900);  // t4 before t1
+  TEST_ASSERT_FALSE(c.synced());
+  TEST_ASSERT_EQUAL_UINT32(0, c.samples());
+}
+
+void test_offset_stays_within_the_error_bound_under_jitter() {
+  ClockSync c;
+  RemoteClock r = {123456789, 0};
+  rng = 7;
+  int64_t local = 2000000;
+  for (int k = 0; k < 200; k++) {
+    local = jitteredExchanges(c, r, local, 1);
+    int64_t err = c.toRemote(local) - r.at(local);
+    if (err < 0) err = -err;
+    TEST_ASSERT_TRUE(err <= (int64_t)c.errorBoundUs(local));
+  }
+  // Queueing only ever adds delay, so the best exchanges are nearly symmetric.
+  int64_t err = c.toRemote(local) - r.at(local);
+  TEST_ASSERT_TRUE(err < 1000 && err > -1000);
+}
+
+void test_drift_is_fitted_and_extrapolated() {
+  ClockSync c;
+  RemoteClock r = {-3000000, 40.0};
+  rng = 11;
+  int64_t local = 1000000;
+  local = jitteredExchanges(c, r, local, ClockSync::WINDOW * ClockSync::ANCHORS * 2);
+  TEST_ASSERT_EQUAL(ClockSync::ANCHORS, c.anchors());
+  TEST_ASSERT_FLOAT_WITHIN(5.0f, 40.0f, c.driftPpm());
+  // A press two seconds after the last exchange is still mapped within the bound.
+  int64_t press = local + 2000000;
+  int64_t err = c.toRemote(press) - r.at(press);
+  if (err < 0) err = -err;
+  TEST_ASSERT_TRUE(err <= (int64_t)c.errorBoundUs(press));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_exchange_bound_covers_the_true_offset);
+  RUN_TEST(test_lowest_rtt_exchange_is_kept);
+  RUN_TEST(test_first_exchange_is_anchored_once);
+  RUN_TEST(test_faster_exchange_is_adopted_before_the_window_ends);
+  RUN_TEST(test_impossible_exchange_is_ignored);
+  RUN_TEST(test_offset_stays_within_the_error_bound_under_jitter);
+  RUN_TEST(test_drift_is_fitted_and_extrapolated);
+  return UNITY_END();
+}
@@ -0,0 +1,262 @@
+// A coordinator and three nodes on the simulated network (ClusterUdp.h):
+// presses reach the coordinator exactly once under datagram loss, are
+// acknowledged only when the coordinator took them, and keep arriving
+// after a node or the coordinator reboots; round starts and places reach
+// the nodes exactly once and in order.
+#include <unity.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ClusterLink.h"
+
+static const int NODES = 3;
+static const uint32_t COORDINATOR_IP = 1;  // bound first
+
+struct Press {
+  uint8_t board;
+  uint8_t station;
+  int64_t timeUs;
+  uint32_t errorUs;
+};
+
+struct Cluster {
+  std::unique_ptr<ClusterLink> coord;
+  std::unique_ptr<ClusterLink> nodes[NODES + 1];  // by board id, 0 unused
+  std::vector<Press> presses;
+  int refuse = 0;  // refuse this many presses first, as a full queue would
+  int offered = 0;
+  std::string applied[NODES + 1];  // ROUND/PLACE as each node applied them
+  int refuseControl = 0;
+
+  void bootCoordinator() {
+    coord.reset(new ClusterLink());
+    coord->onPress([this](uint8_t board, uint8_t station, int64_t timeUs, uint32_t errorUs, bool) {
+      offered++;
+      if (refuse > 0) {
+        refuse--;
+        return false;
+      }
+      presses.push_back({board, station, timeUs, errorUs});
+      return true;
+    });
+    coord->begin(ClusterLink::COORDINATOR, 0, 0);
+  }
+
+  void bootNode(int board) {
+    nodes[board].reset(new ClusterLink());
+    std::string& log = applied[board];
+    nodes[board]->onRound([this, &log](uint8_t action, uint32_t durationMs) {
+      if (refuseControl > 0 && refuseControl--) return false;
+      const char* names[] = {"start", "reset", "end"};
+      log += std::string(names[action]) + (action == CLUSTER_ROUND_START ? std::to_string(durationMs) : "") + " ";
+      return true;
+    });
+    nodes[board]->onPlace([this, &log](uint8_t station, uint8_t place) {
+      if (refuseControl > 0 && refuseControl--) return false;
+      log += "s" + std::to_string(station) + "=" + std::to_string(place) + " ";
+      return true;
+    });
+    nodes[board]->begin(ClusterLink::NODE, (uint8_t)board, COORDINATOR_IP);
+  }
+
+  void run(unsigned long ms) {
+    for (unsigned long k = 0; k < ms; k++) {
+      simClockAdvanceUs(1000);
+      coord->poll(halMillis());
+      for (int b = 1; b <= NODES; b++) nodes[b]->poll(halMillis());
+    }
+  }
+
+  int count(uint8_t board, uint8_t station) const {
+    int n = 0;
+    for (const Press& p : presses) n += (p.board == board && p.station == station) ? 1 : 0;
+    return n;
+  }
+};
+
+static uint32_t rng;
+static bool lose30(const SimUdpNet::Datagram&) {
+  rng = rng * 1664525u + 1013904223u;
+  return (rng >> 8) % 100 < 30;
+}
+
+static void boot(Cluster& c) {
+  c.bootCoordinator();
+  for (int b = 1; b <= NODES; b++) c.bootNode(b);
+  c.run(1000);  // a few sync exchanges
+  for (int b = 1; b <= NODES; b++) TEST_ASSERT_TRUE(c.nodes[b]->clock().synced());
+}
+
+void setUp() {
+  simClockSetUs(1000000);
+  SimUdpNet::instance().reset();
+  rng = 12345;
+}
+void tearDown() {}
+
+void test_presses_arrive_once_despite_loss() {
+  Cluster c;
+  SimUdpNet::instance().drop = lose30;
+  boot(c);
+  for (int k = 0; k < 5; k++) {
+    for (int b = 1; b <= NODES; b++) c.nodes[b]->sendPress((uint8_t)k, (int64_t)halMicros(), false);
+    c.run(7);
+  }
+  c.run(500);
+  TEST_ASSERT_TRUE(SimUdpNet::instance().lost > 0);
+  TEST_ASSERT_EQUAL_size_t(5 * NODES, c.presses.size());
+  for (int b = 1; b <= NODES; b++) {
+    for (int k = 0; k < 5; k++) TEST_ASSERT_EQUAL(1, c.count((uint8_t)b, (uint8_t)k));
+    TEST_ASSERT_EQUAL(0, c.nodes[b]->pending());
+    TEST_ASSERT_EQUAL_UINT32(5, c.coord->peer(b).presses);
+  }
+}
+
+void test_press_times_are_within_their_error_bound() {
+  Cluster c;
+  SimUdpNet::instance().latencyUs = 3000;
+  boot(c);
+  int64_t pressedUs = (int64_t)halMicros() - 2500;  // stamped by the ISR a little earlier
+  c.nodes[2]->sendPress(4, pressedUs, false);
+  c.run(50);
+  TEST_ASSERT_EQUAL_size_t(1, c.presses.size());
+  // Every board runs on the one virtual clock, so the true offset is 0.
+  int64_t err = c.presses[0].timeUs - pressedUs;
+  if (err < 0) err = -err;
+  TEST_ASSERT_TRUE(err <= (int64_t)c.presses[0].errorUs);
+}
+
+void test_refused_press_is_not_acknowledged_and_comes_again() {
+  Cluster c;
+  boot(c);
+  c.refuse = 3;
+  c.nodes[1]->sendPress(7, (int64_t)halMicros(), false);
+  c.run(5);
+  TEST_ASSERT_EQUAL_size_t(0, c.presses.size());
+  TEST_ASSERT_EQUAL(1, c.nodes[1]->pending());
+  c.run(200);
+  TEST_ASSERT_EQUAL(4, c.offered);
+  TEST_ASSERT_EQUAL_size_t(1, c.presses.size());
+  TEST_ASSERT_EQUAL(0, c.nodes[1]->pending());
+}
+
+// A rebooted node numbers its presses from 1 again; they are new presses,
+// not retransmits of the old ones.
+void test_rebooted_node_presses_are_not_duplicates() {
+  Cluster c;
+  boot(c);
+  for (int k = 0; k < 3; k++) c.nodes[1]->sendPress((uint8_t)k, (int64_t)halMicros(), false);
+  c.run(100);
+  TEST_ASSERT_EQUAL_size_t(3, c.presses.size());
+  uint32_t oldEpoch = c.nodes[1]->epoch();
+
+  SimUdpNet::instance().rebind(2);  // board 1 was bound second
+  c.bootNode(1);
+  TEST_ASSERT_TRUE(c.nodes[1]->epoch() != oldEpoch);
+  c.run(1000);
+  for (int k = 0; k < 3; k++) c.nodes[1]->sendPress((uint8_t)k, (int64_t)halMicros(), false);
+  c.run(100);
+  TEST_ASSERT_EQUAL_size_t(6, c.presses.size());
+  TEST_ASSERT_EQUAL(0, c.nodes[1]->pending());
+  TEST_ASSERT_EQUAL_UINT32(1, c.coord->peer(1).restarts);
+  TEST_ASSERT_EQUAL_UINT32(0, c.coord->peer(2).restarts);
+}
+
+// A rebooted coordinator has a new clock; nodes start their estimate over
+// and their presses still get through.
+void test_coordinator_reboot_restarts_node_clocks() {
+  Cluster c;
+  boot(c);
+  uint32_t before = c.nodes[3]->clock().samples();
+  TEST_ASSERT_TRUE(before >= 3);
+  SimUdpNet::instance().rebind(COORDINATOR_IP);
+  c.bootCoordinator();
+  c.run(300);
+  TEST_ASSERT_TRUE(c.nodes[3]->clock().samples() < before);
+  TEST_ASSERT_TRUE(c.nodes[3]->clock().synced());
+  c.nodes[3]->sendPress(1, (int64_t)halMicros(), false);
+  c.run(50);
+  TEST_ASSERT_EQUAL_size_t(1, c.presses.size());
+  TEST_ASSERT_EQUAL(3, c.presses[0].board);
+}
+
+static int roundDatagramsToLose;
+static bool loseFirstRounds(const SimUdpNet::Datagram& d) {
+  if (d.data[0] != CLUSTER_ROUND || roundDatagramsToLose == 0) return false;
+  roundDatagramsToLose--;
+  return true;
+}
+
+void test_round_and_places_arrive_once_and_in_order_despite_loss() {
+  Cluster c;
+  SimUdpNet::instance().drop = lose30;
+  boot(c);
+  c.coord->sendRound(CLUSTER_ROUND_START, 15000);
+  c.coord->sendPlace(1, 2, 0);
+  c.coord->sendPlace(3, 0, 1);
+  c.coord->sendPlace(1, 5, 2);
+  c.run(5);
+  c.coord->sendRound(CLUSTER_ROUND_END, 0);
+  c.run(500);
+  TEST_ASSERT_EQUAL_STRING("start15000 s2=0 s5=2 end ", c.applied[1].c_str());
+  TEST_ASSERT_EQUAL_STRING("start15000 end ", c.applied[2].c_str());
+  TEST_ASSERT_EQUAL_STRING("start15000 s0=1 end ", c.applied[3].c_str());
+  for (int b = 1; b <= NODES; b++) TEST_ASSERT_EQUAL(0, c.coord->peer(b).controlCount);
+}
+
+// The place overtakes the lost round start on the wire, but is applied
+// after it.
+void test_place_waits_for_a_lost_round_start() {
+  Cluster c;
+  boot(c);
+  SimUdpNet::instance().drop = loseFirstRounds;
+  roundDatagramsToLose = NODES;
+  c.coord->sendRound(CLUSTER_ROUND_START, 10000);
+  c.coord->sendPlace(2, 1, 0);
+  c.run(100);
+  TEST_ASSERT_EQUAL(0, roundDatagramsToLose);
+  TEST_ASSERT_EQUAL_STRING("start10000 s1=0 ", c.applied[2].c_str());
+}
+
+void test_refused_round_command_comes_again() {
+  Cluster c;
+  boot(c);
+  c.refuseControl = 2;
+  c.coord->sendRound(CLUSTER_ROUND_RESET, 0);
+  c.run(100);
+  for (int b = 1; b <= NODES; b++) TEST_ASSERT_EQUAL_STRING("reset ", c.applied[b].c_str());
+}
+
+static bool loseToBoard3(const SimUdpNet::Datagram& d) { return d.toIp == 4; }
+
+// A node that is unreachable for longer than MAX_CONTROL messages misses
+// the oldest ones and is told to skip them instead of waiting forever.
+void test_node_behind_the_queue_skips_what_was_given_up() {
+  Cluster c;
+  boot(c);
+  SimUdpNet::instance().drop = loseToBoard3;
+  const int N = ClusterLink::MAX_CONTROL + 4;
+  for (int k = 0; k < N; k++) c.coord->sendPlace(3, (uint8_t)(k % 10), (uint8_t)k);
+  c.run(100);
+  TEST_ASSERT_EQUAL_UINT32(4, c.coord->peer(3).controlDropped);
+  SimUdpNet::instance().drop = nullptr;
+  c.run(100);
+  std::string expected;
+  for (int k = 4; k < N; k++) expected += "s" + std::to_string(k % 10) + "=" + std::to_string(k) + " ";
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), c.applied[3].c_str());
+  TEST_ASSERT_EQUAL(0, c.coord->peer(3).controlCount);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_presses_arrive_once_despite_loss);
+  RUN_TEST(test_press_times_are_within_their_error_bound);
+  RUN_TEST(test_refused_press_is_not_acknowledged_and_comes_again);
+  RUN_TEST(test_rebooted_node_presses_are_not_duplicates);
+  RUN_TEST(test_coordinator_reboot_restarts_node_clocks);
+  RUN_TEST(test_round_and_places_arrive_once_and_in_order_despite_loss);
+  RUN_TEST(test_place_waits_for_a_lost_round_start);
+  RUN_TEST(test_refused_round_command_comes_again);
+  RUN_TEST(test_node_behind_the_queue_skips_what_was_given_up);
+  return UNITY_END();
+}
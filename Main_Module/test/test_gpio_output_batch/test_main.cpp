@@ -0,0 +1,74 @@
+// GpioOutputBatch on the register model: each frame is one W1TS and one
+// W1TC store per bank that has outputs, with exactly the LEDs' pin bits,
+// and banks without outputs are never written.
+#include <unity.h>
+#include "GpioOutputBatch.h"
+#include "SimBoard.h"
+
+static SimGpioRegs regs;
+
+void setUp() { regs = SimGpioRegs(); }
+void tearDown() {}
+
+// Pin mask of the LEDs set in frame.
+template <int N>
+static uint32_t pinMask(const int (&pins)[N], uint32_t frame, int bank) {
+  uint32_t m = 0;
+  for (int i = 0; i < N; i++) {
+    if ((frame >> i & 1) && (pins[i] >= 32) == (bank == 1)) m |= 1u << (pins[i] & 31);
+  }
+  return m;
+}
+
+// Apply one frame and check that its stores carry exactly its bits.
+template <int N>
+static void check(GpioOutputBatch<SimGpioRegs, N>& batch, const int (&pins)[N], uint32_t frame) {
+  const uint32_t all = (1u << N) - 1;
+  regs.bankStores[0] = regs.bankStores[1] = 0;
+  regs.lastSet[0] = regs.lastSet[1] = regs.lastClear[0] = regs.lastClear[1] = 0;
+  batch.apply(frame);
+  for (int b = 0; b < 2; b++) {
+    uint32_t on = pinMask(pins, frame, b), off = pinMask(pins, all & ~frame, b);
+    TEST_ASSERT_EQUAL_HEX32(on, regs.lastSet[b]);
+    TEST_ASSERT_EQUAL_HEX32(off, regs.lastClear[b]);
+    TEST_ASSERT_EQUAL_UINT32((on ? 1 : 0) + (off ? 1 : 0), regs.bankStores[b]);
+    TEST_ASSERT_TRUE(regs.bankStores[b] <= 2);
+    TEST_ASSERT_EQUAL_HEX32(on, regs.out[b] & (on | off));
+  }
+}
+
+void test_board_pins_are_one_bank() {
+  GpioOutputBatch<SimGpioRegs, 10> batch(regs, SIM_LED_PINS);
+  uint32_t frames[] = {0x001, 0x3FF, 0x2A5, 0x15A, 0x000, 0x200};
+  for (uint32_t f : frames) check(batch, SIM_LED_PINS, f);
+  TEST_ASSERT_EQUAL_UINT32(0, regs.out[1]);
+  // Every frame but the all-on and all-off ones takes both stores.
+  TEST_ASSERT_EQUAL_UINT32(2 + 1 + 2 + 2 + 1 + 2, regs.stores);
+}
+
+// Pins 32 and 33 are in bank 1; frames split across both banks.
+void test_frames_across_both_banks() {
+  static const int PINS[4] = {12, 32, 33, 2};
+  GpioOutputBatch<SimGpioRegs, 4> batch(regs, PINS);
+  uint32_t frames[] = {0x6, 0x9, 0xF, 0x0, 0x2};
+  for (uint32_t f : frames) check(batch, PINS, f);
+  TEST_ASSERT_EQUAL_HEX32(1u << 0, regs.out[1]);
+  TEST_ASSERT_EQUAL_HEX32(0, regs.out[0] & ((1u << 12) | (1u << 2)));
+}
+
+// Other pins in a bank keep their level: only the batch's bits are stored.
+void test_other_pins_are_untouched() {
+  regs.out[0] = (1u << 21) | (1u << 22);
+  GpioOutputBatch<SimGpioRegs, 10> batch(regs, SIM_LED_PINS);
+  batch.apply(0x3FF);
+  batch.apply(0);
+  TEST_ASSERT_EQUAL_HEX32((1u << 21) | (1u << 22), regs.out[0]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_board_pins_are_one_bank);
+  RUN_TEST(test_frames_across_both_banks);
+  RUN_TEST(test_other_pins_are_untouched);
+  return UNITY_END();
+}
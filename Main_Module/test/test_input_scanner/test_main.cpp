@@ -0,0 +1,153 @@
+// InputScanner, the integrating debouncer: settled presses and releases
+// stamped with their first edge, per-pin settle times (the input-only pins
+// 34/35/36/39 with external pull-ups settle faster than the ones on
+// internal pull-ups), and the bounce and glitch counters.
+#include <unity.h>
+#include <vector>
+#include "InputScanner.h"
+#include "SimBoard.h"
+
+struct Sink {
+  std::vector<PressEvent> events;
+  bool push(const PressEvent& e) {
+    events.push_back(e);
+    return true;
+  }
+};
+
+static InputScanner<10> scanner;
+static Sink sink;
+
+void setUp() {
+  scanner = InputScanner<10>();
+  sink.events.clear();
+}
+void tearDown() {}
+
+// Timer scans every stepUs from fromUs (exclusive) to toUs (inclusive)
+// with the pins in `down` held.
+static void hold(uint32_t down, uint64_t fromUs, uint64_t toUs, uint32_t stepUs = 250) {
+  for (uint64_t t = fromUs + stepUs; t <= toUs; t += stepUs) scanner.scan(down, 0, t, sink);
+}
+
+void test_clean_press_and_release() {
+  scanner.scan(1u << 2, 1u << 2, 10000, sink);  // pin interrupt
+  hold(1u << 2, 10000, 10000 + DEBOUNCE_US - 250);
+  TEST_ASSERT_EQUAL_size_t(0, sink.events.size());
+  hold(1u << 2, 10000 + DEBOUNCE_US - 250, 10000 + DEBOUNCE_US);
+  TEST_ASSERT_EQUAL_size_t(1, sink.events.size());
+  TEST_ASSERT_EQUAL_UINT64(10000, sink.events[0].timeUs);
+  TEST_ASSERT_EQUAL(2, sink.events[0].index);
+  TEST_ASSERT_EQUAL(LOW, sink.events[0].level);
+  TEST_ASSERT_EQUAL(0, sink.events[0].tie);
+  TEST_ASSERT_EQUAL_HEX32(1u << 2, scanner.downMask());
+  TEST_ASSERT_EQUAL(10, (int)scanner.downSinceMs(2));
+
+  scanner.scan(0, 1u << 2, 200000, sink);
+  hold(0, 200000, 200000 + DEBOUNCE_US);
+  TEST_ASSERT_EQUAL_size_t(2, sink.events.size());
+  TEST_ASSERT_EQUAL_UINT64(200000, sink.events[1].timeUs);
+  TEST_ASSERT_EQUAL(HIGH, sink.events[1].level);
+  TEST_ASSERT_EQUAL_HEX32(0, scanner.downMask());
+  TEST_ASSERT_EQUAL_UINT32(1, scanner.stats(2).presses);
+  TEST_ASSERT_EQUAL_UINT32(1, scanner.stats(2).releases);
+  TEST_ASSERT_EQUAL_UINT32(0, scanner.stats(2).bounces);
+  TEST_ASSERT_EQUAL_UINT32(0, scanner.stats(2).glitches);
+}
+
+// SimBoard sets the device's settle times: stations 0..3 sit on the
+// input-only pins with external pull-ups.
+void test_settle_time_per_pin() {
+  SimBoard<10> board;
+  for (int i = 0; i < 10; i++) {
+    uint32_t expected = SIM_SWITCH_PINS[i] >= 34 ? DEBOUNCE_US_EXT_PULLUP : DEBOUNCE_US;
+    TEST_ASSERT_EQUAL_UINT32(expected, board.inputScanner.settleUs(i));
+  }
+  TEST_ASSERT_TRUE(DEBOUNCE_US_EXT_PULLUP < DEBOUNCE_US);
+
+  scanner.setSettleUs(0, DEBOUNCE_US_EXT_PULLUP);
+  uint32_t both = (1u << 0) | (1u << 4);
+  scanner.scan(both, both, 50000, sink);
+  hold(both, 50000, 50000 + DEBOUNCE_US_EXT_PULLUP);
+  TEST_ASSERT_EQUAL_size_t(1, sink.events.size());
+  TEST_ASSERT_EQUAL(0, sink.events[0].index);
+  hold(both, 50000 + DEBOUNCE_US_EXT_PULLUP, 50000 + DEBOUNCE_US);
+  TEST_ASSERT_EQUAL_size_t(2, sink.events.size());
+  TEST_ASSERT_EQUAL(4, sink.events[1].index);
+  // Same first snapshot: both are flagged as a tie, with the same stamp.
+  TEST_ASSERT_EQUAL_UINT64(50000, sink.events[1].timeUs);
+  TEST_ASSERT_EQUAL(1, sink.events[0].tie);
+  TEST_ASSERT_EQUAL(1, sink.events[1].tie);
+}
+
+// Contact bounce costs settle time but keeps the first edge's stamp.
+void test_bouncy_press_keeps_its_first_edge() {
+  const uint32_t pin = 1u << 5;
+  scanner.scan(pin, pin, 1000, sink);
+  scanner.scan(0, pin, 1300, sink);    // bounces up for 300 µs
+  scanner.scan(pin, pin, 1600, sink);  // and down again
+  scanner.scan(0, pin, 1700, sink);    // once more, 100 µs
+  scanner.scan(pin, pin, 1800, sink);
+  // The 400 µs back up are lost and cancel 400 µs down: settled only a
+  // full settle time after the last bounce.
+  hold(pin, 1800, 1800 + DEBOUNCE_US - 100, 100);
+  TEST_ASSERT_EQUAL_size_t(0, sink.events.size());
+  hold(pin, 1800 + DEBOUNCE_US - 100, 1800 + DEBOUNCE_US, 100);
+  TEST_ASSERT_EQUAL_size_t(1, sink.events.size());
+  TEST_ASSERT_EQUAL_UINT64(1000, sink.events[0].timeUs);
+  TEST_ASSERT_EQUAL_UINT32(4, scanner.stats(5).bounces);
+  TEST_ASSERT_EQUAL_UINT32(0, scanner.stats(5).glitches);
+  TEST_ASSERT_EQUAL_UINT32(1, scanner.stats(5).presses);
+}
+
+// A spike that falls back and stays back for the settle time is dropped.
+void test_glitch_is_dropped_and_counted() {
+  const uint32_t pin = 1u << 7;
+  scanner.scan(pin, pin, 5000, sink);
+  scanner.scan(0, pin, 5200, sink);
+  hold(0, 5200, 5200 + DEBOUNCE_US - 250);
+  TEST_ASSERT_EQUAL_UINT32(0, scanner.stats(7).glitches);
+  hold(0, 5200 + DEBOUNCE_US - 250, 5200 + DEBOUNCE_US + 250);
+  TEST_ASSERT_EQUAL_size_t(0, sink.events.size());
+  TEST_ASSERT_EQUAL_UINT32(1, scanner.stats(7).glitches);
+  TEST_ASSERT_EQUAL_UINT32(1, scanner.stats(7).bounces);
+  TEST_ASSERT_EQUAL_HEX32(0, scanner.downMask());
+
+  // The next real press starts a fresh transition.
+  scanner.scan(pin, pin, 100000, sink);
+  hold(pin, 100000, 100000 + DEBOUNCE_US);
+  TEST_ASSERT_EQUAL_size_t(1, sink.events.size());
+  TEST_ASSERT_EQUAL_UINT64(100000, sink.events[0].timeUs);
+}
+
+// The pin already bounced back by the time its ISR read the snapshot; the
+// edge still stamps the press.
+void test_press_already_bounced_back_when_read() {
+  const uint32_t pin = 1u << 1;
+  scanner.scan(0, pin, 7000, sink);
+  TEST_ASSERT_EQUAL_UINT32(1, scanner.stats(1).bounces);
+  scanner.scan(pin, pin, 7050, sink);
+  hold(pin, 7050, 7050 + DEBOUNCE_US);
+  TEST_ASSERT_EQUAL_size_t(1, sink.events.size());
+  TEST_ASSERT_EQUAL_UINT64(7000, sink.events[0].timeUs);
+  TEST_ASSERT_EQUAL(LOW, sink.events[0].level);
+}
+
+// A press seen only by the scan timer, with no interrupt, still settles.
+void test_scan_timer_alone_picks_up_a_press() {
+  hold(1u << 9, 0, 20000, 1000);
+  TEST_ASSERT_EQUAL_size_t(1, sink.events.size());
+  TEST_ASSERT_EQUAL_UINT64(1000, sink.events[0].timeUs);
+  TEST_ASSERT_EQUAL_UINT32(1, scanner.stats(9).presses);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_press_and_release);
+  RUN_TEST(test_settle_time_per_pin);
+  RUN_TEST(test_bouncy_press_keeps_its_first_edge);
+  RUN_TEST(test_glitch_is_dropped_and_counted);
+  RUN_TEST(test_press_already_bounced_back_when_read);
+  RUN_TEST(test_scan_timer_alone_picks_up_a_press);
+  return UNITY_END();
+}
@@ -0,0 +1,137 @@
+// LedPatternEngine with a hardware backend, on the SimLedOffload model:
+// offloaded LEDs leave the frame, patterns fall back to software when the
+// channels run out or a pattern does not fit them, the start flash stays
+// in software, stop() frees a channel, and an offloaded LED's level
+// follows the software timing to the millisecond.
+#include <unity.h>
+#include <stdio.h>
+#include "GameCues.h"
+#include "LedPatternEngine.h"
+
+typedef LedPatternEngine<10, SimLedOffload> Engine;
+
+static uint32_t lastFrame;
+static void record(uint32_t frame) { lastFrame = frame; }
+static void ignore(uint32_t) {}
+
+void setUp() { lastFrame = 0; }
+void tearDown() {}
+
+void test_channel_exhaustion_falls_back_to_software() {
+  SimLedOffload offload(2);
+  Engine leds(record, &offload);
+  const unsigned long t0 = 1000;
+  for (int i = 0; i < 3; i++) leds.play(i, &LED_FIRST, t0);
+  TEST_ASSERT_TRUE(leds.offloaded(0));
+  TEST_ASSERT_TRUE(leds.offloaded(1));
+  TEST_ASSERT_FALSE(leds.offloaded(2));
+  TEST_ASSERT_EQUAL(2, offload.busy);
+
+  // Only the software LED is in the frame and sets deadlines.
+  TEST_ASSERT_EQUAL_UINT32(t0 + FIRST_STEPS_MS[0], leds.update(t0));
+  TEST_ASSERT_EQUAL_HEX32(1u << 2, lastFrame);
+  leds.update(t0 + FIRST_STEPS_MS[0]);
+  TEST_ASSERT_EQUAL_HEX32(0, lastFrame);
+  TEST_ASSERT_TRUE(offload.level(0, t0));
+  TEST_ASSERT_FALSE(offload.level(0, t0 + FIRST_STEPS_MS[0]));
+}
+
+// Steady on has no steps, an odd step count cannot loop on the RMT and a
+// step longer than RMT_LED_MAX_STEP_MS does not fit its 15-bit durations;
+// all three play in software with channels free.
+void test_patterns_that_do_not_fit_stay_in_software() {
+  static const uint16_t ODD_MS[] = {100, 100, 100};
+  static const uint16_t LONG_MS[] = {(uint16_t)(RMT_LED_MAX_STEP_MS + 1), 100};
+  static const LedPattern ODD = {ODD_MS, 3};
+  static const LedPattern LONG = {LONG_MS, 2};
+  SimLedOffload offload(4);
+  Engine leds(record, &offload);
+  leds.play(0, &LED_STEADY, 0);
+  leds.play(1, &ODD, 0);
+  leds.play(2, &LONG, 0);
+  for (int i = 0; i < 3; i++) TEST_ASSERT_FALSE(leds.offloaded(i));
+  TEST_ASSERT_EQUAL(0, offload.busy);
+  leds.update(0);
+  TEST_ASSERT_EQUAL_HEX32(0x7, lastFrame);
+}
+
+// A pattern started during the start flash plays in software, where the
+// flash can hold it on; one started after the flash is offloaded.
+void test_start_flash_runs_in_software() {
+  SimLedOffload offload(8);
+  Engine leds(record, &offload);
+  const unsigned long t0 = 3000;
+  leds.flashAllUntil(t0 + START_FLASH_MS);
+  leds.play(4, &LED_SECOND, t0 + 50);
+  TEST_ASSERT_FALSE(leds.offloaded(4));
+  TEST_ASSERT_EQUAL(0, offload.starts);
+  leds.update(t0 + 50 + SECOND_STEPS_MS[0]);  // SECOND is off, the flash holds it on
+  TEST_ASSERT_EQUAL_HEX32(0x3FF, lastFrame);
+  leds.update(t0 + START_FLASH_MS);
+  TEST_ASSERT_EQUAL_HEX32(0, lastFrame);
+
+  leds.play(5, &LED_SECOND, t0 + START_FLASH_MS);
+  TEST_ASSERT_TRUE(leds.offloaded(5));
+  TEST_ASSERT_EQUAL(1, offload.starts);
+}
+
+void test_stop_frees_the_channel() {
+  SimLedOffload offload(1);
+  Engine leds(record, &offload);
+  leds.play(0, &LED_THIRD, 0);
+  leds.play(1, &LED_THIRD, 0);
+  TEST_ASSERT_TRUE(leds.offloaded(0));
+  TEST_ASSERT_FALSE(leds.offloaded(1));
+
+  leds.stop(0);
+  TEST_ASSERT_FALSE(leds.offloaded(0));
+  TEST_ASSERT_EQUAL(0, offload.busy);
+  TEST_ASSERT_EQUAL(1, offload.stops);
+  TEST_ASSERT_FALSE(offload.level(0, 10));
+  leds.play(2, &LED_FIRST, 100);
+  TEST_ASSERT_TRUE(leds.offloaded(2));
+
+  // Replaying an offloaded LED releases its channel first.
+  leds.play(2, &LED_SECOND, 200);
+  TEST_ASSERT_TRUE(leds.offloaded(2));
+  TEST_ASSERT_EQUAL(1, offload.busy);
+  TEST_ASSERT_EQUAL(2, offload.stops);
+  TEST_ASSERT_TRUE(offload.pattern[2] == &LED_SECOND);
+
+  leds.stopAll();
+  TEST_ASSERT_EQUAL(0, offload.busy);
+  leds.update(300);
+  TEST_ASSERT_EQUAL_HEX32(0, lastFrame);
+}
+
+// Each place pattern, offloaded and in software side by side, for three
+// seconds: the same level at every millisecond.
+void test_offloaded_level_matches_software_timing() {
+  for (int place = 0; place < 3; place++) {
+    SimLedOffload offload(1);
+    Engine hw(ignore, &offload);
+    LedPatternEngine<10> sw(ignore);
+    const unsigned long t0 = 1234;
+    hw.play(0, ledPatternForPlace(place), t0);
+    sw.play(0, ledPatternForPlace(place), t0);
+    TEST_ASSERT_TRUE(hw.offloaded(0));
+    for (unsigned long t = t0; t < t0 + 3000; t++) {
+      sw.update(t);
+      if (offload.level(0, t) != sw.level(0)) {
+        char msg[48];
+        snprintf(msg, sizeof(msg), "place %d at %lu ms", place, t - t0);
+        TEST_FAIL_MESSAGE(msg);
+      }
+    }
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_channel_exhaustion_falls_back_to_software);
+  RUN_TEST(test_patterns_that_do_not_fit_stay_in_software);
+  RUN_TEST(test_start_flash_runs_in_software);
+  RUN_TEST(test_stop_frees_the_channel);
+  RUN_TEST(test_offloaded_level_matches_software_timing);
+  return UNITY_END();
+}
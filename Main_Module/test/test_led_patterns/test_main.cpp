@@ -0,0 +1,148 @@
+// LedPatternEngine in software: frames change exactly at the FIRST, SECOND
+// and THIRD step boundaries, a late update() does not stretch a pattern,
+// the start flash holds every LED on over what is playing, and a busy loop
+// of updates writes the LEDs only when the frame changes.
+#include <unity.h>
+#include <set>
+#include <utility>
+#include <vector>
+#include "GameCues.h"
+#include "LedPatternEngine.h"
+
+typedef LedPatternEngine<10> Engine;
+
+static unsigned long nowMs;
+static std::vector<std::pair<unsigned long, uint32_t> > frames;  // (ms, frame) per write
+
+static void record(uint32_t frame) { frames.push_back(std::make_pair(nowMs, frame)); }
+
+void setUp() {
+  nowMs = 0;
+  frames.clear();
+}
+void tearDown() {}
+
+// Follow the engine's deadlines from `from` until `until`, as the arbiter
+// task does.
+static void runDeadlines(Engine& leds, unsigned long from, unsigned long until) {
+  nowMs = from;
+  unsigned long next = leds.update(nowMs);
+  while (next != 0 && next < until) {
+    nowMs = next;
+    next = leds.update(nowMs);
+  }
+}
+
+// Times at which LED `bit` changed level in the recorded writes.
+static std::vector<unsigned long> edges(int bit) {
+  std::vector<unsigned long> out;
+  uint32_t last = 0;
+  for (size_t k = 0; k < frames.size(); k++) {
+    if (((frames[k].second ^ last) >> bit) & 1) out.push_back(frames[k].first);
+    last = frames[k].second;
+  }
+  return out;
+}
+
+// Step boundaries of p started at t0, up to `until`, plus the turn-on at t0.
+static std::vector<unsigned long> boundaries(const LedPattern& p, unsigned long t0, unsigned long until) {
+  std::vector<unsigned long> out(1, t0);
+  unsigned long t = t0;
+  for (int k = 0;; k = (k + 1) % p.steps) {
+    t += p.stepsMs[k];
+    if (t >= until) return out;
+    out.push_back(t);
+  }
+}
+
+void test_frames_change_at_the_place_pattern_boundaries() {
+  Engine leds(record);
+  const unsigned long t0 = 1000, until = t0 + 2500;
+  for (int place = 0; place < 3; place++) leds.play(place, ledPatternForPlace(place), t0);
+  leds.play(3, ledPatternForPlace(3), t0);  // later places: steady on
+  runDeadlines(leds, t0, until);
+
+  for (int place = 0; place < 3; place++) {
+    std::vector<unsigned long> expected = boundaries(*ledPatternForPlace(place), t0, until);
+    TEST_ASSERT_TRUE(edges(place) == expected);
+  }
+  TEST_ASSERT_TRUE(edges(3) == std::vector<unsigned long>(1, t0));
+  // FIRST's triple blink: on 120, off 60, on 120, off 60, on 120, off 500.
+  unsigned long first[] = {1000, 1120, 1180, 1300, 1360, 1480, 1980, 2100};
+  for (int k = 0; k < 8; k++) TEST_ASSERT_EQUAL_UINT32(first[k], edges(0)[k]);
+}
+
+// update() ran 130 ms late, past two FIRST boundaries: the LED shows the
+// step it would be on by now, and the next boundary keeps its place.
+void test_late_update_does_not_stretch_the_pattern() {
+  Engine leds(record);
+  leds.play(0, &LED_FIRST, 1000);
+  TEST_ASSERT_EQUAL_UINT32(1120, leds.update(1000));
+  nowMs = 1250;
+  TEST_ASSERT_EQUAL_UINT32(1300, leds.update(nowMs));
+  TEST_ASSERT_TRUE(leds.level(0));  // third step, on
+  nowMs = 1300;
+  TEST_ASSERT_EQUAL_UINT32(1360, leds.update(nowMs));
+  TEST_ASSERT_FALSE(leds.level(0));
+}
+
+// GameCore flashes every LED for START_FLASH_MS at the start of a round;
+// patterns already playing keep their own schedule under the flash.
+void test_start_flash_holds_every_led_on() {
+  Engine leds(record);
+  const unsigned long t0 = 5000;
+  leds.play(2, &LED_THIRD, t0);
+  leds.flashAllUntil(t0 + START_FLASH_MS);
+  nowMs = t0;
+  TEST_ASSERT_EQUAL_UINT32(t0 + THIRD_STEPS_MS[0], leds.update(nowMs));
+  TEST_ASSERT_EQUAL_HEX32(0x3FF, leds.frame());
+  nowMs = t0 + THIRD_STEPS_MS[0];
+  TEST_ASSERT_EQUAL_UINT32(t0 + START_FLASH_MS, leds.update(nowMs));
+  TEST_ASSERT_EQUAL_HEX32(0x3FF, leds.frame());
+  nowMs = t0 + START_FLASH_MS - 1;
+  leds.update(nowMs);
+  TEST_ASSERT_EQUAL_HEX32(0x3FF, leds.frame());
+  nowMs = t0 + START_FLASH_MS;
+  TEST_ASSERT_EQUAL_UINT32(t0 + THIRD_STEPS_MS[0] + THIRD_STEPS_MS[1], leds.update(nowMs));
+  TEST_ASSERT_EQUAL_HEX32(0, leds.frame());  // THIRD is in its off step
+  TEST_ASSERT_EQUAL_UINT32(2, leds.writes());
+
+  // stopAll() cancels a flash in progress.
+  leds.flashAllUntil(nowMs + START_FLASH_MS);
+  leds.update(nowMs);
+  TEST_ASSERT_EQUAL_HEX32(0x3FF, leds.frame());
+  leds.stopAll();
+  leds.update(nowMs + 1);
+  TEST_ASSERT_EQUAL_HEX32(0, leds.frame());
+}
+
+// Ten LEDs blinking for one second, updated every millisecond: one write
+// per distinct boundary time at most, never one per update.
+void test_writes_over_one_second_are_bounded_by_the_boundaries() {
+  Engine leds(record);
+  const unsigned long t0 = 1000, until = t0 + 1000;
+  std::set<unsigned long> changes;
+  for (int i = 0; i < 10; i++) {
+    const LedPattern* p = ledPatternForPlace(i % 3);
+    leds.play(i, p, t0 + 7 * i);
+    std::vector<unsigned long> b = boundaries(*p, t0 + 7 * i, until);
+    changes.insert(b.begin(), b.end());
+  }
+  for (nowMs = t0; nowMs < until; nowMs++) leds.update(nowMs);
+  TEST_ASSERT_TRUE(leds.writes() <= changes.size());
+  TEST_ASSERT_TRUE(leds.writes() >= changes.size() / 2);
+  TEST_ASSERT_EQUAL_UINT32(frames.size(), leds.writes());
+  for (size_t k = 1; k < frames.size(); k++) {
+    TEST_ASSERT_TRUE(frames[k].second != frames[k - 1].second);
+    TEST_ASSERT_TRUE(changes.count(frames[k].first) == 1);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_frames_change_at_the_place_pattern_boundaries);
+  RUN_TEST(test_late_update_does_not_stretch_the_pattern);
+  RUN_TEST(test_start_flash_holds_every_led_on);
+  RUN_TEST(test_writes_over_one_second_are_bounded_by_the_boundaries);
+  return UNITY_END();
+}
@@ -0,0 +1,229 @@
+// PressJournal on the flash emulator: no flash writes while a round is
+// open, segments rotated between rounds and trimmed to the budget, a
+// record torn by a power cut skipped at the next boot with the round
+// counter intact, and an export that carries exactly the segments' bytes
+// and closes only from a later pump (an ACK on the device).
+#include <unity.h>
+#include <stdlib.h>
+#include <string>
+#include "FlashFs.h"
+#include "Hal.h"
+#include "PressJournal.h"
+
+static char dir[64];
+static SimFlashFs* flash;
+
+void setUp() {
+  strcpy(dir, "/tmp/quiz-journal-test-XXXXXX");
+  TEST_ASSERT_NOT_NULL(mkdtemp(dir));
+  flash = new SimFlashFs(dir);
+}
+
+void tearDown() {
+  delete flash;
+  std::filesystem::remove_all(dir);
+}
+
+typedef PressJournal<SimFlashFs> Journal;
+
+static const size_t START_BYTES = 32, PRESS_BYTES = 22, END_BYTES = 20;
+
+static void press(Journal& j, uint32_t round, int team) {
+  JournalEntry e = journalEntry(JR_PRESS, round, 1000 + team);
+  e.team = (int8_t)team;
+  e.place = (int8_t)team;
+  j.append(e);
+}
+
+// One round of `presses` presses: 32 + 22 * presses + 20 bytes.
+static void round(Journal& j, uint32_t round, int presses) {
+  JournalEntry start = journalEntry(JR_ROUND_START, round, 1000);
+  start.value = 5000;
+  j.append(start);
+  for (int t = 0; t < presses; t++) press(j, round, t);
+  JournalEntry end = journalEntry(JR_ROUND_END, round, 9000);
+  end.place = (int8_t)presses;
+  j.append(end);
+}
+
+static std::string segmentFile(uint32_t seq) {
+  char p[32];
+  snprintf(p, sizeof(p), JOURNAL_DIR "/%08lx.bin", (unsigned long)seq);
+  std::string out(flash->size(p), '\0');
+  flash->read(p, 0, (uint8_t*)&out[0], out.size());
+  return out;
+}
+
+static std::string dechunk(const std::string& http) {
+  std::string body;
+  size_t at = http.find("\r\n\r\n") + 4;
+  for (;;) {
+    size_t len = strtoul(http.c_str() + at, NULL, 16);
+    at = http.find("\r\n", at) + 2;
+    if (len == 0) break;
+    body.append(http, at, len);
+    at += len + 2;
+  }
+  return body;
+}
+
+void test_open_round_never_writes_flash() {
+  Journal journal(*flash, 1024, 4, 256);
+  TEST_ASSERT_TRUE(journal.begin(0));
+  TEST_ASSERT_TRUE(journal.flush());
+  uint64_t programmed = flash->programmedBytes;
+  uint32_t flushes = journal.flushes();
+
+  JournalEntry start = journalEntry(JR_ROUND_START, 1, 1000);
+  journal.append(start);
+  TEST_ASSERT_TRUE(journal.roundOpen());
+  for (int t = 0; t < 14; t++) press(journal, 1, t);
+  // The buffer takes the start and (256 - 32) / 22 = 10 presses.
+  TEST_ASSERT_EQUAL_size_t(START_BYTES + 10 * PRESS_BYTES, journal.bufferedBytes());
+  TEST_ASSERT_EQUAL_UINT32(4, journal.droppedRecords());
+  TEST_ASSERT_EQUAL_UINT64(programmed, flash->programmedBytes);
+  TEST_ASSERT_EQUAL_UINT32(flushes, journal.flushes());
+
+  // The round end closes the round and is never dropped; the buffer goes
+  // to flash to make room for it.
+  JournalEntry end = journalEntry(JR_ROUND_END, 1, 9000);
+  journal.append(end);
+  TEST_ASSERT_FALSE(journal.roundOpen());
+  TEST_ASSERT_EQUAL_UINT32(4, journal.droppedRecords());
+  TEST_ASSERT_EQUAL_UINT32(flushes + 1, journal.flushes());
+  TEST_ASSERT_EQUAL_size_t(END_BYTES, journal.bufferedBytes());
+}
+
+// Each between-rounds flush leaves room for a full buffer, so rounds start
+// segments and never straddle them. Small flushes rewrite one block each.
+void test_segments_rotate_between_rounds_and_are_trimmed() {
+  Journal journal(*flash, 512, 3, 256);
+  TEST_ASSERT_TRUE(journal.begin(0));
+  journal.flush();
+  const size_t roundBytes = START_BYTES + 5 * PRESS_BYTES + END_BYTES;  // 162
+  for (uint32_t r = 1; r <= 6; r++) {
+    round(journal, r, 5);
+    journal.flush();
+  }
+  // Two rounds per segment; the first, with the boot record and rounds 1
+  // and 2, was removed when the fourth was started.
+  TEST_ASSERT_EQUAL(3, journal.segmentCount());
+  TEST_ASSERT_EQUAL_UINT32(1, journal.firstSegment());
+  TEST_ASSERT_EQUAL_UINT32(3, journal.lastSegment());
+  TEST_ASSERT_EQUAL_size_t(2 * roundBytes, segmentFile(1).size());
+  TEST_ASSERT_EQUAL_size_t(2 * roundBytes, segmentFile(2).size());
+  TEST_ASSERT_EQUAL_size_t(0, segmentFile(3).size());  // started, not yet written
+  TEST_ASSERT_EQUAL_size_t(0, segmentFile(0).size());
+  for (uint32_t seq = 1; seq <= 2; seq++) TEST_ASSERT_EQUAL_HEX8(JR_ROUND_START, (uint8_t)segmentFile(seq)[1]);
+
+  int starts = 0;
+  uint32_t skipped = journal.forEach([&](const JournalEntry& e) {
+    if (e.type == JR_ROUND_START) starts++;
+  });
+  TEST_ASSERT_EQUAL_UINT32(0, skipped);
+  TEST_ASSERT_EQUAL(4, starts);
+  TEST_ASSERT_EQUAL_UINT32(7, journal.flushes());
+  TEST_ASSERT_EQUAL_UINT32(7, flash->erases);
+  TEST_ASSERT_EQUAL_UINT64(12 + 6 * roundBytes, journal.bytesWritten());
+}
+
+// Power fails 10 bytes into a flush. The next boot skips the torn bytes,
+// recovers the round counter and writes on in a fresh segment.
+void test_power_cut_tears_one_record() {
+  uint32_t tornSegment;
+  {
+    Journal journal(*flash, 1024, 4, 256);
+    TEST_ASSERT_TRUE(journal.begin(0));
+    round(journal, 1, 3);
+    journal.flush();
+    round(journal, 2, 2);
+    journal.flush();
+    tornSegment = journal.lastSegment();
+    JournalEntry change = journalEntry(JR_CONFIG, 2, 9500);
+    change.key = CMD_SET_DURATION;
+    change.value = 3000;
+    journal.append(change);
+    flash->powerCut(10);
+    TEST_ASSERT_FALSE(journal.flush());
+    TEST_ASSERT_EQUAL_UINT32(1, journal.writeErrors());
+    TEST_ASSERT_EQUAL_UINT32(24 - 10, journal.lostBytes());
+    flash->powerOn();
+  }
+  Journal rebooted(*flash, 1024, 4, 256);
+  TEST_ASSERT_TRUE(rebooted.begin(0));
+  TEST_ASSERT_EQUAL_UINT32(10, rebooted.tornBytes());
+  TEST_ASSERT_EQUAL_UINT32(2, rebooted.lastRound());
+  TEST_ASSERT_EQUAL_UINT32(tornSegment + 1, rebooted.lastSegment());
+
+  round(rebooted, rebooted.lastRound() + 1, 1);
+  rebooted.flush();
+  int ends = 0, boots = 0;
+  uint32_t lastEnd = 0;
+  uint32_t skipped = rebooted.forEach([&](const JournalEntry& e) {
+    if (e.type == JR_ROUND_END) {
+      ends++;
+      lastEnd = e.round;
+    }
+    if (e.type == JR_BOOT) boots++;
+  });
+  TEST_ASSERT_EQUAL_UINT32(10, skipped);
+  TEST_ASSERT_EQUAL(3, ends);
+  TEST_ASSERT_EQUAL_UINT32(3, lastEnd);
+  TEST_ASSERT_EQUAL(2, boots);
+}
+
+// The export is the segment files back to back, then the buffered tail.
+void test_export_carries_the_segments_and_closes_on_a_later_pump() {
+  Journal journal(*flash, 512, 4, 256);
+  TEST_ASSERT_TRUE(journal.begin(0));
+  journal.flush();
+  for (uint32_t r = 1; r <= 5; r++) {
+    round(journal, r, 4);
+    journal.flush();
+  }
+  JournalEntry change = journalEntry(JR_CONFIG, 5, 9500);
+  change.key = CMD_SET_DURATION;
+  journal.append(change);
+  TEST_ASSERT_TRUE(journal.segmentCount() >= 3);
+
+  std::string expected;
+  for (uint32_t seq = journal.firstSegment(); seq <= journal.lastSegment(); seq++) expected += segmentFile(seq);
+  uint8_t frame[JournalCodec::MAX_FRAME];
+  expected.append((const char*)frame, JournalCodec::encode(change, frame));
+
+  HalStreamClient http;
+  http.window = 300;
+  http.add("\r\n\r\n", 4);
+  http.send();
+  JournalExport<Journal, HalStreamClient> exporter;
+  exporter.begin(journal, &http);
+  int pumps = 0;
+  while (exporter.pump()) {
+    http.ack(http.inFlight);
+    pumps++;
+  }
+  TEST_ASSERT_TRUE(pumps > 2);
+  TEST_ASSERT_TRUE(http.closed);
+  TEST_ASSERT_EQUAL_size_t(expected.size(), exporter.sentBytes());
+  TEST_ASSERT_TRUE(dechunk(http.sent) == expected);
+
+  // A journal that fits the first window is queued whole by begin(), which
+  // runs in the request handler, but closed only by the next pump.
+  HalStreamClient whole;
+  exporter.begin(journal, &whole);
+  TEST_ASSERT_TRUE(whole.sent.find("\r\n0\r\n\r\n") != std::string::npos);
+  TEST_ASSERT_FALSE(whole.closed);
+  TEST_ASSERT_TRUE(exporter.active());
+  TEST_ASSERT_FALSE(exporter.pump());
+  TEST_ASSERT_TRUE(whole.closed);
+  TEST_ASSERT_FALSE(exporter.active());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_open_round_never_writes_flash);
+  RUN_TEST(test_segments_rotate_between_rounds_and_are_trimmed);
+  RUN_TEST(test_power_cut_tears_one_record);
+  RUN_TEST(test_export_carries_the_segments_and_closes_on_a_later_pump);
+  return UNITY_END();
+}
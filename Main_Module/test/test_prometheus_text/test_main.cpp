@@ -0,0 +1,110 @@
+// PrometheusText: the exact exposition lines for each metric kind, help
+// text longer than any line buffer, and histograms whose cumulative
+// buckets end in a +Inf bucket equal to the count.
+#include <unity.h>
+#include <string>
+#include "PrometheusText.h"
+
+static std::string out;
+
+void setUp() { out.clear(); }
+void tearDown() {}
+
+void test_gauge_and_counter() {
+  PrometheusText<std::string> prom(out);
+  prom.gauge("quiz_uptime_seconds", "Time since boot", 12.5);
+  prom.counter("quiz_http_requests_total", "HTTP requests served", 18446744073709551615ull);
+  TEST_ASSERT_EQUAL_STRING(
+      "# HELP quiz_uptime_seconds Time since boot\n"
+      "# TYPE quiz_uptime_seconds gauge\n"
+      "quiz_uptime_seconds 12.5\n"
+      "# HELP quiz_http_requests_total HTTP requests served\n"
+      "# TYPE quiz_http_requests_total counter\n"
+      "quiz_http_requests_total 18446744073709551615\n",
+      out.c_str());
+}
+
+void test_labelled_family() {
+  PrometheusText<std::string> prom(out);
+  prom.header("quiz_sse_client_sent_total", "Events sent per client", "counter");
+  prom.sample("quiz_sse_client_sent_total", "slot", 0, 7);
+  prom.sample("quiz_sse_client_sent_total", "slot", 11, 4000000000ull);
+  TEST_ASSERT_EQUAL_STRING(
+      "# HELP quiz_sse_client_sent_total Events sent per client\n"
+      "# TYPE quiz_sse_client_sent_total counter\n"
+      "quiz_sse_client_sent_total{slot=\"0\"} 7\n"
+      "quiz_sse_client_sent_total{slot=\"11\"} 4000000000\n",
+      out.c_str());
+}
+
+// Help text and names are not limited by a formatting buffer.
+void test_long_help_is_not_truncated() {
+  std::string help(300, 'h');
+  help += " end";
+  std::string name = "quiz_" + std::string(150, 'n');
+  PrometheusText<std::string> prom(out);
+  prom.counter(name.c_str(), help.c_str(), 3);
+  std::string expected = "# HELP " + name + " " + help + "\n# TYPE " + name + " counter\n" + name + " 3\n";
+  TEST_ASSERT_EQUAL_STRING(expected.c_str(), out.c_str());
+}
+
+void test_histogram_buckets_are_cumulative_up_to_the_last_used() {
+  LatencyHistogram h;
+  h.record(0);    // bucket 0, le 1
+  h.record(3);    // bucket 1, le 3
+  h.record(3);
+  h.record(100);  // bucket 6, le 127
+  PrometheusText<std::string> prom(out);
+  prom.histogram("quiz_press_latency_us", "Press to publish", h);
+  TEST_ASSERT_EQUAL_STRING(
+      "# HELP quiz_press_latency_us Press to publish\n"
+      "# TYPE quiz_press_latency_us histogram\n"
+      "quiz_press_latency_us_bucket{le=\"1\"} 1\n"
+      "quiz_press_latency_us_bucket{le=\"3\"} 3\n"
+      "quiz_press_latency_us_bucket{le=\"7\"} 3\n"
+      "quiz_press_latency_us_bucket{le=\"15\"} 3\n"
+      "quiz_press_latency_us_bucket{le=\"31\"} 3\n"
+      "quiz_press_latency_us_bucket{le=\"63\"} 3\n"
+      "quiz_press_latency_us_bucket{le=\"127\"} 4\n"
+      "quiz_press_latency_us_bucket{le=\"+Inf\"} 4\n"
+      "quiz_press_latency_us_sum 106\n"
+      "quiz_press_latency_us_count 4\n",
+      out.c_str());
+}
+
+void test_empty_histogram_has_only_the_inf_bucket() {
+  LatencyHistogram h;
+  PrometheusText<std::string> prom(out);
+  prom.histogram("quiz_x_us", "x", h);
+  TEST_ASSERT_EQUAL_STRING(
+      "# HELP quiz_x_us x\n"
+      "# TYPE quiz_x_us histogram\n"
+      "quiz_x_us_bucket{le=\"+Inf\"} 0\n"
+      "quiz_x_us_sum 0\n"
+      "quiz_x_us_count 0\n",
+      out.c_str());
+}
+
+// The top bucket's bound is the widest number a bucket line formats.
+void test_top_bucket() {
+  LatencyHistogram h;
+  h.record(0xFFFFFFFFu);
+  PrometheusText<std::string> prom(out);
+  prom.histogram("quiz_y_us", "y", h);
+  char line[64];
+  snprintf(line, sizeof(line), "quiz_y_us_bucket{le=\"%u\"} 1\n",
+           (unsigned)LatencyHistogram::bucketUpperUs(LatencyHistogram::BUCKETS - 1));
+  TEST_ASSERT_TRUE(out.find(line) != std::string::npos);
+  TEST_ASSERT_TRUE(out.find("quiz_y_us_sum 4294967295\n") != std::string::npos);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_gauge_and_counter);
+  RUN_TEST(test_labelled_family);
+  RUN_TEST(test_long_help_is_not_truncated);
+  RUN_TEST(test_histogram_buckets_are_cumulative_up_to_the_last_used);
+  RUN_TEST(test_empty_histogram_has_only_the_inf_bucket);
+  RUN_TEST(test_top_bucket);
+  return UNITY_END();
+}
@@ -0,0 +1,86 @@
+// RoundHistory: the ring keeps the newest ROUNDS rounds, a judge's later
+// decision replaces the newest, and GET /api/history pages (from, limit,
+// next) walk the ring in round order across its wraparound.
+#include <unity.h>
+#include <string>
+#include "RoundHistory.h"
+
+typedef RoundHistory<4, 5> History;
+static History history;
+
+void setUp() { history = History(); }
+void tearDown() {}
+
+static void put(uint32_t round, uint32_t elapsedMs = 1000) {
+  History::Record r = {};
+  r.round = round;
+  r.elapsedMs = elapsedMs;
+  history.put(r);
+}
+
+// The rounds on one page, e.g. "8 9 10", then "| next N" if there is one.
+static std::string page(bool hasFrom, uint32_t from, int limit) {
+  History::Page p = history.page(hasFrom, from, limit);
+  std::string out;
+  for (int k = p.first; k < p.last; k++) out += std::to_string(history.at(k).round) + " ";
+  if (p.last < history.count()) out += "| next " + std::to_string(history.at(p.last).round);
+  return out;
+}
+
+void test_ring_keeps_the_newest_rounds() {
+  for (uint32_t r = 1; r <= 12; r++) put(r);
+  TEST_ASSERT_EQUAL(5, history.count());
+  for (int k = 0; k < 5; k++) TEST_ASSERT_EQUAL_UINT32(8 + k, history.at(k).round);
+}
+
+void test_judged_round_replaces_the_newest() {
+  put(1);
+  put(2, 3000);
+  put(2, 3100);
+  TEST_ASSERT_EQUAL(2, history.count());
+  TEST_ASSERT_EQUAL_UINT32(3100, history.at(1).elapsedMs);
+}
+
+void test_pages_across_the_wraparound() {
+  for (uint32_t r = 1; r <= 12; r++) put(r);  // the ring's start is mid-array
+  TEST_ASSERT_EQUAL_STRING("10 11 12 ", page(false, 0, 3).c_str());
+  TEST_ASSERT_EQUAL_STRING("8 9 10 11 12 ", page(false, 0, 8).c_str());
+  // From a round already overwritten, paging starts at the oldest kept.
+  TEST_ASSERT_EQUAL_STRING("8 9 | next 10", page(true, 1, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("10 11 | next 12", page(true, 10, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("12 ", page(true, 12, 2).c_str());
+  TEST_ASSERT_EQUAL_STRING("", page(true, 13, 2).c_str());
+}
+
+// Following next from the oldest visits every kept round once, in order.
+void test_following_next_visits_every_round_once() {
+  for (uint32_t r = 3; r <= 40; r += 3) put(r);  // gaps, as after a reboot
+  std::string seen;
+  uint32_t from = 0;
+  int pages = 0;
+  for (;;) {
+    History::Page p = history.page(true, from, 2);
+    for (int k = p.first; k < p.last; k++) seen += std::to_string(history.at(k).round) + " ";
+    pages++;
+    if (p.last == history.count()) break;
+    from = history.at(p.last).round;
+  }
+  TEST_ASSERT_EQUAL_STRING("27 30 33 36 39 ", seen.c_str());
+  TEST_ASSERT_EQUAL(3, pages);
+  TEST_ASSERT_EQUAL_STRING("33 36 | next 39", page(true, 31, 2).c_str());
+}
+
+void test_empty_history() {
+  TEST_ASSERT_EQUAL_STRING("", page(false, 0, 8).c_str());
+  TEST_ASSERT_EQUAL_STRING("", page(true, 1, 8).c_str());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_keeps_the_newest_rounds);
+  RUN_TEST(test_judged_round_replaces_the_newest);
+  RUN_TEST(test_pages_across_the_wraparound);
+  RUN_TEST(test_following_next_visits_every_round_once);
+  RUN_TEST(test_empty_history);
+  return UNITY_END();
+}
@@ -0,0 +1,125 @@
+// Round boundaries in GameCore: presses are compared with the start and
+// end of the round in µs, so one in the same millisecond but before the
+// start does not count and one in the last millisecond does. Settings
+// changed mid-round apply from the next round. A round's end event, and so
+// its history record, carries the timer's end rather than the later close.
+#include <unity.h>
+#include "RoundHistory.h"
+#include "SimBoard.h"
+
+SimBoard<10>* board;
+
+void setUp() {
+  simClockSetUs(5000700);  // mid-millisecond, to tell µs from ms
+  board = new SimBoard<10>();
+}
+void tearDown() { delete board; }
+
+void test_press_before_start_in_the_same_millisecond_is_ignored() {
+  uint64_t startUs = halMicros();
+  board->command(CMD_SET_DURATION, 2000);
+  board->command(CMD_START);
+  board->press(1, startUs - 400);
+  board->press(2, startUs);
+  board->runMs(100);
+  TEST_ASSERT_EQUAL(1, board->game.pressCount());
+  TEST_ASSERT_EQUAL(2, board->game.pressOrder(0));
+}
+
+void test_press_in_the_last_microsecond_counts() {
+  uint64_t startUs = halMicros();
+  board->command(CMD_SET_DURATION, 2000);
+  board->command(CMD_START);
+  board->runMs(1990);
+  board->press(3, startUs + 2000000 - 1);
+  board->press(4, startUs + 2000000);
+  board->runMs(100);
+  TEST_ASSERT_FALSE(board->game.active());
+  TEST_ASSERT_EQUAL(1, board->game.pressCount());
+  TEST_ASSERT_EQUAL(3, board->game.pressOrder(0));
+  NetEvent end;
+  TEST_ASSERT_EQUAL(1, board->drainNet(NET_ROUND_END, &end));
+  TEST_ASSERT_EQUAL(1, end.pressCount);
+  // Stamped with the timer's end, not the hold-late close.
+  TEST_ASSERT_EQUAL_UINT64(startUs + 2000000, end.timeUs);
+}
+
+// A timer-ended round closes one press hold late but is stored with its
+// duration; an ended-early one with the time of the end command.
+void test_history_stores_the_round_duration() {
+  typedef RoundHistory<10> History;
+  static History history;
+  uint64_t startUs = halMicros();
+  board->command(CMD_SET_DURATION, 2000);
+  board->command(CMD_START);
+  board->runMs(2000 + INPUT_ORDER_HOLD_MS - 1);
+  TEST_ASSERT_TRUE(board->game.active());
+  board->runMs(1);
+  TEST_ASSERT_FALSE(board->game.active());
+  NetEvent end;
+  TEST_ASSERT_EQUAL(1, board->drainNet(NET_ROUND_END, &end));
+  History::Record r = {};
+  r.round = 1;
+  r.elapsedMs = History::elapsedMs(startUs, end.timeUs);
+  history.put(r);
+  TEST_ASSERT_EQUAL_UINT32(2000, history.at(history.count() - 1).elapsedMs);
+
+  startUs = halMicros();
+  board->command(CMD_START);
+  board->runMs(750);
+  board->command(CMD_END_ROUND);
+  board->runMs(1);
+  TEST_ASSERT_EQUAL(1, board->drainNet(NET_ROUND_END, &end));
+  TEST_ASSERT_EQUAL_UINT32(751, History::elapsedMs(startUs, end.timeUs));
+}
+
+void test_duration_change_mid_round_applies_to_the_next_round() {
+  uint64_t startUs = halMicros();
+  board->command(CMD_SET_DURATION, 2000);
+  board->command(CMD_START);
+  board->runMs(500);
+  board->command(CMD_SET_DURATION, 5000);
+  TEST_ASSERT_EQUAL_UINT32(2000, board->game.durationMs());
+  board->press(5, startUs + 3000000);  // inside the new duration, outside this round's
+  board->runMs(1600);
+  TEST_ASSERT_FALSE(board->game.active());
+  TEST_ASSERT_EQUAL(0, board->game.pressCount());
+  NetEvent start;
+  TEST_ASSERT_EQUAL(1, board->drainNet(NET_ROUND_START, &start));
+  TEST_ASSERT_EQUAL_UINT32(2000, start.durationMs);
+
+  board->command(CMD_START);
+  TEST_ASSERT_EQUAL(1, board->drainNet(NET_ROUND_START, &start));
+  TEST_ASSERT_EQUAL_UINT32(5000, start.durationMs);
+  TEST_ASSERT_EQUAL_UINT32(5000, board->game.durationMs());
+}
+
+void test_tie_settings_change_mid_round_applies_to_the_next_round() {
+  uint64_t startUs = halMicros();
+  board->command(CMD_SET_TIE_WINDOW, 1000);
+  board->command(CMD_SET_TIE_BREAK, TIE_BREAK_TIMESTAMP);
+  board->command(CMD_START);
+  board->command(CMD_SET_TIE_WINDOW, 0);
+  board->command(CMD_SET_TIE_BREAK, TIE_BREAK_JUDGE);
+  board->press(6, startUs + 100000);
+  board->press(7, startUs + 100500);  // a tie under the round's 1000 µs window
+  board->runMs(200);
+  TEST_ASSERT_EQUAL(0, board->game.tieGroup(6));
+  TEST_ASSERT_EQUAL(0, board->game.tieGroup(7));
+  TEST_ASSERT_EQUAL(0, board->game.tiesPending());  // not judged: TIMESTAMP still holds
+  TEST_ASSERT_EQUAL(1, board->game.orderNo(7));
+
+  board->command(CMD_START);
+  TEST_ASSERT_EQUAL_UINT32(0, board->game.tieWindowUs());
+  TEST_ASSERT_EQUAL(TIE_BREAK_JUDGE, board->game.tieBreak());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_press_before_start_in_the_same_millisecond_is_ignored);
+  RUN_TEST(test_press_in_the_last_microsecond_counts);
+  RUN_TEST(test_history_stores_the_round_duration);
+  RUN_TEST(test_duration_change_mid_round_applies_to_the_next_round);
+  RUN_TEST(test_tie_settings_change_mid_round_applies_to_the_next_round);
+  return UNITY_END();
+}
@@ -0,0 +1,187 @@
+// The 32-station build end to end on the shift-register model: switches
+// read through a 74HC165 chain by the 10 kHz scan timer, debounced by
+// InputScanner and arbitrated by GameCore, LEDs written through a 74HC595
+// chain. Presses closer together than one scan period share a snapshot
+// and so a timestamp; the tie results and the latched LED frames are
+// checked against that.
+#include <unity.h>
+#include <vector>
+#include "GameCore.h"
+#include "Hal.h"
+#include "InputScanner.h"
+#include "LedPatternEngine.h"
+#include "ShiftRegisterIO.h"
+#include "SpscRing.h"
+
+// Pins and scan rate as in main.cpp with BUZZER_IO_SHIFT.
+const int IN_LOAD = 32, IN_CLOCK = 33, IN_DATA = 34, OUT_DATA = 25, OUT_CLOCK = 26, OUT_LATCH = 27;
+const uint32_t SCAN_PERIOD_US = 100;
+
+struct ShiftBoard {
+  typedef LedPatternEngine<32> Leds;
+  typedef ToneSequencer<SimToneOut> Tones;
+
+  ShiftBoard()
+    : regs(IN_LOAD, IN_CLOCK, IN_DATA, OUT_DATA, OUT_CLOCK, OUT_LATCH),
+      switches(regs, IN_LOAD, IN_CLOCK, IN_DATA), ledChain(regs, OUT_DATA, OUT_CLOCK, OUT_LATCH),
+      leds(writeLedFrame), tones(buzzerOut),
+      game(leds, tones, publish, 32, (uint32_t)INPUT_ORDER_HOLD_MS * 1000, false) {}
+
+  static void writeLedFrame(uint32_t frame);
+  static void publish(const NetEvent& e);
+
+  SimShiftRegs regs;
+  Hc165Chain<SimShiftRegs, 32> switches;
+  Hc595Chain<SimShiftRegs, 32> ledChain;
+  Leds leds;
+  SimToneOut buzzerOut;
+  Tones tones;
+  InputScanner<32> inputScanner;
+  SpscRing<PressEvent, 64> pressEvents;
+  SpscRing<NetEvent, 64> netEvents;
+  GameCore<32, Leds, Tones> game;
+};
+
+static ShiftBoard* board;
+void ShiftBoard::writeLedFrame(uint32_t frame) { board->ledChain.write(frame); }
+void ShiftBoard::publish(const NetEvent& e) { board->netEvents.push(e); }
+
+struct Press {
+  uint64_t atUs;
+  int index;
+};
+static std::vector<Press> presses;
+static uint64_t startUs;
+
+void setUp() {
+  simClockSetUs(3000000);
+  board = new ShiftBoard();
+  presses.clear();
+}
+void tearDown() { delete board; }
+
+static void startRound(uint8_t policy, uint32_t windowUs) {
+  const Command settings[] = {{CMD_SET_DURATION, 10000}, {CMD_SET_TIE_WINDOW, windowUs}, {CMD_SET_TIE_BREAK, policy}};
+  for (const Command& c : settings) board->game.command(c);
+  startUs = halMicros();
+  Command start = {CMD_START, 1};
+  board->game.command(start);
+}
+
+// Press switch i (held from then on) sinceStartUs into the round.
+static void press(int i, uint64_t sinceStartUs) { presses.push_back({startUs + sinceStartUs, i}); }
+
+// Advance in 10 µs ticks: switches close when due, the scan timer reads
+// the chain every SCAN_PERIOD_US and the arbiter runs every millisecond.
+static void runMs(int ms) {
+  for (int t = 0; t < ms * 100; t++) {
+    simClockAdvanceUs(10);
+    uint64_t now = halMicros();
+    for (const Press& p : presses) {
+      if (p.atUs == now) board->regs.inputs &= ~(1u << p.index);
+    }
+    if (now % SCAN_PERIOD_US == 0) {
+      board->inputScanner.scan(board->switches.readDown(), 0, now, board->pressEvents);
+    }
+    if (now % 1000 == 0) {
+      PressEvent ev;
+      while (board->pressEvents.pop(ev)) board->game.addLocalPress(ev);
+      board->game.service();
+    }
+  }
+}
+
+static std::vector<int> order() {
+  std::vector<int> v;
+  for (int k = 0; k < board->game.pressCount(); k++) v.push_back(board->game.pressOrder(k));
+  return v;
+}
+
+// With no tie window only presses in the same snapshot tie: 5 and 20 are
+// 30 µs apart within one scan period, 7 and 31 40 µs apart in the next,
+// and 2 comes one period later. Ties go by index under TIMESTAMP.
+void test_presses_within_one_scan_period_tie() {
+  startRound(TIE_BREAK_TIMESTAMP, 0);
+  press(20, 50010);
+  press(5, 50040);
+  press(31, 50120);
+  press(7, 50160);
+  press(2, 50230);
+  runMs(100);
+  int expected[] = {5, 20, 7, 31, 2};
+  TEST_ASSERT_TRUE(order() == std::vector<int>(expected, expected + 5));
+  TEST_ASSERT_EQUAL(0, board->game.tieGroup(5));
+  TEST_ASSERT_EQUAL(0, board->game.tieGroup(20));
+  TEST_ASSERT_EQUAL(2, board->game.tieGroup(7));
+  TEST_ASSERT_EQUAL(2, board->game.tieGroup(31));
+  TEST_ASSERT_EQUAL(-1, board->game.tieGroup(2));
+
+  // Stamped at the scan that saw them, not when they closed.
+  uint64_t stamped[] = {50100, 50100, 50200, 50200, 50300};
+  NetEvent e;
+  int k = 0;
+  while (board->netEvents.pop(e)) {
+    if (e.type != NET_PRESS) continue;
+    TEST_ASSERT_EQUAL(expected[k], e.teamIndex);
+    TEST_ASSERT_EQUAL_UINT64(startUs + stamped[k], e.timeUs);
+    TEST_ASSERT_EQUAL(k < 4 ? 1 : 0, e.tie ? 1 : 0);
+    k++;
+  }
+  TEST_ASSERT_EQUAL(5, k);
+}
+
+// A 250 µs window spans three scan periods and groups all five; JUDGE
+// leaves them sharing first place.
+void test_window_groups_presses_across_scans() {
+  startRound(TIE_BREAK_JUDGE, 250);
+  press(20, 50010);
+  press(5, 50040);
+  press(31, 50120);
+  press(7, 50160);
+  press(2, 50230);
+  press(9, 50420);  // seen 400 µs after the group's first snapshot
+  runMs(100);
+  TEST_ASSERT_EQUAL(6, board->game.pressCount());
+  for (int i : {2, 5, 7, 20, 31}) {
+    TEST_ASSERT_EQUAL(0, board->game.tieGroup(i));
+    TEST_ASSERT_EQUAL(0, board->game.orderNo(i));
+  }
+  TEST_ASSERT_EQUAL(-1, board->game.tieGroup(9));
+  TEST_ASSERT_EQUAL(5, board->game.orderNo(9));
+  TEST_ASSERT_EQUAL(5, board->game.tiesPending());
+}
+
+// Every LED frame the game writes is latched on the 595 outputs as is:
+// all 32 on for the start flash, then one LED per press by place.
+void test_led_frames_latch_on_the_595_chain() {
+  startRound(TIE_BREAK_TIMESTAMP, 0);
+  runMs(1);
+  TEST_ASSERT_EQUAL_HEX32(0xFFFFFFFF, board->regs.outputs);
+  runMs(START_FLASH_MS);
+  TEST_ASSERT_EQUAL_HEX32(0, board->regs.outputs);
+
+  press(31, 300010);
+  press(0, 300110);
+  runMs(100 + INPUT_ORDER_HOLD_MS);
+  TEST_ASSERT_EQUAL(2, board->game.pressCount());
+  for (int k = 0; k < 300; k++) {
+    runMs(1);
+    TEST_ASSERT_EQUAL_HEX32(board->leds.frame(), board->regs.outputs);
+  }
+  TEST_ASSERT_TRUE(board->leds.writes() > 4);
+
+  // Straight through the chain: bit i on output i, both ends included.
+  uint32_t frames[] = {0x80000001, 0x12345678, 0xFFFF0000, 0};
+  for (uint32_t f : frames) {
+    board->ledChain.write(f);
+    TEST_ASSERT_EQUAL_HEX32(f, board->regs.outputs);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_presses_within_one_scan_period_tie);
+  RUN_TEST(test_window_groups_presses_across_scans);
+  RUN_TEST(test_led_frames_latch_on_the_595_chain);
+  return UNITY_END();
+}
@@ -0,0 +1,111 @@
+// SpscRing: order, overflow accounting, and a producer thread standing in
+// for the switch ISR hammering a consumer that drains it like the arbiter.
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include "SpscRing.h"
+#include "GameEvents.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_pops_in_push_order() {
+  SpscRing<PressEvent, 8> ring;
+  for (int k = 0; k < 5; k++) {
+    PressEvent e = {};
+    e.index = (uint8_t)k;
+    e.timeUs = 1000 + k;
+    e.level = (uint8_t)(k & 1);
+    TEST_ASSERT_TRUE(ring.push(e));
+  }
+  TEST_ASSERT_EQUAL_UINT32(5, ring.size());
+  PressEvent e;
+  for (int k = 0; k < 5; k++) {
+    TEST_ASSERT_TRUE(ring.pop(e));
+    TEST_ASSERT_EQUAL(k, e.index);
+    TEST_ASSERT_EQUAL_UINT64(1000 + k, e.timeUs);
+    TEST_ASSERT_EQUAL(k & 1, e.level);
+  }
+  TEST_ASSERT_FALSE(ring.pop(e));
+  TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_full_ring_rejects_and_counts() {
+  SpscRing<uint32_t, 4> ring;
+  for (uint32_t k = 0; k < 4; k++) TEST_ASSERT_TRUE(ring.push(k));
+  TEST_ASSERT_FALSE(ring.push(99));
+  TEST_ASSERT_FALSE(ring.push(100));
+  TEST_ASSERT_EQUAL_UINT32(2, ring.dropped());
+  TEST_ASSERT_EQUAL_UINT32(4, ring.highWater());
+  // The rejected items never displace queued ones.
+  uint32_t v;
+  for (uint32_t k = 0; k < 4; k++) {
+    TEST_ASSERT_TRUE(ring.pop(v));
+    TEST_ASSERT_EQUAL_UINT32(k, v);
+  }
+  TEST_ASSERT_TRUE(ring.push(7));
+  TEST_ASSERT_EQUAL_UINT32(2, ring.dropped());
+  TEST_ASSERT_EQUAL_UINT32(4, ring.highWater());
+}
+
+void test_high_water_tracks_deepest_fill() {
+  SpscRing<uint32_t, 16> ring;
+  uint32_t v;
+  for (int round = 0; round < 100; round++) {  // wraps the indices many times
+    for (uint32_t k = 0; k < 3; k++) ring.push(k);
+    while (ring.pop(v)) {}
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, ring.highWater());
+  for (uint32_t k = 0; k < 9; k++) ring.push(k);
+  TEST_ASSERT_EQUAL_UINT32(9, ring.highWater());
+  TEST_ASSERT_EQUAL_UINT32(0, ring.dropped());
+}
+
+// The producer pushes a numbered stream without ever waiting, as the ISR
+// does; the consumer must see an increasing subsequence with nothing
+// duplicated, and every gap must be accounted for in dropped().
+void test_threaded_hammer_keeps_order_and_accounts_drops() {
+  static SpscRing<PressEvent, 64> ring;
+  const uint32_t TOTAL = 2000000;
+  std::atomic<bool> done(false);
+  uint32_t accepted = 0;
+
+  std::thread isr([&]() {
+    for (uint32_t k = 1; k <= TOTAL; k++) {
+      PressEvent e = {};
+      e.index = (uint8_t)(k % 32);
+      e.timeUs = k;
+      if (ring.push(e)) accepted++;
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  uint32_t received = 0, last = 0, misordered = 0, corrupt = 0;
+  PressEvent e;
+  for (;;) {
+    bool finished = done.load(std::memory_order_acquire);
+    while (ring.pop(e)) {
+      if (e.timeUs <= last) misordered++;
+      if (e.index != e.timeUs % 32) corrupt++;
+      last = (uint32_t)e.timeUs;
+      received++;
+    }
+    if (finished) break;
+  }
+  isr.join();
+
+  TEST_ASSERT_EQUAL_UINT32(0, misordered);
+  TEST_ASSERT_EQUAL_UINT32(0, corrupt);
+  TEST_ASSERT_EQUAL_UINT32(accepted, received);
+  TEST_ASSERT_EQUAL_UINT32(TOTAL, received + ring.dropped());
+  TEST_ASSERT_LESS_OR_EQUAL(64, ring.highWater());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_pops_in_push_order);
+  RUN_TEST(test_full_ring_rejects_and_counts);
+  RUN_TEST(test_high_water_tracks_deepest_fill);
+  RUN_TEST(test_threaded_hammer_keeps_order_and_accounts_drops);
+  return UNITY_END();
+}
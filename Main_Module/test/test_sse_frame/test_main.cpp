@@ -0,0 +1,138 @@
+// SseFrame: exact wire format, overflow handling, and a global operator
+// new counter showing that rendering a press and fanning it out to every
+// subscriber does not touch the heap. A rough render timing is printed for
+// comparison between builds.
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
+#include "SseFrame.h"
+#include "SseHub.h"
+#include "RoundFrames.h"
+
+static size_t allocations = 0;
+
+void* operator new(size_t n) {
+  allocations++;
+  void* p = malloc(n ? n : 1);
+  if (p == NULL) throw std::bad_alloc();
+  return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+void setUp() {}
+void tearDown() {}
+
+static NetEvent pressEvent() {
+  NetEvent e = {};
+  e.type = NET_PRESS;
+  e.teamIndex = 3;
+  e.orderNo = 1;
+  e.pressCount = 2;
+  e.timeUs = 1234567;
+  e.tie = true;
+  e.tieGroup = 0;
+  return e;
+}
+
+void test_press_frame_bytes() {
+  SseFrame f;
+  renderPressFrame(f, 42, pressEvent(), 1000000);
+  TEST_ASSERT_FALSE(f.overflowed());
+  TEST_ASSERT_EQUAL_STRING(
+    "id: 42\nevent: buzzer\ndata: {\"type\":\"press\",\"teamIndex\":3,\"timestamp\":1234,"
+    "\"timestampUs\":1234567,\"sinceStartUs\":234567,\"orderNo\":1,\"pressCount\":2,"
+    "\"tie\":true,\"tieGroup\":0}\n\n", f.data());
+  TEST_ASSERT_EQUAL_size_t(strlen(f.data()), f.length());
+  TEST_ASSERT_EQUAL_UINT32(42, f.id());
+}
+
+void test_result_frame_and_no_id() {
+  SseFrame f;
+  int order[] = {4, 2, 7, 1};
+  int places[] = {0, 0, 2, 3};
+  int groups[] = {0, 0, -1, -1};
+  renderResultFrame(f, 0, order, places, groups, 4);
+  TEST_ASSERT_EQUAL_STRING(
+    "event: result\ndata: {\"type\":\"result\",\"top3\":[4,2,7],\"places\":[0,0,2],"
+    "\"tieGroups\":[0,0,-1],\"provisional\":true}\n\n", f.data());
+}
+
+void test_integer_extremes() {
+  SseFrame f;
+  f.begin("x");
+  f.add("min", (long long)INT64_MIN);
+  f.add("max", (unsigned long long)UINT64_MAX);
+  f.add("zero", 0);
+  f.end();
+  TEST_ASSERT_EQUAL_STRING(
+    "event: x\ndata: {\"min\":-9223372036854775808,\"max\":18446744073709551615,\"zero\":0}\n\n", f.data());
+}
+
+void test_overflow_is_flagged_and_not_broadcast() {
+  SseFrame f;
+  f.begin("big", 1);
+  for (int k = 0; k < 40; k++) f.add("key", 123456789);
+  f.end();
+  TEST_ASSERT_TRUE(f.overflowed());
+  TEST_ASSERT_TRUE(f.length() < SseFrame::CAPACITY);
+
+  SseHub hub;
+  SimStreamClient c;
+  hub.attach(&c, false, 0);
+  hub.broadcast(f);
+  TEST_ASSERT_EQUAL_size_t(0, c.sent.size());
+}
+
+void test_press_path_does_not_allocate() {
+  simClockSetUs(1000000);
+  static SseHub hub;
+  static SimStreamClient clients[SSE_MAX_SUBSCRIBERS];
+  for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) {
+    clients[i].sent.reserve(1 << 16);
+    clients[i].pending.reserve(1 << 12);
+    hub.attach(&clients[i], false, 0);
+  }
+  static SseFrame f;
+  NetEvent e = pressEvent();
+  size_t before = allocations;
+  for (int k = 0; k < 100; k++) {
+    e.timeUs += 1000;
+    renderPressFrame(f, hub.nextId(), e, 1000000);
+    hub.broadcast(f);
+    for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) clients[i].ack(clients[i].inFlight);
+  }
+  TEST_ASSERT_EQUAL_size_t(0, allocations - before);
+  TEST_ASSERT_TRUE(clients[0].sent.size() > 100 * 150);
+}
+
+void test_render_speed() {
+  SseFrame f;
+  NetEvent e = pressEvent();
+  const int N = 200000;
+  size_t bytes = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int k = 0; k < N; k++) {
+    e.timeUs = 1000000 + k;
+    renderPressFrame(f, (uint32_t)k + 1, e, 1000000);
+    bytes += f.length();
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+  char line[96];
+  snprintf(line, sizeof(line), "renderPressFrame: %.0f ns per frame, %zu bytes", ns, bytes / N);
+  TEST_MESSAGE(line);
+  TEST_ASSERT_TRUE(bytes > 0);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_press_frame_bytes);
+  RUN_TEST(test_result_frame_and_no_id);
+  RUN_TEST(test_integer_extremes);
+  RUN_TEST(test_overflow_is_flagged_and_not_broadcast);
+  RUN_TEST(test_press_path_does_not_allocate);
+  RUN_TEST(test_render_speed);
+  return UNITY_END();
+}
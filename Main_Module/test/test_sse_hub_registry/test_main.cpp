@@ -0,0 +1,126 @@
+// SseHub registry under load: many simulated clients against a fixed
+// capacity, rejection accounting (the device answers those with 503),
+// slot reuse, per-subscriber memory, heartbeats on idle streams and
+// eviction of a dead peer that stops acknowledging them.
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "SseHub.h"
+#include "RoundFrames.h"
+
+void setUp() { simClockSetUs(1000000); }
+void tearDown() {}
+
+void test_capacity_is_enforced_and_rejections_counted() {
+  static SseHub hub;
+  const int CLIENTS = 4 * SSE_MAX_SUBSCRIBERS;
+  static SimStreamClient clients[CLIENTS];
+  int accepted = 0;
+  for (int i = 0; i < CLIENTS; i++) {
+    // handleEvents checks full() first and answers 503; attach() refuses too.
+    bool wasFull = hub.full();
+    bool ok = hub.attach(&clients[i], false, 0);
+    TEST_ASSERT_EQUAL(!wasFull, ok);
+    accepted += ok ? 1 : 0;
+  }
+  TEST_ASSERT_EQUAL(SSE_MAX_SUBSCRIBERS, accepted);
+  TEST_ASSERT_EQUAL(SSE_MAX_SUBSCRIBERS, hub.count());
+  TEST_ASSERT_EQUAL_UINT32(CLIENTS - SSE_MAX_SUBSCRIBERS, hub.rejected());
+
+  SseFrame f;
+  NetEvent e = {};
+  e.type = NET_PRESS;
+  e.timeUs = 1000000;
+  renderPressFrame(f, hub.nextId(), e, 1000000);
+  hub.broadcast(f);
+  for (int i = 0; i < CLIENTS; i++) {
+    TEST_ASSERT_EQUAL_size_t(i < SSE_MAX_SUBSCRIBERS ? f.length() : 0, clients[i].sent.size());
+  }
+}
+
+void test_freed_slot_is_reused() {
+  SseHub hub;
+  SimStreamClient clients[SSE_MAX_SUBSCRIBERS + 1];
+  for (int i = 0; i < SSE_MAX_SUBSCRIBERS; i++) hub.attach(&clients[i], false, 0);
+  TEST_ASSERT_TRUE(hub.full());
+  hub.detach(&clients[3]);
+  TEST_ASSERT_FALSE(hub.full());
+  TEST_ASSERT_TRUE(hub.attach(&clients[SSE_MAX_SUBSCRIBERS], false, 0));
+  TEST_ASSERT_TRUE(hub.subscriber(3).client == &clients[SSE_MAX_SUBSCRIBERS]);
+  TEST_ASSERT_EQUAL_UINT32(0, hub.rejected());
+}
+
+void test_memory_per_subscriber() {
+  size_t per = SseHub::bytesPerSubscriber();
+  TEST_ASSERT_EQUAL_size_t(sizeof(SseHub::Subscriber), per);
+  TEST_ASSERT_TRUE(per >= SseSendQueue::SLOTS * SseFrame::CAPACITY);
+  TEST_ASSERT_TRUE(sizeof(SseHub) >= SSE_MAX_SUBSCRIBERS * per);
+  char line[80];
+  snprintf(line, sizeof(line), "%d subscribers: %zu bytes each, %zu for the hub", SSE_MAX_SUBSCRIBERS, per,
+           sizeof(SseHub));
+  TEST_MESSAGE(line);
+}
+
+void test_idle_streams_get_heartbeats() {
+  SseHub hub;
+  SimStreamClient c;
+  hub.attach(&c, false, 0);
+  hub.service(halMillis());
+  TEST_ASSERT_EQUAL_size_t(0, c.sent.size());
+  simClockAdvanceUs(SseHub::HEARTBEAT_MS * 1000);
+  hub.service(halMillis());
+  TEST_ASSERT_EQUAL_STRING(": ping\n\n", c.sent.c_str());
+  c.ack(c.inFlight);
+  simClockAdvanceUs(1000000);
+  hub.service(halMillis());  // written recently: no second ping yet
+  TEST_ASSERT_EQUAL_size_t(8, c.sent.size());
+}
+
+// A peer that vanished stops acknowledging; once its heartbeat cannot
+// drain it is evicted once, and its slot freed when it is detached.
+void test_dead_peer_is_evicted() {
+  SseHub hub;
+  SimStreamClient live, dead;
+  hub.attach(&live, false, 0);
+  hub.attach(&dead, false, 0);
+  dead.window = 4;  // less than one heartbeat
+  unsigned long t = 0;
+  for (t = 0; t < 4 * SseHub::HEARTBEAT_MS && !dead.closed; t += 100) {
+    simClockAdvanceUs(100000);
+    hub.service(halMillis());
+    live.ack(live.inFlight);
+  }
+  TEST_ASSERT_TRUE(dead.closed);
+  TEST_ASSERT_FALSE(live.closed);
+  TEST_ASSERT_TRUE(t <= SseHub::HEARTBEAT_MS + SseHub::STALL_TIMEOUT_MS + 100);
+  TEST_ASSERT_EQUAL_UINT32(1, hub.evictions());
+  TEST_ASSERT_TRUE(hub.subscriber(1).closing);
+
+  // Until the stream-close callback detaches it, the slot is skipped: no
+  // second eviction and no more writes.
+  size_t sent = dead.sent.size();
+  for (int k = 0; k < 2; k++) {
+    simClockAdvanceUs(SseHub::STALL_TIMEOUT_MS * 1000);
+    hub.service(halMillis());
+  }
+  SseFrame f;
+  NetEvent e = {};
+  e.type = NET_PRESS;
+  e.timeUs = halMicros();
+  renderPressFrame(f, hub.nextId(), e, 0);
+  hub.broadcast(f);
+  TEST_ASSERT_EQUAL_UINT32(1, hub.evictions());
+  TEST_ASSERT_EQUAL_size_t(sent, dead.sent.size());
+  hub.detach(&dead);
+  TEST_ASSERT_EQUAL(1, hub.count());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_capacity_is_enforced_and_rejections_counted);
+  RUN_TEST(test_freed_slot_is_reused);
+  RUN_TEST(test_memory_per_subscriber);
+  RUN_TEST(test_idle_streams_get_heartbeats);
+  RUN_TEST(test_dead_peer_is_evicted);
+  return UNITY_END();
+}
@@ -0,0 +1,161 @@
+// Last-Event-ID replay: a client that reconnects gets exactly the events it
+// missed, byte for byte, followed by the live stream; one whose gap is no
+// longer buffered, or whose id is from before a reboot (another boot
+// epoch), gets a single resync event instead.
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "SseHub.h"
+#include "RoundFrames.h"
+
+void setUp() { simClockSetUs(5000000); }
+void tearDown() {}
+
+// Broadcast n press events; returns their frames in order.
+static std::vector<std::string> broadcastPresses(SseHub& hub, int n) {
+  std::vector<std::string> frames;
+  SseFrame f;
+  for (int k = 0; k < n; k++) {
+    NetEvent e = {};
+    e.type = NET_PRESS;
+    e.teamIndex = (int8_t)(k % 10);
+    e.orderNo = (int8_t)k;
+    e.timeUs = 5000000 + 1000 * k;
+    renderPressFrame(f, hub.nextId(), e, 5000000);
+    hub.broadcast(f);
+    frames.push_back(std::string(f.data(), f.length()));
+  }
+  return frames;
+}
+
+static std::string join(const std::vector<std::string>& frames, size_t from) {
+  std::string s;
+  for (size_t k = from; k < frames.size(); k++) s += frames[k];
+  return s;
+}
+
+void test_buffer_ring_keeps_the_newest_ids() {
+  SseReplayBuffer r;
+  TEST_ASSERT_TRUE(r.canResumeAfter(0));
+  for (uint32_t id = 1; id <= SseReplayBuffer::ENTRIES + 5; id++) r.add(id, "x", 1);
+  TEST_ASSERT_EQUAL(SseReplayBuffer::ENTRIES, r.count());
+  TEST_ASSERT_EQUAL_UINT32(6, r.oldestId());
+  TEST_ASSERT_EQUAL_UINT32(SseReplayBuffer::ENTRIES + 5, r.newestId());
+  TEST_ASSERT_TRUE(r.canResumeAfter(5));    // 6.. are all there
+  TEST_ASSERT_FALSE(r.canResumeAfter(4));   // 5 is gone
+  TEST_ASSERT_TRUE(r.canResumeAfter(r.newestId()));
+  TEST_ASSERT_FALSE(r.canResumeAfter(r.newestId() + 1));
+  size_t len;
+  uint32_t id;
+  r.frame(0, len, id);
+  TEST_ASSERT_EQUAL_UINT32(6, id);
+}
+
+void test_reconnect_replays_exactly_the_missed_events() {
+  SseHub hub;
+  SimStreamClient always, dropped;
+  hub.attach(&always, false, 0);
+  hub.attach(&dropped, false, 0);
+  std::vector<std::string> frames = broadcastPresses(hub, 4);
+  // The second client drops after event 4 and misses 5..9.
+  hub.detach(&dropped);
+  std::vector<std::string> more = broadcastPresses(hub, 5);
+  frames.insert(frames.end(), more.begin(), more.end());
+
+  SimStreamClient resumed;
+  TEST_ASSERT_TRUE(hub.attach(&resumed, true, 4));
+  TEST_ASSERT_TRUE(resumed.sent == join(frames, 4));
+  // Live events follow the replay with no gap and no duplicate.
+  more = broadcastPresses(hub, 2);
+  frames.insert(frames.end(), more.begin(), more.end());
+  TEST_ASSERT_TRUE(resumed.sent == join(frames, 4));
+  TEST_ASSERT_TRUE(always.sent == join(frames, 0));
+}
+
+void test_up_to_date_client_gets_nothing_replayed() {
+  SseHub hub;
+  broadcastPresses(hub, 3);
+  SimStreamClient c;
+  hub.attach(&c, true, 3);
+  TEST_ASSERT_EQUAL_size_t(0, c.sent.size());
+  SimStreamClient fresh;  // no Last-Event-ID: live events only
+  hub.attach(&fresh, false, 0);
+  TEST_ASSERT_EQUAL_size_t(0, fresh.sent.size());
+}
+
+void test_gap_beyond_the_buffer_resyncs() {
+  SseHub hub;
+  int n = SseReplayBuffer::ENTRIES + 3;
+  broadcastPresses(hub, n);
+  SimStreamClient c;
+  hub.attach(&c, true, 1);
+  char expected[64];
+  snprintf(expected, sizeof(expected), "id: %d\nevent: resync\ndata: {\"type\":\"resync\"}\n\n", n);
+  TEST_ASSERT_EQUAL_STRING(expected, c.sent.c_str());
+}
+
+void test_id_from_before_a_reboot_resyncs() {
+  SseHub hub;  // a rebooted device numbers from 1 again
+  broadcastPresses(hub, 2);
+  SimStreamClient c;
+  hub.attach(&c, true, 500);
+  TEST_ASSERT_EQUAL_STRING("id: 2\nevent: resync\ndata: {\"type\":\"resync\"}\n\n", c.sent.c_str());
+}
+
+// The client's id was a few events short of the newest before the reboot,
+// and the new boot has sent as many events since: the id is inside the
+// range a hub without epochs would replay, whichever epoch comes next.
+void test_boot_epoch_separates_ids_across_a_reboot() {
+  uint32_t lastId;
+  {
+    SseHub before;
+    before.setBootEpoch(7);
+    broadcastPresses(before, 12);
+    lastId = before.nextId() - 3;
+    TEST_ASSERT_EQUAL_UINT32((7u << 20) | 10, lastId);
+  }
+  uint32_t epochs[] = {3, 9};
+  for (uint32_t epoch : epochs) {
+    SseHub after;
+    after.setBootEpoch(epoch);
+    broadcastPresses(after, 12);
+    SimStreamClient c;
+    after.attach(&c, true, lastId);
+    char expected[80];
+    snprintf(expected, sizeof(expected), "id: %u\nevent: resync\ndata: {\"type\":\"resync\"}\n\n",
+             (unsigned)((epoch << 20) | 12));
+    TEST_ASSERT_EQUAL_STRING(expected, c.sent.c_str());
+
+    // An id from this boot still replays.
+    SimStreamClient same;
+    after.attach(&same, true, (epoch << 20) | 10);
+    TEST_ASSERT_TRUE(same.sent.find("id: " + std::to_string((epoch << 20) | 11) + "\n") == 0);
+  }
+}
+
+void test_replay_larger_than_the_window_drains_on_acks() {
+  SseHub hub;
+  std::vector<std::string> frames = broadcastPresses(hub, 6);
+  SimStreamClient c;
+  c.window = 400;
+  hub.attach(&c, true, 1);
+  TEST_ASSERT_TRUE(c.sent.size() <= 400);
+  while (c.inFlight > 0) {
+    c.ack(c.inFlight);
+    hub.onWritable(&c);
+  }
+  TEST_ASSERT_TRUE(c.sent == join(frames, 1));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_buffer_ring_keeps_the_newest_ids);
+  RUN_TEST(test_reconnect_replays_exactly_the_missed_events);
+  RUN_TEST(test_up_to_date_client_gets_nothing_replayed);
+  RUN_TEST(test_gap_beyond_the_buffer_resyncs);
+  RUN_TEST(test_id_from_before_a_reboot_resyncs);
+  RUN_TEST(test_boot_epoch_separates_ids_across_a_reboot);
+  RUN_TEST(test_replay_larger_than_the_window_drains_on_acks);
+  return UNITY_END();
+}
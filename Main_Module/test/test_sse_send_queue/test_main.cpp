@@ -0,0 +1,165 @@
+// SseSendQueue and SseHub under backpressure: one subscriber whose TCP
+// window never reopens must not delay the others, must stay bounded, must
+// never see a frame cut in half, and is evicted once it stalls (or at
+// once with the DISCONNECT policy).
+#include <unity.h>
+#include <string>
+#include "SseHub.h"
+#include "RoundFrames.h"
+
+void setUp() { simClockSetUs(10000000); }
+void tearDown() {}
+
+static std::string frameBytes(SseFrame& f, uint32_t id) {
+  NetEvent e = {};
+  e.type = NET_PRESS;
+  e.teamIndex = (int8_t)(id % 10);
+  e.timeUs = 10000000 + id;
+  renderPressFrame(f, id, e, 10000000);
+  return std::string(f.data(), f.length());
+}
+
+void test_queue_drops_oldest_unsent_and_counts() {
+  SseSendQueue q;
+  char frame[4] = {'a', 'b', 'c', 'd'};
+  for (int k = 0; k < SseSendQueue::SLOTS; k++) {
+    frame[0] = (char)('A' + k);
+    TEST_ASSERT_TRUE(q.push(frame, sizeof(frame)));
+  }
+  TEST_ASSERT_EQUAL_size_t(4 * SseSendQueue::SLOTS, q.queuedBytes());
+  frame[0] = 'Z';
+  TEST_ASSERT_FALSE(q.push(frame, sizeof(frame)));  // 'A' makes room
+  TEST_ASSERT_EQUAL_UINT32(1, q.droppedFrames());
+  size_t len;
+  TEST_ASSERT_EQUAL('B', q.front(len)[0]);
+  TEST_ASSERT_EQUAL_size_t(4, len);
+  TEST_ASSERT_EQUAL(SseSendQueue::SLOTS, q.queuedFrames());
+}
+
+void test_queue_never_drops_a_partly_sent_frame() {
+  SseSendQueue q;
+  char frame[4] = {'a', 'b', 'c', 'd'};
+  for (int k = 0; k < SseSendQueue::SLOTS; k++) {
+    frame[0] = (char)('A' + k);
+    q.push(frame, sizeof(frame));
+  }
+  q.consume(2);  // "Ab" went to TCP
+  frame[0] = 'Z';
+  q.push(frame, sizeof(frame));
+  size_t len;
+  const char* p = q.front(len);
+  TEST_ASSERT_EQUAL_size_t(2, len);
+  TEST_ASSERT_EQUAL_STRING_LEN("cd", p, 2);  // the rest of 'A' still goes out
+  q.consume(2);
+  TEST_ASSERT_EQUAL('C', q.front(len)[0]);   // 'B' was dropped instead
+  TEST_ASSERT_EQUAL_UINT32(1, q.droppedFrames());
+  TEST_ASSERT_EQUAL_UINT32(1, q.sentFrames());
+  TEST_ASSERT_EQUAL_UINT32(4, q.sentBytes());
+}
+
+void test_stalled_client_does_not_delay_the_others() {
+  SseHub hub;
+  SimStreamClient fast1, fast2, stalled;
+  stalled.window = 300;  // a frame and a half, never acked
+  TEST_ASSERT_TRUE(hub.attach(&fast1, false, 0));
+  TEST_ASSERT_TRUE(hub.attach(&stalled, false, 0));
+  TEST_ASSERT_TRUE(hub.attach(&fast2, false, 0));
+
+  SseFrame f;
+  std::string expected;
+  for (uint32_t id = 1; id <= 40; id++) {
+    expected += frameBytes(f, id);
+    hub.broadcast(f);
+    // Every frame is on the healthy clients' wire before broadcast returns.
+    TEST_ASSERT_TRUE(fast1.sent == expected);
+    TEST_ASSERT_TRUE(fast2.sent == expected);
+    fast1.ack(fast1.inFlight);
+    fast2.ack(fast2.inFlight);
+    const SseHub::Subscriber& s = hub.subscriber(1);
+    TEST_ASSERT_TRUE(s.queue.queuedFrames() <= SseSendQueue::SLOTS);
+    simClockAdvanceUs(10000);
+  }
+  const SseHub::Subscriber& s = hub.subscriber(1);
+  TEST_ASSERT_EQUAL_size_t(300, stalled.sent.size());
+  TEST_ASSERT_TRUE(expected.compare(0, 300, stalled.sent) == 0);
+  // Frame 1 went out whole; the queue holds the rest of frame 2 and the
+  // newest SLOTS - 1 frames; everything in between was dropped.
+  TEST_ASSERT_EQUAL_UINT32(40 - 1 - SseSendQueue::SLOTS, s.queue.droppedFrames());
+  TEST_ASSERT_EQUAL(SseSendQueue::SLOTS, s.queue.queuedFrames());
+  TEST_ASSERT_EQUAL_UINT32(0, hub.subscriber(0).queue.droppedFrames());
+  TEST_ASSERT_EQUAL_UINT32(0, hub.evictions());
+  TEST_ASSERT_FALSE(stalled.closed);
+}
+
+void test_window_reopening_resumes_mid_frame() {
+  SseHub hub;
+  SimStreamClient slow;
+  slow.window = 100;
+  hub.attach(&slow, false, 0);
+  SseFrame f;
+  std::string expected;
+  for (uint32_t id = 1; id <= 3; id++) {
+    expected += frameBytes(f, id);
+    hub.broadcast(f);
+  }
+  while (slow.inFlight > 0) {
+    slow.ack(slow.inFlight);
+    hub.onWritable(&slow);
+  }
+  TEST_ASSERT_TRUE(slow.sent == expected);
+  TEST_ASSERT_EQUAL_UINT32(3, hub.subscriber(0).queue.sentFrames());
+  TEST_ASSERT_TRUE(hub.subscriber(0).queue.empty());
+}
+
+void test_stalled_client_is_evicted_after_timeout() {
+  SseHub hub;
+  SimStreamClient ok, stalled;
+  stalled.window = 0;
+  hub.attach(&ok, false, 0);
+  hub.attach(&stalled, false, 0);
+  SseFrame f;
+  frameBytes(f, 1);
+  hub.broadcast(f);
+  simClockAdvanceUs((SseHub::STALL_TIMEOUT_MS - 1) * 1000);
+  hub.service(halMillis());
+  TEST_ASSERT_FALSE(stalled.closed);
+  simClockAdvanceUs(2000);
+  hub.service(halMillis());
+  TEST_ASSERT_TRUE(stalled.closed);
+  TEST_ASSERT_FALSE(ok.closed);
+  TEST_ASSERT_EQUAL_UINT32(1, hub.evictions());
+  hub.detach(&stalled);  // what the stream-close callback does on the device
+  TEST_ASSERT_EQUAL(1, hub.count());
+}
+
+void test_disconnect_policy_drops_a_client_that_overflows() {
+  SseHub hub;
+  hub.setSlowPolicy(SseHub::DISCONNECT);
+  SimStreamClient ok, stalled;
+  stalled.window = 0;
+  hub.attach(&ok, false, 0);
+  hub.attach(&stalled, false, 0);
+  SseFrame f;
+  for (uint32_t id = 1; id <= SseSendQueue::SLOTS; id++) {
+    frameBytes(f, id);
+    hub.broadcast(f);
+    ok.ack(ok.inFlight);
+  }
+  TEST_ASSERT_FALSE(stalled.closed);
+  frameBytes(f, SseSendQueue::SLOTS + 1);
+  hub.broadcast(f);
+  TEST_ASSERT_TRUE(stalled.closed);
+  TEST_ASSERT_FALSE(ok.closed);
+  TEST_ASSERT_EQUAL_UINT32(1, hub.evictions());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_queue_drops_oldest_unsent_and_counts);
+  RUN_TEST(test_queue_never_drops_a_partly_sent_frame);
+  RUN_TEST(test_stalled_client_does_not_delay_the_others);
+  RUN_TEST(test_window_reopening_resumes_mid_frame);
+  RUN_TEST(test_stalled_client_is_evicted_after_timeout);
+  RUN_TEST(test_disconnect_policy_drops_a_client_that_overflows);
+  return UNITY_END();
+}
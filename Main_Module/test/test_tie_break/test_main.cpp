@@ -0,0 +1,160 @@
+// Tie handling in GameCore: the tie window boundary, buttons seen in the
+// same input snapshot, the RANDOM policy's reproducibility from the round
+// seed, and the order of a judge's decisions.
+#include <unity.h>
+#include <vector>
+#include "SimBoard.h"
+
+SimBoard<10>* board;
+uint64_t startUs;
+
+void setUp() {
+  simClockSetUs(2000000);
+  board = new SimBoard<10>();
+}
+void tearDown() { delete board; }
+
+static void startRound(uint8_t policy, uint32_t windowUs, uint32_t seed = 1) {
+  board->command(CMD_SET_DURATION, 10000);
+  board->command(CMD_SET_TIE_WINDOW, windowUs);
+  board->command(CMD_SET_TIE_BREAK, policy);
+  startUs = halMicros();
+  board->command(CMD_START, seed);
+}
+
+static void press(int i, uint64_t sinceStartUs) { board->press(i, startUs + sinceStartUs); }
+
+static std::vector<int> order() {
+  std::vector<int> v;
+  for (int k = 0; k < board->game.pressCount(); k++) v.push_back(board->game.pressOrder(k));
+  return v;
+}
+
+// Ties are measured from the first press of a group: at most the window
+// apart is a tie, one microsecond more is not.
+void test_tie_window_boundary() {
+  startRound(TIE_BREAK_TIMESTAMP, 1000);
+  press(1, 100000);
+  press(2, 101000);  // exactly the window after 1: tie
+  press(3, 101001);  // one µs more: a new group
+  press(4, 101800);  // within the window of 3, not of 1
+  board->runMs(200);
+  TEST_ASSERT_EQUAL(4, board->game.pressCount());
+  TEST_ASSERT_EQUAL(0, board->game.tieGroup(1));
+  TEST_ASSERT_EQUAL(0, board->game.tieGroup(2));
+  TEST_ASSERT_EQUAL(2, board->game.tieGroup(3));
+  TEST_ASSERT_EQUAL(2, board->game.tieGroup(4));
+  int expected[] = {1, 2, 3, 4};
+  for (int k = 0; k < 4; k++) TEST_ASSERT_EQUAL(expected[k], board->game.pressOrder(k));
+  for (int k = 0; k < 4; k++) TEST_ASSERT_EQUAL(k, board->game.orderNo(expected[k]));
+}
+
+void test_zero_window_ties_only_identical_timestamps() {
+  startRound(TIE_BREAK_TIMESTAMP, 0);
+  press(5, 50000);
+  press(6, 50000);
+  press(7, 50001);
+  board->runMs(100);
+  TEST_ASSERT_EQUAL(0, board->game.tieGroup(5));
+  TEST_ASSERT_EQUAL(0, board->game.tieGroup(6));
+  TEST_ASSERT_EQUAL(-1, board->game.tieGroup(7));
+}
+
+// Two switches closing between the same pair of scans are stamped alike;
+// TIMESTAMP orders them by index and flags the tie.
+void test_same_snapshot_presses_tie() {
+  startRound(TIE_BREAK_TIMESTAMP, 0);
+  board->runMs(50);
+  uint32_t edges = board->setSwitches((1u << 8) | (1u << 3), true);
+  TEST_ASSERT_EQUAL_HEX32((1u << 8) | (1u << 3), edges);
+  board->isr(edges);
+  board->runMs(60);
+  TEST_ASSERT_EQUAL(2, board->game.pressCount());
+  TEST_ASSERT_EQUAL(3, board->game.pressOrder(0));
+  TEST_ASSERT_EQUAL(8, board->game.pressOrder(1));
+  TEST_ASSERT_EQUAL(0, board->game.tieGroup(3));
+  TEST_ASSERT_EQUAL(0, board->game.tieGroup(8));
+  int ties = 0;
+  NetEvent e;
+  while (board->netEvents.pop(e)) {
+    if (e.type == NET_PRESS) ties += e.tie ? 1 : 0;
+  }
+  TEST_ASSERT_EQUAL(2, ties);
+}
+
+static std::vector<int> randomRound(uint32_t seed) {
+  delete board;
+  board = new SimBoard<10>();
+  startRound(TIE_BREAK_RANDOM, 1000, seed);
+  for (int i = 0; i < 6; i++) press(i, 30000 + 100 * i);
+  board->runMs(100);
+  return order();
+}
+
+// The shuffle depends only on the seed: a logged seed replays the round.
+void test_random_policy_is_reproducible_from_the_seed() {
+  std::vector<int> first = randomRound(0xC0FFEE);
+  TEST_ASSERT_EQUAL_size_t(6, first.size());
+  TEST_ASSERT_EQUAL_UINT32(0xC0FFEE, board->game.seed());
+  std::vector<int> again = randomRound(0xC0FFEE);
+  TEST_ASSERT_TRUE(first == again);
+  int seen = 0;
+  for (int i : first) seen |= 1 << i;
+  TEST_ASSERT_EQUAL_HEX32(0x3F, seen);  // a permutation of the group
+
+  int differs = 0;
+  for (uint32_t seed = 1; seed <= 20; seed++) differs += randomRound(seed) != first ? 1 : 0;
+  TEST_ASSERT_TRUE(differs >= 15);
+}
+
+// JUDGE gives the group one shared place; each decision takes the next
+// place, and the last member left takes the last one by itself.
+void test_judge_decides_in_order() {
+  startRound(TIE_BREAK_JUDGE, 1000);
+  press(9, 10000);
+  press(1, 10000);
+  press(4, 10500);
+  press(6, 40000);  // after the group
+  board->runMs(100);
+  TEST_ASSERT_EQUAL(3, board->game.tiesPending());
+  TEST_ASSERT_EQUAL(0, board->game.orderNo(1));
+  TEST_ASSERT_EQUAL(0, board->game.orderNo(4));
+  TEST_ASSERT_EQUAL(0, board->game.orderNo(9));
+  TEST_ASSERT_EQUAL(3, board->game.orderNo(6));
+  NetEvent e;
+  while (board->netEvents.pop(e)) {}
+
+  board->command(CMD_JUDGE_TIE, 6);  // not in a tie: ignored
+  board->command(CMD_JUDGE_TIE, 4);
+  TEST_ASSERT_EQUAL(0, board->game.orderNo(4));
+  TEST_ASSERT_EQUAL(1, board->game.orderNo(1));
+  TEST_ASSERT_EQUAL(1, board->game.orderNo(9));
+  TEST_ASSERT_EQUAL(2, board->game.tiesPending());
+  board->command(CMD_JUDGE_TIE, 9);
+  board->command(CMD_JUDGE_TIE, 1);  // already placed with the last decision
+  TEST_ASSERT_EQUAL(0, board->game.tiesPending());
+
+  int expected[] = {4, 9, 1, 6};
+  for (int k = 0; k < 4; k++) TEST_ASSERT_EQUAL(expected[k], board->game.pressOrder(k));
+  for (int k = 0; k < 4; k++) TEST_ASSERT_EQUAL(k, board->game.orderNo(expected[k]));
+  // One NET_TIE_RESOLVED per placement, in decision order.
+  int resolved[][2] = {{4, 0}, {9, 1}, {1, 2}};
+  for (int k = 0; k < 3; k++) {
+    TEST_ASSERT_TRUE(board->netEvents.pop(e));
+    TEST_ASSERT_EQUAL(NET_TIE_RESOLVED, e.type);
+    TEST_ASSERT_EQUAL(resolved[k][0], e.teamIndex);
+    TEST_ASSERT_EQUAL(resolved[k][1], e.orderNo);
+    TEST_ASSERT_EQUAL(0, e.tieGroup);
+  }
+  TEST_ASSERT_FALSE(board->netEvents.pop(e));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_tie_window_boundary);
+  RUN_TEST(test_zero_window_ties_only_identical_timestamps);
+  RUN_TEST(test_same_snapshot_presses_tie);
+  RUN_TEST(test_random_policy_is_reproducible_from_the_seed);
+  RUN_TEST(test_judge_decides_in_order);
+  return UNITY_END();
+}
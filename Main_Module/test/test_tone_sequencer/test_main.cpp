@@ -0,0 +1,84 @@
+// ToneSequencer on SimToneOut: the tone at every step boundary of the
+// FIRST and ROUND_END cues, one output write per step plus the closing
+// silence, and a late update() that lands on the right step without
+// moving the boundaries after it.
+#include <unity.h>
+#include "GameCues.h"
+
+static SimToneOut out;
+
+void setUp() { out = SimToneOut(); }
+void tearDown() {}
+
+// Play a cue at t0, following update()'s deadlines, and check the output
+// just before and at each boundary.
+static void playThrough(const ToneCue& cue, unsigned long t0) {
+  ToneSequencer<SimToneOut> seq(out);
+  seq.play(&cue, t0);
+  unsigned long boundary = t0;
+  for (int k = 0; k < cue.count; k++) {
+    TEST_ASSERT_EQUAL_UINT16(cue.steps[k].freqHz, out.freqHz);
+    TEST_ASSERT_EQUAL_UINT16(cue.steps[k].duty, out.duty);
+    boundary += cue.steps[k].durationMs;
+    TEST_ASSERT_EQUAL_UINT32(boundary, seq.update(boundary - 1));
+    TEST_ASSERT_EQUAL_UINT16(cue.steps[k].freqHz, out.freqHz);
+    unsigned long next = seq.update(boundary);
+    TEST_ASSERT_EQUAL_UINT32(k + 1 < cue.count ? boundary + cue.steps[k + 1].durationMs : 0, next);
+  }
+  TEST_ASSERT_FALSE(seq.playing());
+  TEST_ASSERT_EQUAL_UINT16(0, out.freqHz);
+  TEST_ASSERT_EQUAL_UINT16(0, out.duty);
+  TEST_ASSERT_EQUAL_UINT32(cue.count + 1, seq.writes());
+  TEST_ASSERT_EQUAL_UINT32(cue.count + 1, out.writes);
+  TEST_ASSERT_EQUAL_UINT32(0, seq.update(boundary + 1000));
+  TEST_ASSERT_EQUAL_UINT32(cue.count + 1, out.writes);
+}
+
+void test_first_place_cue() {
+  TEST_ASSERT_EQUAL(5, TONE_FIRST.count);
+  playThrough(TONE_FIRST, 1000);
+}
+
+void test_round_end_cue() {
+  TEST_ASSERT_EQUAL(5, TONE_ROUND_END.count);
+  playThrough(TONE_ROUND_END, 77777);
+}
+
+// ROUND_END is 150 on, 50 rest, 150 on, 50 rest, 400 on. update() first
+// runs 260 ms in, inside the third step: that step plays, the ones missed
+// are never written, and the next boundary is still at 350.
+void test_late_update_lands_on_the_current_step() {
+  ToneSequencer<SimToneOut> seq(out);
+  seq.play(&TONE_ROUND_END, 0);
+  TEST_ASSERT_EQUAL_UINT32(350, seq.update(260));
+  TEST_ASSERT_EQUAL_UINT16(2000, out.freqHz);
+  TEST_ASSERT_EQUAL_UINT32(2, out.writes);
+  TEST_ASSERT_EQUAL_UINT32(400, seq.update(350));
+  TEST_ASSERT_EQUAL_UINT16(0, out.duty);
+  // Late past the end: silent, in one write.
+  TEST_ASSERT_EQUAL_UINT32(0, seq.update(5000));
+  TEST_ASSERT_FALSE(seq.playing());
+  TEST_ASSERT_EQUAL_UINT16(0, out.freqHz);
+  TEST_ASSERT_EQUAL_UINT32(4, out.writes);
+}
+
+// A new cue replaces the playing one from its first step.
+void test_play_replaces_the_current_cue() {
+  ToneSequencer<SimToneOut> seq(out);
+  seq.play(&TONE_ROUND_END, 0);
+  seq.update(100);
+  seq.play(&TONE_THIRD, 120);
+  TEST_ASSERT_EQUAL_UINT16(THIRD_TONE[0].freqHz, out.freqHz);
+  TEST_ASSERT_EQUAL_UINT32(120 + THIRD_TONE[0].durationMs, seq.update(130));
+  TEST_ASSERT_EQUAL_UINT32(0, seq.update(120 + THIRD_TONE[0].durationMs));
+  TEST_ASSERT_EQUAL_UINT32(3, out.writes);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_first_place_cue);
+  RUN_TEST(test_round_end_cue);
+  RUN_TEST(test_late_update_lands_on_the_current_step);
+  RUN_TEST(test_play_replaces_the_current_cue);
+  return UNITY_END();
+}
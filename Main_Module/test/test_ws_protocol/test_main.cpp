@@ -0,0 +1,73 @@
+// WsProtocol codec: the byte layouts espApi.ts decodes (see connectWs) and
+// command validation.
+#include <unity.h>
+#include "WsProtocol.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_press_layout() {
+  uint8_t buf[WS_PRESS_LEN];
+  TEST_ASSERT_EQUAL_size_t(16, wsEncodePress(buf, 7, 2, 3, 0x01020304, 0x1122334455667788ull));
+  const uint8_t expected[16] = {WS_MSG_PRESS, 7, 2, 3, 0x04, 0x03, 0x02, 0x01,
+                                0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buf, sizeof(expected));
+}
+
+void test_result_layout_pads_missing_places() {
+  uint8_t buf[WS_RESULT_LEN];
+  int top[] = {5, 9};
+  TEST_ASSERT_EQUAL_size_t(12, wsEncodeResult(buf, top, 2, 77));
+  const uint8_t expected[12] = {WS_MSG_RESULT, 2, 5, 9, 0xFF, 0, 0, 0, 77, 0, 0, 0};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, buf, sizeof(expected));
+  TEST_ASSERT_EQUAL(-1, (int8_t)buf[4]);  // getInt8 on the client
+}
+
+void test_start_reset_and_ack_layouts() {
+  uint8_t buf[WS_START_LEN];
+  TEST_ASSERT_EQUAL_size_t(12, wsEncodeStart(buf, 123456, 10000));
+  const uint8_t start[12] = {WS_MSG_START, 0, 0, 0, 0x40, 0xE2, 0x01, 0, 0x10, 0x27, 0, 0};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(start, buf, sizeof(start));
+
+  TEST_ASSERT_EQUAL_size_t(4, wsEncodeReset(buf));
+  const uint8_t reset[4] = {WS_MSG_RESET, 0, 0, 0};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(reset, buf, sizeof(reset));
+
+  TEST_ASSERT_EQUAL_size_t(8, wsEncodeAck(buf, WS_OP_CONFIG, WS_ACK_BUSY, 0xDEADBEEF));
+  const uint8_t ack[8] = {WS_MSG_ACK, WS_OP_CONFIG, WS_ACK_BUSY, 0, 0xEF, 0xBE, 0xAD, 0xDE};
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(ack, buf, sizeof(ack));
+}
+
+void test_command_decodes_what_the_client_sends() {
+  // op 3 (config), seq 0x01000002, value 15000 ms, as DataView writes it
+  const uint8_t frame[12] = {3, 0, 0, 0, 0x02, 0, 0, 0x01, 0x98, 0x3A, 0, 0};
+  WsCommand cmd;
+  TEST_ASSERT_TRUE(wsDecodeCommand(frame, sizeof(frame), cmd));
+  TEST_ASSERT_EQUAL(WS_OP_CONFIG, cmd.op);
+  TEST_ASSERT_EQUAL_UINT32(0x01000002, cmd.seq);
+  TEST_ASSERT_EQUAL_UINT32(15000, cmd.value);
+}
+
+void test_command_rejects_bad_length_and_op() {
+  uint8_t frame[13] = {WS_OP_START};
+  WsCommand cmd;
+  TEST_ASSERT_FALSE(wsDecodeCommand(frame, 11, cmd));
+  TEST_ASSERT_FALSE(wsDecodeCommand(frame, 13, cmd));
+  TEST_ASSERT_TRUE(wsDecodeCommand(frame, 12, cmd));
+  frame[0] = 0;
+  TEST_ASSERT_FALSE(wsDecodeCommand(frame, 12, cmd));
+  frame[0] = WS_OP_PING + 1;
+  TEST_ASSERT_FALSE(wsDecodeCommand(frame, 12, cmd));
+  frame[0] = WS_OP_PING;
+  TEST_ASSERT_TRUE(wsDecodeCommand(frame, 12, cmd));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_press_layout);
+  RUN_TEST(test_result_layout_pads_missing_places);
+  RUN_TEST(test_start_reset_and_ack_layouts);
+  RUN_TEST(test_command_decodes_what_the_client_sends);
+  RUN_TEST(test_command_rejects_bad_length_and_op);
+  return UNITY_END();
+}